@@ -5,7 +5,13 @@
 #include <cstdio>
 #include <thread>
 #include <atomic>
+#include <mutex>
+#include <cerrno>
+#include <fcntl.h>
 #include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 class NixCliPet final
@@ -13,6 +19,7 @@ class NixCliPet final
 public:
     static constexpr uint16_t FramebufferWidth = 36;
     static constexpr uint16_t FramebufferHeight = 9;
+    static constexpr uint32_t MaxOpenFiles = 8;
 public:
     static NixCliPet* FromHandle(const PetAppHandle handle) noexcept
     {
@@ -21,7 +28,7 @@ public:
 public:
     NixCliPet(const PetAICallbacks* const pPetAICallbacks) noexcept;
 
-    ~NixCliPet() noexcept = default;
+    ~NixCliPet() noexcept;
 
     NixCliPet(const NixCliPet& copy) noexcept = delete;
     NixCliPet(NixCliPet&& move) noexcept = delete;
@@ -31,6 +38,8 @@ public:
 
     PetStatus SavePetState(PetFileHandle file, const size_t offset, const void* pData, const size_t size) noexcept;
     PetStatus LoadPetState(PetFileHandle file, const size_t offset, void* pData, size_t* pSize) noexcept;
+    PetStatus MapPetState(PetFileHandle file, const void** ppData, size_t* pSize) noexcept;
+    PetStatus UnmapPetState(PetFileHandle file, const void* pData, size_t size) noexcept;
 
     PetStatus Sleep(TimeMs_t* const pSleepTime) noexcept;
     PetStatus Yield(TimeMs_t* const pSleepTime) noexcept;
@@ -43,9 +52,47 @@ public:
     PetStatus DestroyRenderer(const PetRendererHandle rendererHandle) noexcept;
 
     PetStatus Present(PetRendererHandle rendererHandle, const PetRendererFunctions* pRendererFunctions) noexcept;
+
+    /**
+     * Flushes and closes every cached file.
+     */
+    void CloseFiles() noexcept;
+private:
+    struct OpenFile final
+    {
+        PetFileHandle File;
+        int Fd;
+        bool Writable;
+        bool Written;
+    };
+private:
+    /**
+     *   Gets a duplicate of the cached descriptor for a file, opening it
+     * the first time it is used. The caller closes the duplicate, so the
+     * cache can evict the file while the caller is still using it.
+     *
+     *   Files are opened read only until they are written. A file that
+     * doesn't exist yet is only created for writing, otherwise -1 is
+     * returned with errno set to ENOENT.
+     */
+    int GetFile(PetFileHandle file, bool write) noexcept;
+
+    /**
+     * Prints an RGB24 image, a full block per pixel.
+     */
+    static void PrintFramebuffer(const uint8_t* pPixels, size_t stride, uint16_t width, uint16_t height) noexcept;
 private:
     PetAICallbacks m_Callbacks;  // NOLINT(clang-diagnostic-unused-private-field)
-    uint8_t m_Framebuffer[static_cast<size_t>(FramebufferWidth) * static_cast<size_t>(FramebufferHeight) * 3];
+
+    /**
+     *   Saves come from Pet AI's checkpoint thread, loads from the tick
+     * thread, the lock only covers the cache itself. The I/O happens on
+     * the duplicates from GetFile, and pread and pwrite don't share a
+     * file position.
+     */
+    ::std::mutex m_FilesLock;
+    OpenFile m_Files[MaxOpenFiles];
+    uint32_t m_OpenFileCount;
 };
 
 static PetStatus CreatePetApp(PetAppHandle* const pOutPetAppHandle, const PetAICallbacks* const pPetAICallbacks);
@@ -53,6 +100,8 @@ static PetStatus DestroyPetApp(const PetAppHandle petAppHandle);
 
 static PetStatus SavePetState(const PetAppHandle petAppHandle, const PetFileHandle file, const size_t offset, const void* const pData, const size_t size);
 static PetStatus LoadPetState(const PetAppHandle petAppHandle, const PetFileHandle file, const size_t offset, void* const pData, size_t* const pSize);
+static PetStatus MapPetState(const PetAppHandle petAppHandle, const PetFileHandle file, const void** const ppData, size_t* const pSize);
+static PetStatus UnmapPetState(const PetAppHandle petAppHandle, const PetFileHandle file, const void* const pData, const size_t size);
 
 static PetStatus Sleep(const PetAppHandle petAppHandle, TimeMs_t* const pSleepTime);
 static PetStatus Yield(const PetAppHandle petAppHandle, TimeMs_t* const pSleepTime);
@@ -81,6 +130,8 @@ int main(int argCount, char* args[])
     petFunctions.DestroyPetApp = DestroyPetApp;
     petFunctions.SavePetState = SavePetState;
     petFunctions.LoadPetState = LoadPetState;
+    petFunctions.MapPetState = MapPetState;
+    petFunctions.UnmapPetState = UnmapPetState;
     petFunctions.Sleep = Sleep;
     petFunctions.Yield = Yield;
     petFunctions.Update = Update;
@@ -117,8 +168,16 @@ int main(int argCount, char* args[])
 
 NixCliPet::NixCliPet(const PetAICallbacks* const pPetAICallbacks) noexcept
     : m_Callbacks(*pPetAICallbacks)
+    , m_FilesLock()
+    , m_Files { }
+    , m_OpenFileCount(0)
 { }
 
+NixCliPet::~NixCliPet() noexcept
+{
+    CloseFiles();
+}
+
 PetStatus NixCliPet::SavePetState(const PetFileHandle file, const size_t offset, const void* const pData, const size_t size) noexcept
 {
     if(!pData)
@@ -126,65 +185,260 @@ PetStatus NixCliPet::SavePetState(const PetFileHandle file, const size_t offset,
         return PetInvalidArg;
     }
 
-    char nameBuffer[6];
-    (void) ::std::snprintf(nameBuffer, sizeof(nameBuffer), "%d", file);
+    const int fd = GetFile(file, true);
 
-    FILE* cFile = fopen(nameBuffer, "wb+");
-    if(!cFile)
+    if(fd < 0)
     {
         return PetFail;
     }
 
-    if(!fseek(cFile, static_cast<long>(offset), SEEK_SET))
+    const uint8_t* data = static_cast<const uint8_t*>(pData);
+    size_t written = 0;
+    PetStatus status = PetSuccess;
+
+    while(written < size)
     {
-        return PetFail;
-    }
+        const ssize_t result = pwrite(fd, data + written, size - written, static_cast<off_t>(offset + written));
 
-    (void) fwrite(pData, 1, size, cFile);
+        if(result < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
 
-    (void) fclose(cFile);
+            status = PetFail;
+            break;
+        }
 
-    return PetSuccess;
+        written += static_cast<size_t>(result);
+    }
+
+    (void) close(fd);
+
+    return status;
 }
 
 PetStatus NixCliPet::LoadPetState(const PetFileHandle file, const size_t offset, void* const pData, size_t* const pSize) noexcept
 {
+    if(!pSize)
+    {
+        return PetInvalidArg;
+    }
+
+    const int fd = GetFile(file, false);
+
+    if(fd < 0)
+    {
+        *pSize = 0;
+        // A file that doesn't exist is just empty.
+        return errno == ENOENT ? PetSuccess : PetFail;
+    }
+
+    if(!pData)
+    {
+        struct stat fileStat { };
+
+        if(fstat(fd, &fileStat) != 0)
+        {
+            (void) close(fd);
+            *pSize = 0;
+            return PetFail;
+        }
+
+        (void) close(fd);
+
+        const size_t fileSize = static_cast<size_t>(fileStat.st_size);
+        *pSize = offset < fileSize ? fileSize - offset : 0;
+
+        return PetSuccess;
+    }
+
+    uint8_t* const data = static_cast<uint8_t*>(pData);
+    const size_t size = *pSize;
+    size_t read = 0;
+    PetStatus status = PetSuccess;
+
+    while(read < size)
+    {
+        const ssize_t result = pread(fd, data + read, size - read, static_cast<off_t>(offset + read));
+
+        if(result < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+
+            status = PetFail;
+            break;
+        }
+
+        // End of file.
+        if(result == 0)
+        {
+            break;
+        }
+
+        read += static_cast<size_t>(result);
+    }
+
+    (void) close(fd);
+
+    *pSize = read;
+
+    return status;
+}
+
+PetStatus NixCliPet::MapPetState(const PetFileHandle file, const void** const ppData, size_t* const pSize) noexcept
+{
+    if(!ppData || !pSize)
+    {
+        return PetInvalidArg;
+    }
+
+    *ppData = nullptr;
+    *pSize = 0;
+
     char nameBuffer[6];
     (void) ::std::snprintf(nameBuffer, sizeof(nameBuffer), "%d", file);
 
-    FILE* cFile = fopen(nameBuffer, "wb+");
-    if(!cFile)
+    const int fd = open(nameBuffer, O_RDONLY);
+
+    if(fd < 0)
     {
-        *pSize = 0;
+        // A file that doesn't exist is just empty.
+        return errno == ENOENT ? PetSuccess : PetFail;
+    }
+
+    struct stat fileStat { };
+
+    if(fstat(fd, &fileStat) != 0)
+    {
+        (void) close(fd);
         return PetFail;
     }
 
-    if(!fseek(cFile, static_cast<long>(offset), SEEK_SET))
+    if(fileStat.st_size == 0)
+    {
+        (void) close(fd);
+        return PetSuccess;
+    }
+
+    const size_t size = static_cast<size_t>(fileStat.st_size);
+    void* const data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping keeps the file alive on its own.
+    (void) close(fd);
+
+    if(data == MAP_FAILED)
     {
-        *pSize = 0;
         return PetFail;
     }
 
+    *ppData = data;
+    *pSize = size;
+
+    return PetSuccess;
+}
+
+PetStatus NixCliPet::UnmapPetState(const PetFileHandle file, const void* const pData, const size_t size) noexcept
+{
+    (void) file;
+
     if(!pData)
     {
-        const int64_t currentPos = static_cast<int64_t>(ftell(cFile));
-        if(!fseek(cFile, 0, SEEK_END))
+        return PetInvalidArg;
+    }
+
+    if(munmap(const_cast<void*>(pData), size) != 0)
+    {
+        return PetFail;
+    }
+
+    return PetSuccess;
+}
+
+void NixCliPet::CloseFiles() noexcept
+{
+    ::std::lock_guard lock(m_FilesLock);
+
+    for(uint32_t i = 0; i < m_OpenFileCount; ++i)
+    {
+        if(m_Files[i].Written)
         {
-            *pSize = 0;
-            return PetFail;
+            (void) fdatasync(m_Files[i].Fd);
         }
-        const int64_t endPos = static_cast<int64_t>(ftell(cFile));
 
-        *pSize = static_cast<size_t>(endPos - currentPos);
+        (void) close(m_Files[i].Fd);
+    }
+
+    m_OpenFileCount = 0;
+}
+
+int NixCliPet::GetFile(const PetFileHandle file, const bool write) noexcept
+{
+    ::std::lock_guard lock(m_FilesLock);
+
+    OpenFile* cached = nullptr;
+
+    for(uint32_t i = 0; i < m_OpenFileCount; ++i)
+    {
+        if(m_Files[i].File == file)
+        {
+            cached = &m_Files[i];
+            break;
+        }
     }
-    else
+
+    if(cached && (cached->Writable || !write))
     {
-        *pSize = fread(pData, *pSize, 1, cFile);
+        cached->Written |= write;
+        return fcntl(cached->Fd, F_DUPFD_CLOEXEC, 0);
     }
 
-    (void) fclose(cFile);
+    char nameBuffer[12];
+    (void) ::std::snprintf(nameBuffer, sizeof(nameBuffer), "%d", file);
 
-    return PetSuccess;
+    // Never truncate, checkpoints only rewrite the parts of the file that changed.
+    const int fd = open(nameBuffer, write ? O_RDWR | O_CREAT | O_CLOEXEC : O_RDONLY | O_CLOEXEC, 0644);
+
+    if(fd < 0)
+    {
+        return -1;
+    }
+
+    if(cached)
+    {
+        // It was only loaded so far, anyone still reading has a duplicate of the old descriptor.
+        (void) close(cached->Fd);
+        *cached = { file, fd, true, true };
+
+        return fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    }
+
+    //   Out of slots, this is a handful of files at most, so just evict the
+    // oldest one.
+    if(m_OpenFileCount == MaxOpenFiles)
+    {
+        if(m_Files[0].Written)
+        {
+            (void) fdatasync(m_Files[0].Fd);
+        }
+
+        (void) close(m_Files[0].Fd);
+
+        for(uint32_t i = 1; i < MaxOpenFiles; ++i)
+        {
+            m_Files[i - 1] = m_Files[i];
+        }
+
+        --m_OpenFileCount;
+    }
+
+    m_Files[m_OpenFileCount++] = { file, fd, write, write };
+
+    return fcntl(fd, F_DUPFD_CLOEXEC, 0);
 }
 
 // ReSharper disable once CppParameterMayBeConstPtrOrRef
@@ -202,7 +456,26 @@ PetStatus NixCliPet::Sleep(TimeMs_t* const pSleepTime) noexcept
         return PetInvalidArg;
     }
 
-    ::std::this_thread::sleep_for(::std::chrono::milliseconds(sleepTime));
+    timespec request { };
+    request.tv_sec = static_cast<time_t>(sleepTime / 1000);
+    request.tv_nsec = static_cast<long>(sleepTime % 1000) * 1000000L;
+
+    timespec remaining { };
+
+    //   SIGINT and SIGTERM are installed without SA_RESTART, so a signal
+    // interrupts the sleep and Pet AI gets to see the exit straight away.
+    if(nanosleep(&request, &remaining) != 0)
+    {
+        if(errno != EINTR)
+        {
+            return PetFail;
+        }
+
+        const TimeMs_t remainingTime = static_cast<TimeMs_t>(remaining.tv_sec) * 1000 + static_cast<TimeMs_t>(remaining.tv_nsec / 1000000L);
+        *pSleepTime = remainingTime < sleepTime ? sleepTime - remainingTime : 0;
+
+        return PetEarlyWakeup;
+    }
 
     return PetSuccess;
 }
@@ -251,6 +524,7 @@ PetStatus NixCliPet::CreateRenderer(PetRendererHandle* const pOutRendererHandle,
     createData.Version = PET_RENDERER_VERSION;
     createData.Width = FramebufferWidth;
     createData.Height = FramebufferHeight;
+    createData.Flags = PetRendererFlagDepthBuffer;
 
     return m_Callbacks.CreateDefaultRenderer(m_Callbacks.Handle, &createData);
 }
@@ -272,34 +546,55 @@ PetStatus NixCliPet::Present(PetRendererHandle rendererHandle, const PetRenderer
         return PetInvalidArg;
     }
 
-    const PetStatus status = pRendererFunctions->CopyFramebuffer(rendererHandle, m_Framebuffer, sizeof(m_Framebuffer));
+    // Older renderers can't lend us their front buffer, so take a copy of it.
+    if(pRendererFunctions->Version < PET_RENDERER_VERSION_1_5 || !pRendererFunctions->LockFramebuffer || !pRendererFunctions->UnlockFramebuffer)
+    {
+        uint8_t framebuffer[static_cast<size_t>(FramebufferWidth) * FramebufferHeight * 3];
+        const PetStatus status = pRendererFunctions->CopyFramebuffer(rendererHandle, framebuffer, sizeof(framebuffer));
+
+        if(IsStatusError(status))
+        {
+            return status;
+        }
+
+        PrintFramebuffer(framebuffer, static_cast<size_t>(FramebufferWidth) * 3, FramebufferWidth, FramebufferHeight);
+        return PetSuccess;
+    }
+
+    PetFramebufferLock lock {};
+    const PetStatus status = pRendererFunctions->LockFramebuffer(rendererHandle, &lock);
 
     if(IsStatusError(status))
     {
         return status;
     }
 
+    // Only print when there is something new to show.
+    if(lock.Changed)
+    {
+        PrintFramebuffer(lock.pPixels, lock.Stride, lock.Width, lock.Height);
+    }
+
+    return pRendererFunctions->UnlockFramebuffer(rendererHandle);
+}
+
+void NixCliPet::PrintFramebuffer(const uint8_t* const pPixels, const size_t stride, const uint16_t width, const uint16_t height) noexcept
+{
     ::std::putc('\n', stdout);
-    for(uint16_t y = 0; y < FramebufferHeight; ++y)
+    for(uint16_t y = 0; y < height; ++y)
     {
-        for(uint16_t x = 0; x < FramebufferWidth; ++x)
+        const uint8_t* const row = pPixels + stride * static_cast<size_t>(y);
+
+        for(uint16_t x = 0; x < width; ++x)
         {
-            const size_t i0 = (static_cast<size_t>(FramebufferWidth) * static_cast<size_t>(y) + static_cast<size_t>(x)) * 3;
-            // const size_t i1 = (static_cast<size_t>(FramebufferWidth) * static_cast<size_t>(y + 1) + static_cast<size_t>(x)) * 3;
-            const uint8_t r0 = m_Framebuffer[i0 + 0];
-            const uint8_t g0 = m_Framebuffer[i0 + 1];
-            const uint8_t b0 = m_Framebuffer[i0 + 2];
-            // const uint8_t r1 = m_Framebuffer[i1 + 0];
-            // const uint8_t g1 = m_Framebuffer[i1 + 1];
-            // const uint8_t b1 = m_Framebuffer[i1 + 2];
-
-            // ::std::printf("\033[38;2;%d;%d;%d;48;2;%d;%d;%dm\u2580", r0, g0, b0, r1, g1, b1);
+            const uint8_t r0 = row[static_cast<size_t>(x) * 3 + 0];
+            const uint8_t g0 = row[static_cast<size_t>(x) * 3 + 1];
+            const uint8_t b0 = row[static_cast<size_t>(x) * 3 + 2];
+
             ::std::printf("\033[38;2;%d;%d;%dm\u2588", r0, g0, b0);
         }
         ::std::puts("\033[0m");
     }
-
-    return PetSuccess;
 }
 
 static PetStatus CreatePetApp(PetAppHandle* const pOutPetAppHandle, const PetAICallbacks* const pPetAICallbacks)
@@ -330,6 +625,8 @@ static PetStatus DestroyPetApp(const PetAppHandle petAppHandle)
 
     NixCliPet* const pet = NixCliPet::FromHandle(petAppHandle);
 
+    pet->CloseFiles();
+
     delete pet;
 
     return PetSuccess;
@@ -359,6 +656,30 @@ static PetStatus LoadPetState(const PetAppHandle petAppHandle, const PetFileHand
     return pet->LoadPetState(file, offset, pData, pSize);
 }
 
+static PetStatus MapPetState(const PetAppHandle petAppHandle, const PetFileHandle file, const void** const ppData, size_t* const pSize)
+{
+    if(!petAppHandle.Ptr)
+    {
+        return PetInvalidArg;
+    }
+
+    NixCliPet* const pet = NixCliPet::FromHandle(petAppHandle);
+
+    return pet->MapPetState(file, ppData, pSize);
+}
+
+static PetStatus UnmapPetState(const PetAppHandle petAppHandle, const PetFileHandle file, const void* const pData, const size_t size)
+{
+    if(!petAppHandle.Ptr)
+    {
+        return PetInvalidArg;
+    }
+
+    NixCliPet* const pet = NixCliPet::FromHandle(petAppHandle);
+
+    return pet->UnmapPetState(file, pData, size);
+}
+
 static PetStatus Sleep(const PetAppHandle petAppHandle, TimeMs_t* const pSleepTime)
 {
     if(!petAppHandle.Ptr)
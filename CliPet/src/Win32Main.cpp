@@ -3,6 +3,7 @@
 #include <new>
 #include <cstdlib>
 #include <cstdio>
+#include <cerrno>
 #include <thread>
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
@@ -63,7 +64,8 @@ int main(int argCount, char* args[])
     (void) args;
 
     PetFunctions petFunctions {};
-    petFunctions.Version = PET_AI_VERSION;
+    // Present hasn't been made safe to call from the render thread here, so stay on 1.5.
+    petFunctions.Version = PET_AI_VERSION_1_5;
     petFunctions.CreatePetApp = CreatePetApp;
     petFunctions.DestroyPetApp = DestroyPetApp;
     petFunctions.SavePetState = SavePetState;
@@ -112,64 +114,99 @@ PetStatus Win32CliPet::SavePetState(const PetFileHandle file, const size_t offse
     char nameBuffer[6];
     (void) _itoa(file, nameBuffer, 10);
 
+    // Checkpoints write deltas into the existing file, so only create it if it is missing.
     FILE* cFile;
-    errno_t err = fopen_s(&cFile, nameBuffer, "wb+");
-    if(!err)
+    errno_t err = fopen_s(&cFile, nameBuffer, "r+b");
+
+    if(err == ENOENT)
     {
-        return PetFail;
+        err = fopen_s(&cFile, nameBuffer, "w+b");
     }
 
-    if(!_fseeki64(cFile, static_cast<int64_t>(offset), SEEK_SET))
+    if(err)
     {
         return PetFail;
     }
 
-    (void) fwrite(pData, 1, size, cFile);
+    PetStatus status = PetSuccess;
 
-    (void) fclose(cFile);
+    if(_fseeki64(cFile, static_cast<int64_t>(offset), SEEK_SET) != 0)
+    {
+        status = PetFail;
+    }
+    else if(fwrite(pData, 1, size, cFile) != size)
+    {
+        status = PetFail;
+    }
 
-    return PetSuccess;
+    if(fclose(cFile) != 0)
+    {
+        status = PetFail;
+    }
+
+    return status;
 }
 
 PetStatus Win32CliPet::LoadPetState(const PetFileHandle file, const size_t offset, void* const pData, size_t* const pSize) noexcept
 {
+    if(!pSize)
+    {
+        return PetInvalidArg;
+    }
+
     char nameBuffer[6];
     (void) _itoa(file, nameBuffer, 10);
 
     FILE* cFile;
-    errno_t err = fopen_s(&cFile, nameBuffer, "wb+");
-    if(!err)
-    {
-        *pSize = 0;
-        return PetFail;
-    }
+    const errno_t err = fopen_s(&cFile, nameBuffer, "rb");
 
-    if(!_fseeki64(cFile, static_cast<int64_t>(offset), SEEK_SET))
+    if(err)
     {
         *pSize = 0;
-        return PetFail;
+        // A file that doesn't exist is just empty.
+        return err == ENOENT ? PetSuccess : PetFail;
     }
 
     if(!pData)
     {
-        const int64_t currentPos = _ftelli64(cFile);
-        if(!_fseeki64(cFile, 0, SEEK_END))
+        if(_fseeki64(cFile, 0, SEEK_END) != 0)
         {
+            (void) fclose(cFile);
             *pSize = 0;
             return PetFail;
         }
+
         const int64_t endPos = _ftelli64(cFile);
 
-        *pSize = static_cast<size_t>(endPos - currentPos);
+        (void) fclose(cFile);
+
+        if(endPos < 0)
+        {
+            *pSize = 0;
+            return PetFail;
+        }
+
+        const size_t fileSize = static_cast<size_t>(endPos);
+        *pSize = offset < fileSize ? fileSize - offset : 0;
+
+        return PetSuccess;
     }
-    else
+
+    if(_fseeki64(cFile, static_cast<int64_t>(offset), SEEK_SET) != 0)
     {
-        *pSize = fread_s(pData, *pSize, 1, *pSize, cFile);
+        (void) fclose(cFile);
+        *pSize = 0;
+        return PetFail;
     }
 
+    const size_t size = *pSize;
+    *pSize = fread_s(pData, size, 1, size, cFile);
+
+    const PetStatus status = ferror(cFile) ? PetFail : PetSuccess;
+
     (void) fclose(cFile);
 
-    return PetSuccess;
+    return status;
 }
 
 // ReSharper disable once CppParameterMayBeConstPtrOrRef
@@ -0,0 +1,148 @@
+#include "BehaviorTree.hpp"
+#include "Blackboard.hpp"
+#include "PetManager.hpp"
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+
+namespace {
+
+using ActionSignature = BehaviorTreeActionResult(PetManager&, const BehaviorTreeActionNode&, Blackboard&, float);
+using SelectorSignature = ::std::int32_t(PetManager&, const BehaviorTreeSelectorNode&, Blackboard&);
+using ContinuationSignature = bool(PetManager&, const BehaviorTreeRepeatNode&, Blackboard&);
+
+constexpr ::std::uint32_t IterationCount = 10'000'000;
+
+BlackboardKey g_CounterKey;
+
+BehaviorTreeActionResult CountAction(PetManager&, const BehaviorTreeActionNode&, Blackboard& blackboard, float) noexcept
+{
+    ++*blackboard.GetT<::std::int32_t>(g_CounterKey);
+    return BehaviorTreeActionResult::Finish();
+}
+
+::std::int32_t SelectAlternating(PetManager&, const BehaviorTreeSelectorNode&, Blackboard& blackboard) noexcept
+{
+    return *blackboard.GetT<::std::int32_t>(g_CounterKey) & 1;
+}
+
+bool Continue(PetManager&, const BehaviorTreeRepeatNode&, Blackboard&) noexcept
+{
+    return true;
+}
+
+/**
+ *   The same shape as the pet tree, repeat -> selector -> (sequence of
+ * two actions, action).
+ */
+struct BenchmarkTree final
+{
+    BehaviorTreeActionNode A;
+    BehaviorTreeActionNode B;
+    BehaviorTreeActionNode C;
+
+    ::std::array<BehaviorTreeNode*, 2> SequenceChildren;
+    BehaviorTreeSequenceNode Sequence;
+
+    ::std::array<BehaviorTreeNode*, 2> SelectorChildren;
+    BehaviorTreeSelectorNode Selector;
+
+    BehaviorTreeRepeatNode Root;
+
+    BenchmarkTree(BlackboardKeyManager& keyManager, const BehaviorTreeActionNode::ActionHandler action, const BehaviorTreeSelectorNode::SelectorFunc selector, const BehaviorTreeRepeatNode::ContinuationFunc continuation) noexcept
+        : A(action)
+        , B(action)
+        , C(action)
+        , SequenceChildren { &A, &B }
+        , Sequence(static_cast<::std::uint32_t>(SequenceChildren.size()), SequenceChildren.data(), keyManager.CalculateKey(CSTR("Benchmark.Sequence"), sizeof(BehaviorTreeSequenceNode::SequenceKeyT)))
+        , SelectorChildren { &Sequence, &C }
+        , Selector(static_cast<::std::uint32_t>(SelectorChildren.size()), SelectorChildren.data(), selector, keyManager.CalculateKey(CSTR("Benchmark.Selector"), sizeof(BehaviorTreeSelectorNode::SelectorKeyT)))
+        , Root(&Selector, continuation)
+    { }
+};
+
+template<typename FuncT>
+double MeasureNs(FuncT&& func) noexcept
+{
+    const auto start = ::std::chrono::steady_clock::now();
+    func();
+    const auto end = ::std::chrono::steady_clock::now();
+    return static_cast<double>(::std::chrono::duration_cast<::std::chrono::nanoseconds>(end - start).count()) / IterationCount;
+}
+
+/**
+ * Calls a single action handler back to back, this is the raw dispatch cost.
+ */
+template<typename HandlerT>
+double BenchmarkDispatch(const HandlerT& handler, PetManager& petManager, const BehaviorTreeActionNode& node, Blackboard& blackboard) noexcept
+{
+    return MeasureNs([&]()
+    {
+        for(::std::uint32_t i = 0; i < IterationCount; ++i)
+        {
+            handler(petManager, node, blackboard, 0.016f);
+        }
+    });
+}
+
+/**
+ * Ticks a whole tree, this is the cost per Tick the pets actually pay.
+ */
+double BenchmarkTick(BlackboardKeyManager& keyManager, BenchmarkTree& tree, PetManager& petManager) noexcept
+{
+    BlackboardLayout layout;
+    (void) layout.Init(keyManager);
+    Blackboard blackboard(layout);
+    BehaviorTreeExecutor executor(&tree.Root, &blackboard, &petManager);
+
+    return MeasureNs([&]()
+    {
+        for(::std::uint32_t i = 0; i < IterationCount; ++i)
+        {
+            executor.Tick(0.016f);
+        }
+    });
+}
+
+}
+
+int main()
+{
+    BlackboardKeyManager keyManager;
+    g_CounterKey = keyManager.CalculateKey(CSTR("Benchmark.Counter"), sizeof(::std::int32_t));
+
+    PetManager petManager;
+    BlackboardLayout layout;
+    (void) layout.Init(keyManager);
+    Blackboard blackboard(layout);
+    BehaviorTreeActionNode node;
+
+    const ::std::function<ActionSignature> stdAction(CountAction);
+    const ::std::function<SelectorSignature> stdSelector(SelectAlternating);
+    const ::std::function<ContinuationSignature> stdContinuation(Continue);
+
+    ::std::printf("Dispatch (ns per call)\n");
+    ::std::printf("  std::function:          %6.2f\n", BenchmarkDispatch(stdAction, petManager, node, blackboard));
+    ::std::printf("  FunctionRef (pointer):  %6.2f\n", BenchmarkDispatch(BehaviorTreeActionNode::ActionHandler(CountAction), petManager, node, blackboard));
+    ::std::printf("  FunctionRef (Bind):     %6.2f\n", BenchmarkDispatch(BehaviorTreeActionNode::ActionHandler::Bind<CountAction>(), petManager, node, blackboard));
+
+    //   The nodes can no longer hold a ::std::function, so the old handlers
+    // are reached through a FunctionRef to one. That adds a single direct
+    // call on top of what the old nodes paid.
+    BenchmarkTree stdTree(keyManager, stdAction, stdSelector, stdContinuation);
+    BenchmarkTree pointerTree(keyManager, CountAction, SelectAlternating, Continue);
+    BenchmarkTree boundTree(
+        keyManager,
+        BehaviorTreeActionNode::ActionHandler::Bind<CountAction>(),
+        BehaviorTreeSelectorNode::SelectorFunc::Bind<SelectAlternating>(),
+        BehaviorTreeRepeatNode::ContinuationFunc::Bind<Continue>()
+    );
+
+    ::std::printf("Tick (ns per tick)\n");
+    ::std::printf("  std::function:          %6.2f\n", BenchmarkTick(keyManager, stdTree, petManager));
+    ::std::printf("  FunctionRef (pointer):  %6.2f\n", BenchmarkTick(keyManager, pointerTree, petManager));
+    ::std::printf("  FunctionRef (Bind):     %6.2f\n", BenchmarkTick(keyManager, boundTree, petManager));
+
+    return 0;
+}
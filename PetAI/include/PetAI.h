@@ -58,7 +58,7 @@ typedef uint32_t PetStatus;
 #if defined(PET_NO_SIZED_ENUMS)
 #define PetSuccess (0u)
 #define PetNoMoreItems (1u)
-#define PetEarlyWakeup (1u)
+#define PetEarlyWakeup (2u)
 #define PetFail (0xC0000001u)
 #define PetInvalidArg (0xC0000002u)
 #define PetNotImplemented (0xC0000003u)
@@ -87,10 +87,21 @@ inline bool IsStatusError(const PetStatus status)
 }
 
 #define PET_AI_VERSION_1_0 10
-#define PET_AI_VERSION PET_AI_VERSION_1_0
+#define PET_AI_VERSION_1_1 11
+#define PET_AI_VERSION_1_2 12
+#define PET_AI_VERSION_1_3 13
+#define PET_AI_VERSION_1_4 14
+#define PET_AI_VERSION_1_5 15
+#define PET_AI_VERSION_1_6 16
+#define PET_AI_VERSION PET_AI_VERSION_1_6
 
 #define PET_RENDERER_VERSION_1_0 10
-#define PET_RENDERER_VERSION PET_AI_VERSION_1_0
+#define PET_RENDERER_VERSION_1_1 11
+#define PET_RENDERER_VERSION_1_2 12
+#define PET_RENDERER_VERSION_1_3 13
+#define PET_RENDERER_VERSION_1_4 14
+#define PET_RENDERER_VERSION_1_5 15
+#define PET_RENDERER_VERSION PET_RENDERER_VERSION_1_5
 
 typedef struct PetAIHandle {
     // ReSharper disable once CppInconsistentNaming
@@ -154,9 +165,27 @@ typedef PetStatus DestroyPetApp_f(PetAppHandle petAppHandle);
  */
 typedef uint16_t PetFileHandle;
 
+/**
+ *   Writes size bytes at offset into file, growing the file if needed.
+ *
+ *   For applications built against PET_AI_VERSION_1_5 or later this is
+ * called from a thread of Pet AI's own, but never from two threads at
+ * once.
+ */
 typedef PetStatus SavePetState_f(PetAppHandle petAppHandle, PetFileHandle file, size_t offset, const void* pData, const size_t size);
 typedef PetStatus LoadPetState_f(PetAppHandle petAppHandle, PetFileHandle file, size_t offset, void* pData, size_t* pSize);
 
+/**
+ *   Gives Pet AI read only access to the whole of a file, without
+ * copying it, usually by memory mapping it. The memory has to stay
+ * valid until UnmapPetState is called with it.
+ *
+ *   A file that doesn't exist is reported as a size of 0. If this
+ * returns PetNotImplemented Pet AI falls back to LoadPetState.
+ */
+typedef PetStatus MapPetState_f(PetAppHandle petAppHandle, PetFileHandle file, const void** ppData, size_t* pSize);
+typedef PetStatus UnmapPetState_f(PetAppHandle petAppHandle, PetFileHandle file, const void* pData, size_t size);
+
 /**
  *   This is used to tell the application that Pet AI has no tasks to
  * do for a given period of time, and thus would like to sleep. It is
@@ -167,10 +196,14 @@ typedef PetStatus LoadPetState_f(PetAppHandle petAppHandle, PetFileHandle file,
  * though this might cause some slippage in how long a task was
  * supposed to take.
  *
+ *   The application can wake Pet AI up before the time has passed (for
+ * example when it has input to handle) by returning PetEarlyWakeup,
+ * Pet AI will then start the next frame straight away.
+ *
  * @param petAppHandle The state object of the application.
  * @param pSleepTime A pointer to how much time to sleep, and to store
  *   how much time was actually slept.
- * @return A status code.
+ * @return A status code, PetEarlyWakeup if the sleep was cut short.
  */
 typedef PetStatus Sleep_f(PetAppHandle petAppHandle, TimeMs_t* pSleepTime);
 /**
@@ -209,7 +242,11 @@ typedef PetStatus CreatePet_f(PetAppHandle petAppHandle, const CreatePetData* pC
 typedef enum PetEventType
 {
     Unknown = 0,
-    Birth = 1
+    Birth = 1,
+    /**
+     * @since PET_AI_VERSION_1_5
+     */
+    SaveComplete = 2
 } PetEventType;
 
 typedef struct PetEventBirth
@@ -219,9 +256,21 @@ typedef struct PetEventBirth
     PetHandle ChildPet;
 } PetEventBirth;
 
+/**
+ *   Sent once a checkpoint of the pets has been written out with
+ * SavePetState, PetHandle is null for this event.
+ */
+typedef struct PetEventSaveComplete
+{
+    PetFileHandle File;
+    PetStatus Status;
+    uint64_t BytesWritten;
+} PetEventSaveComplete;
+
 typedef union PetEventUnion
 {
     PetEventBirth* Birth;
+    PetEventSaveComplete* SaveComplete;
 } PetEventTypes;
 
 typedef struct PetEventData
@@ -236,6 +285,11 @@ typedef PetStatus PetEvent_f(PetAppHandle petAppHandle, const PetEventData* pPet
 
 typedef PetStatus GetScreenSize_f(PetRendererHandle rendererHandle, uint16_t* pWidth, uint16_t* pHeight);
 
+/**
+ *   Draws with a greater depth are in front of draws with a lower
+ * depth, draws with the same depth are layered in the order they were
+ * made.
+ */
 typedef PetStatus ClearScreen_f(PetRendererHandle rendererHandle, uint8_t r, uint8_t g, uint8_t b, uint16_t depth);
 
 typedef struct ScreenPoint
@@ -271,6 +325,131 @@ typedef PetStatus DrawTriangle_f(PetRendererHandle rendererHandle, const DrawTri
 
 typedef PetStatus CopyFramebuffer_f(PetRendererHandle rendererHandle, uint8_t* pOutFramebuffer, size_t size);
 
+typedef enum PetDrawCommandType
+{
+    PetDrawCommandRectangle = 1,
+    PetDrawCommandTriangle = 2
+} PetDrawCommandType;
+
+typedef struct PetDrawCommand
+{
+    /**
+     * A PetDrawCommandType.
+     */
+    uint32_t Type;
+    union
+    {
+        DrawRectData Rectangle;
+        DrawTriangleData Triangle;
+    } Data;
+} PetDrawCommand;
+
+/**
+ *   Starts recording draws. Until EndDrawCommands is called, ClearScreen,
+ * DrawRectangle and DrawTriangle only append to a command buffer, and a
+ * ClearScreen throws away everything recorded before it.
+ *
+ * @since PET_RENDERER_VERSION_1_2
+ */
+typedef PetStatus BeginDrawCommands_f(PetRendererHandle rendererHandle);
+
+/**
+ *   Appends commandCount draws in one call. Outside of
+ * BeginDrawCommands/EndDrawCommands they are drawn straight away, in the
+ * same way EndDrawCommands draws.
+ *
+ * @since PET_RENDERER_VERSION_1_2
+ */
+typedef PetStatus SubmitDrawCommands_f(PetRendererHandle rendererHandle, const PetDrawCommand* pCommands, uint32_t commandCount);
+
+/**
+ *   Draws everything recorded since BeginDrawCommands, back to front by
+ * depth. Draws that are completely hidden behind a rectangle in front of
+ * them are skipped.
+ *
+ * @since PET_RENDERER_VERSION_1_2
+ */
+typedef PetStatus EndDrawCommands_f(PetRendererHandle rendererHandle);
+
+/**
+ * A rectangle of pixels, X and Y are the top left corner.
+ */
+typedef struct ScreenRect
+{
+    uint16_t X;
+    uint16_t Y;
+    uint16_t Width;
+    uint16_t Height;
+} ScreenRect;
+
+/**
+ *   Copies only the parts of the framebuffer that were drawn to since
+ * the last call. pOutFramebuffer has to still hold the framebuffer from
+ * the last call, the first call copies everything.
+ *
+ * @param pOutRects Optional, receives up to *pRectCount of the rects
+ *   that were copied. If there are more than that, the last one covers
+ *   the rest.
+ * @param pRectCount In the capacity of pOutRects, out the number of
+ *   rects written to it.
+ * @return PetNoMoreItems if nothing changed, so there is nothing new to
+ *   present.
+ *
+ * @since PET_RENDERER_VERSION_1_1
+ */
+typedef PetStatus CopyDirtyFramebuffer_f(PetRendererHandle rendererHandle, uint8_t* pOutFramebuffer, size_t size, ScreenRect* pOutRects, uint32_t* pRectCount);
+
+typedef enum PetPixelFormat
+{
+    /**
+     * 3 bytes per pixel, R then G then B.
+     */
+    PetPixelFormatRGB24 = 1
+} PetPixelFormat;
+
+typedef struct PetFramebufferLock
+{
+    const uint8_t* pPixels;
+    /**
+     * The number of bytes from the start of one row to the next.
+     */
+    uint32_t Stride;
+    /**
+     * A PetPixelFormat.
+     */
+    uint32_t Format;
+    uint16_t Width;
+    uint16_t Height;
+    /**
+     *   Non-zero if anything was drawn since the last lock, the first lock
+     * always has.
+     */
+    uint32_t Changed;
+} PetFramebufferLock;
+
+/**
+ *   Gives read only access to the front buffer, which holds everything
+ * drawn up to this call. Draws made while it is locked go to the back
+ * buffer, and show up in the next lock. Only the parts that changed are
+ * copied to the front buffer, the same as with CopyDirtyFramebuffer, so
+ * use one or the other.
+ *
+ * @return PetFail if the framebuffer is already locked.
+ *
+ * @since PET_RENDERER_VERSION_1_5
+ */
+typedef PetStatus LockFramebuffer_f(PetRendererHandle rendererHandle, PetFramebufferLock* pLock);
+
+/**
+ *   Ends a LockFramebuffer, the pointer it returned can't be used
+ * afterwards.
+ *
+ * @return PetFail if the framebuffer isn't locked.
+ *
+ * @since PET_RENDERER_VERSION_1_5
+ */
+typedef PetStatus UnlockFramebuffer_f(PetRendererHandle rendererHandle);
+
 typedef struct PetRendererFunctions
 {
     uint32_t Version;
@@ -279,16 +458,46 @@ typedef struct PetRendererFunctions
     DrawRectangle_f* DrawRectangle;
     DrawTriangle_f* DrawTriangle;
     CopyFramebuffer_f* CopyFramebuffer;
+    /**
+     * @since PET_RENDERER_VERSION_1_1
+     */
+    CopyDirtyFramebuffer_f* CopyDirtyFramebuffer;
+    /**
+     * @since PET_RENDERER_VERSION_1_2
+     */
+    BeginDrawCommands_f* BeginDrawCommands;
+    SubmitDrawCommands_f* SubmitDrawCommands;
+    EndDrawCommands_f* EndDrawCommands;
+    /**
+     * @since PET_RENDERER_VERSION_1_5
+     */
+    LockFramebuffer_f* LockFramebuffer;
+    UnlockFramebuffer_f* UnlockFramebuffer;
 } PetRendererFunctions;
 
 typedef PetStatus CreateRenderer_f(PetAppHandle petAppHandle, PetRendererHandle* pOutRendererHandle, PetRendererFunctions* pOutRendererFunctions);
 typedef PetStatus DestroyRenderer_f(PetAppHandle petAppHandle, PetRendererHandle rendererHandle);
 
+/**
+ *   Shows the frame the renderer has drawn.
+ *
+ *   For applications built against PET_AI_VERSION_1_6 or later this is
+ * called from a render thread of Pet AI's own, while the pets keep
+ * ticking, and that thread is the only one that uses the renderer once
+ * it has been created.
+ */
 typedef PetStatus Present_f(PetAppHandle petAppHandle, PetRendererHandle rendererHandle, const PetRendererFunctions* pRendererFunctions);
 
 typedef PetStatus NotifyExit_f(PetAIHandle petAIHandle);
 typedef PetStatus EnumPets_f(PetAIHandle petAIHandle, PetHandle* pPetHandle, uint32_t index);
 
+/**
+ *   Gets the state the application gave CreatePetAI for the pet. Pet AI
+ * doesn't save application state, so the pets it restores from its
+ * last save on startup have a null state and a size of 0, and never
+ * go through CreatePet. An application that keeps state per pet has to
+ * save and restore it on its own.
+ */
 typedef PetStatus GetPetState_f(PetAIHandle petAIHandle, PetHandle petHandle, void** pState, uint32_t* pSize);
 
 typedef struct CreatePetAIData
@@ -302,6 +511,23 @@ typedef struct CreatePetAIData
 
 typedef PetStatus CreatePetAI_f(PetAIHandle petAIHandle, const CreatePetAIData* pCreatePetData, PetHandle* pPetHandle);
 
+/**
+ *   Removes a pet, petHandle is invalid afterwards. The pet's state is
+ * owned by the application, and is not freed.
+ */
+typedef PetStatus DestroyPetAI_f(PetAIHandle petAIHandle, PetHandle petHandle);
+
+typedef enum PetRendererFlags
+{
+    PetRendererFlagNone = 0,
+    /**
+     *   Keep a 16 bit depth per pixel, so that draws can be made in any
+     * order. Without it draws are layered in the order they were made,
+     * unless they were recorded with BeginDrawCommands.
+     */
+    PetRendererFlagDepthBuffer = 1
+} PetRendererFlags;
+
 typedef struct CreateDefaultPetRenderer
 {
     PetRendererHandle* pOutRendererHandle;
@@ -309,11 +535,47 @@ typedef struct CreateDefaultPetRenderer
     uint32_t Version;
     uint16_t Width;
     uint16_t Height;
+    /**
+     * PetRendererFlags.
+     *
+     * @since PET_RENDERER_VERSION_1_3
+     */
+    uint32_t Flags;
+    /**
+     *   The number of threads that rasterize, including the one drawing.
+     * With more than 1 the screen is split into tiles that are drawn in
+     * parallel, and draws are held back until the framebuffer is copied.
+     * The pixels are the same either way.
+     *
+     * @since PET_RENDERER_VERSION_1_4
+     */
+    uint32_t ThreadCount;
 } CreateDefaultPetRenderer;
 
 typedef PetStatus CreateDefaultRenderer_f(PetAIHandle petAIHandle, const CreateDefaultPetRenderer* pCreateDefaultRenderer);
 typedef PetStatus DestroyDefaultRenderer_f(PetAIHandle petAIHandle, PetRendererHandle rendererHandle);
 
+/**
+ *   How the main loop has been spending its time. A frame is busy
+ * while Pet AI is updating the application, ticking the pets and
+ * presenting, and idle while it is asleep in Sleep. With the render
+ * thread (see Present_f) presenting only takes capturing the scene.
+ */
+typedef struct PetFrameStats
+{
+    uint64_t FrameCount;
+    TimeMs_t LastBusyTime;
+    TimeMs_t LastIdleTime;
+    TimeMs_t TotalBusyTime;
+    TimeMs_t TotalIdleTime;
+    /**
+     * The number of sleeps that returned PetEarlyWakeup.
+     */
+    uint64_t EarlyWakeupCount;
+} PetFrameStats;
+
+typedef PetStatus GetFrameStats_f(PetAIHandle petAIHandle, PetFrameStats* pFrameStats);
+
 typedef struct PetAICallbacks
 {
     PetAIHandle Handle;
@@ -323,6 +585,14 @@ typedef struct PetAICallbacks
     CreatePetAI_f* CreatePet;
     CreateDefaultRenderer_f* CreateDefaultRenderer;
     DestroyDefaultRenderer_f* DestroyDefaultRenderer;
+    /**
+     * @since PET_AI_VERSION_1_2
+     */
+    GetFrameStats_f* GetFrameStats;
+    /**
+     * @since PET_AI_VERSION_1_3
+     */
+    DestroyPetAI_f* DestroyPet;
 } PetAICallbacks;
 
 typedef struct PetFunctions
@@ -347,6 +617,38 @@ typedef struct PetFunctions
     DestroyRenderer_f* DestroyRenderer;
 
     Present_f* Present;
+
+    /**
+     *   The number of threads used to tick the pets, including the thread
+     * that called RunPetAI. 0 and 1 both tick every pet on the thread
+     * that called RunPetAI.
+     *
+     *   When this is greater than 1, the behavior tree handlers of
+     * different pets will run at the same time, see
+     * PetManager::TickPets for what they are allowed to touch.
+     *
+     * @since PET_AI_VERSION_1_1
+     */
+    uint32_t TickThreadCount;
+
+    /**
+     *   How many times per second Present should be called. 0 uses the
+     * default of once per second.
+     *
+     *   Between presents Pet AI only wakes up when a pet has work to do,
+     * or the application interrupts a Sleep with PetEarlyWakeup.
+     *
+     * @since PET_AI_VERSION_1_2
+     */
+    uint32_t TargetPresentRate;
+
+    /**
+     * Optional, both or neither have to be set.
+     *
+     * @since PET_AI_VERSION_1_4
+     */
+    MapPetState_f* MapPetState;
+    UnmapPetState_f* UnmapPetState;
 } PetFunctions;
 
 PetStatus TAU_UTILS_LIB InitPetAI(const PetFunctions* const pFunctions);
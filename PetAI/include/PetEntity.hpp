@@ -15,11 +15,17 @@ public:
         return static_cast<PetEntity*>(handle.Ptr);
     }
 public:
+    /**
+     * @param blackboardStorage layout.DataSize() bytes for the blackboard, see Blackboard.
+     */
     PetEntity(
         void* const state,
         const ::std::uint32_t stateSize,
-        const BlackboardKeyManager& keyManager,
+        const BlackboardLayout& layout,
+        const ::std::uint32_t columnSlot,
+        void* const blackboardStorage,
         BehaviorTreeRepeatNode* const root,
+        const CompiledBehaviorTree* const compiledTree,
         PetManager* const petManager
     ) noexcept
         : m_ParentMale(nullptr)
@@ -27,8 +33,9 @@ public:
         , m_Gender(PetGenderNeuter)
         , m_State(state)
         , m_StateSize(stateSize)
-        , m_Blackboard(keyManager)
-        , m_BehaviorTreeExecutor(root, &m_Blackboard, petManager)
+        , m_Blackboard(layout, columnSlot, blackboardStorage)
+        , m_BehaviorTreeExecutor(root, compiledTree, &m_Blackboard, petManager)
+        , m_LastTickTime(0)
     { }
 
     [[nodiscard]]       PetEntity*& ParentMale()       noexcept { return m_ParentMale; }
@@ -44,6 +51,12 @@ public:
     [[nodiscard]] ::std::uint32_t StateSize() const noexcept { return m_StateSize; }
     [[nodiscard]] ::Blackboard& Blackboard() noexcept { return m_Blackboard; }
     [[nodiscard]] ::BehaviorTreeExecutor& BehaviorTreeExecutor() noexcept { return m_BehaviorTreeExecutor; }
+
+    /**
+     * The PetManager tick time (in microseconds) this pet was last ticked at.
+     */
+    [[nodiscard]] ::std::uint64_t& LastTickTime()       noexcept { return m_LastTickTime; }
+    [[nodiscard]] ::std::uint64_t  LastTickTime() const noexcept { return m_LastTickTime; }
 private:
     PetEntity* m_ParentMale;
     PetEntity* m_ParentFemale;
@@ -52,4 +65,5 @@ private:
     ::std::uint32_t m_StateSize;
     ::Blackboard m_Blackboard;
     ::BehaviorTreeExecutor m_BehaviorTreeExecutor;
+    ::std::uint64_t m_LastTickTime;
 };
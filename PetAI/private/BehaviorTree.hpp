@@ -1,9 +1,9 @@
 #pragma once
 
 #include <cstdint>
-#include <functional>
 #include "Objects.hpp"
 #include "Blackboard.hpp"
+#include "FunctionRef.hpp"
 
 class BehaviorTreeSequenceNode;
 class BehaviorTreeSelectorNode;
@@ -11,15 +11,19 @@ class BehaviorTreeRepeatNode;
 class BehaviorTreeActionNode;
 
 class BehaviorTreeExecutor;
+class CompiledBehaviorTree;
 
 class PetManager;
 
 class BehaviorTreeNode
 {
-    DEFAULT_CONSTRUCT_PO(BehaviorTreeNode);
     DEFAULT_CM_PO(BehaviorTreeNode);
     DEFAULT_DESTRUCT_VI(BehaviorTreeNode);
 protected:
+    BehaviorTreeNode() noexcept
+        : BehaviorTreeNode(nullptr)
+    { }
+
     BehaviorTreeNode(BehaviorTreeNode* const parent) noexcept
         : m_Parent(parent)
         , m_StateIndex(-1)
@@ -133,7 +137,7 @@ class BehaviorTreeSelectorNode : public BehaviorTreeContainerNode
     DEFAULT_CM_PU(BehaviorTreeSelectorNode);
     DEFAULT_DESTRUCT_O(BehaviorTreeSelectorNode);
 public:
-    using SelectorFunc = ::std::function<::std::int32_t(PetManager&, const BehaviorTreeSelectorNode&, Blackboard&)>;
+    using SelectorFunc = FunctionRef<::std::int32_t(PetManager&, const BehaviorTreeSelectorNode&, Blackboard&)>;
     using SelectorKeyT = bool;
 public:
     BehaviorTreeSelectorNode(
@@ -175,7 +179,7 @@ class BehaviorTreeRepeatNode : public BehaviorTreeNode
     DEFAULT_CM_PU(BehaviorTreeRepeatNode);
     DEFAULT_DESTRUCT_O(BehaviorTreeRepeatNode);
 public:
-    using ContinuationFunc = ::std::function<bool(PetManager&, const BehaviorTreeRepeatNode&, Blackboard&)>;
+    using ContinuationFunc = FunctionRef<bool(PetManager&, const BehaviorTreeRepeatNode&, Blackboard&)>;
 public:
     BehaviorTreeRepeatNode(
         BehaviorTreeNode* const child,
@@ -209,19 +213,109 @@ private:
     ContinuationFunc m_Continuation;
 };
 
+/**
+ *   What an action handler wants the executor to do after it has run.
+ *
+ *   Running re-runs the action on the next tick, Finished moves on to the
+ * next node. Suspended works like Running, except that the pet does not
+ * need to be ticked again until the given time has passed. When the pet
+ * is woken up the action runs again, with a deltaTime covering all the
+ * time it slept through, so the action has to re-check its own state
+ * instead of assuming the wait is over. Executors that are ticked
+ * without a scheduler (see PetManager::TickPets) treat Suspended exactly
+ * like Running.
+ */
+class BehaviorTreeActionResult final
+{
+    DEFAULT_CM_PUC(BehaviorTreeActionResult);
+    DEFAULT_DESTRUCT(BehaviorTreeActionResult);
+public:
+    enum Status : ::std::uint8_t
+    {
+        Running = 0,
+        Finished,
+        Suspended
+    };
+public:
+    /**
+     * Same as Continue().
+     */
+    constexpr BehaviorTreeActionResult() noexcept
+        : BehaviorTreeActionResult(Running, 0)
+    { }
+
+    [[nodiscard]] static constexpr BehaviorTreeActionResult Continue() noexcept { return BehaviorTreeActionResult(Running, 0); }
+    [[nodiscard]] static constexpr BehaviorTreeActionResult Finish() noexcept { return BehaviorTreeActionResult(Finished, 0); }
+
+    /**
+     * @param milliseconds How long the pet can be left alone, 0 behaves
+     *   like Continue().
+     */
+    [[nodiscard]] static constexpr BehaviorTreeActionResult SuspendFor(const ::std::uint32_t milliseconds) noexcept
+    {
+        return BehaviorTreeActionResult(milliseconds > 0 ? Suspended : Running, milliseconds);
+    }
+
+    [[nodiscard]] constexpr Status ResultStatus() const noexcept { return m_Status; }
+    [[nodiscard]] constexpr ::std::uint32_t SuspendTime() const noexcept { return m_SuspendTime; }
+private:
+    constexpr BehaviorTreeActionResult(const Status status, const ::std::uint32_t suspendTime) noexcept
+        : m_Status(status)
+        , m_SuspendTime(suspendTime)
+    { }
+private:
+    Status m_Status;
+    ::std::uint32_t m_SuspendTime;
+};
+
+/**
+ *   A group of pets that are all waiting on the same action node. Entry
+ * i of every array belongs to the same pet.
+ */
+struct BehaviorTreeActionBatch final
+{
+    ::std::uint32_t Count;
+    Blackboard* const* Blackboards;
+    /**
+     *   The BlackboardColumns slot of each pet, see Blackboard::ColumnSlot.
+     * Handlers writing columns through these call Blackboard::MarkDirty.
+     */
+    const ::std::uint32_t* ColumnSlots;
+    const float* DeltaTimes;
+    /**
+     * Filled in by the handler.
+     */
+    BehaviorTreeActionResult* Results;
+};
+
 class BehaviorTreeActionNode : public BehaviorTreeNode
 {
     DEFAULT_CONSTRUCT_PU(BehaviorTreeActionNode);
     DEFAULT_CM_PU(BehaviorTreeActionNode);
     DEFAULT_DESTRUCT_O(BehaviorTreeActionNode);
 public:
-    using ActionHandler = ::std::function<bool(PetManager&, const BehaviorTreeActionNode&, Blackboard&, float deltaTime)>;
+    using ActionHandler = FunctionRef<BehaviorTreeActionResult(PetManager&, const BehaviorTreeActionNode&, Blackboard&, float deltaTime)>;
+    /**
+     *   Runs the action for a whole batch of pets at once. This must
+     * behave exactly like calling the regular handler for each pet in
+     * turn, it only exists so that the work can be done a column at a
+     * time.
+     */
+    using BatchActionHandler = FunctionRef<void(PetManager&, const BehaviorTreeActionNode&, const BehaviorTreeActionBatch& batch)>;
 public:
     BehaviorTreeActionNode(
         const ActionHandler& handler
+    ) noexcept
+        : BehaviorTreeActionNode(handler, nullptr)
+    { }
+
+    BehaviorTreeActionNode(
+        const ActionHandler& handler,
+        const BatchActionHandler& batchHandler
     ) noexcept
         : BehaviorTreeNode()
         , m_Handler(handler)
+        , m_BatchHandler(batchHandler)
     { }
 
     [[nodiscard]]       BehaviorTreeActionNode* AsAction()       noexcept override { return this; }
@@ -231,8 +325,12 @@ public:
     
     [[nodiscard]]       ActionHandler& Handler()       noexcept { return m_Handler; }
     [[nodiscard]] const ActionHandler& Handler() const noexcept { return m_Handler; }
+
+    [[nodiscard]]       BatchActionHandler& BatchHandler()       noexcept { return m_BatchHandler; }
+    [[nodiscard]] const BatchActionHandler& BatchHandler() const noexcept { return m_BatchHandler; }
 private:
     ActionHandler m_Handler;
+    BatchActionHandler m_BatchHandler;
 };
 
 class BehaviorTreeExecutor
@@ -240,21 +338,99 @@ class BehaviorTreeExecutor
     DEFAULT_DESTRUCT(BehaviorTreeExecutor);
     DEFAULT_CM_PU(BehaviorTreeExecutor);
 public:
+    /**
+     *   Where an executor is in its tree, the node is stored by its
+     * StateIndex so that this can be written out and read back in.
+     */
+    struct Snapshot final
+    {
+        ::std::int32_t CurrentNode;
+        ::std::uint32_t State;
+        float DeltaTime;
+        ::std::uint32_t SuspendTime;
+    };
+public:
+    BehaviorTreeExecutor(
+        BehaviorTreeRepeatNode* const root,
+        ::Blackboard* const blackboard,
+        PetManager* const petManager
+    ) noexcept
+        : BehaviorTreeExecutor(root, nullptr, blackboard, petManager)
+    { }
+
+    /**
+     *   Creates an executor that runs the flattened form of root. If
+     * compiledTree is null this behaves exactly like the executor above.
+     */
     BehaviorTreeExecutor(
         BehaviorTreeRepeatNode* const root,
-        Blackboard* const blackboard,
+        const CompiledBehaviorTree* const compiledTree,
+        ::Blackboard* const blackboard,
         PetManager* const petManager
     ) noexcept
         : m_Root(root)
+        , m_CompiledTree(compiledTree)
         , m_Current(nullptr)
+        , m_CurrentIndex(-1)
         , m_Blackboard(blackboard)
         , m_PetManager(petManager)
         , m_CurrentState(Uninitialized)
         , m_CurrentDeltaTime(0.0f)
+        , m_SuspendTime(0)
     { }
 
     void Tick(const float deltaTime) noexcept;
 
+    /**
+     *   Tick split into its parts, so that the pending actions of many
+     * pets can be run together:
+     *   BeginTick(deltaTime);
+     *   if(PendingAction() >= 0) run the action, then ApplyActionResult;
+     *   EndTick();
+     * is the same as Tick(deltaTime). PendingAction is only ever set for
+     * executors running a compiled tree, EndTick does the whole tick for
+     * the pointer based tree.
+     */
+    void BeginTick(float deltaTime) noexcept;
+
+    /**
+     *   The compiled index of the action this tick has to run, -1 if
+     * there is none.
+     */
+    [[nodiscard]] ::std::int32_t PendingAction() const noexcept
+    {
+        return m_CompiledTree && m_CurrentState == Running ? m_CurrentIndex : -1;
+    }
+
+    /**
+     * Runs the pending action through its regular handler.
+     */
+    void RunPendingAction() noexcept;
+
+    void ApplyActionResult(BehaviorTreeActionResult result) noexcept;
+
+    void EndTick() noexcept;
+
+    [[nodiscard]] const CompiledBehaviorTree* CompiledTree() const noexcept { return m_CompiledTree; }
+    [[nodiscard]] ::Blackboard* Blackboard() const noexcept { return m_Blackboard; }
+    [[nodiscard]] float DeltaTime() const noexcept { return m_CurrentDeltaTime; }
+
+    /**
+     *   How long, in milliseconds, the action that ran during the last
+     * Tick asked to be left alone for. 0 if it did not suspend.
+     */
+    [[nodiscard]] ::std::uint32_t SuspendTime() const noexcept { return m_SuspendTime; }
+
+    [[nodiscard]] Snapshot SaveState() const noexcept;
+
+    /**
+     *   Moves the executor to a saved position. This has to be restored
+     * against the same tree (compiled or not) that it was saved from.
+     *
+     * @return A status code, PetInvalidArg if the node is not in the tree.
+     */
+    PetStatus RestoreState(const Snapshot& snapshot) noexcept;
+
     void Execute(const BehaviorTreeNode* const node) noexcept;
     void Execute(const BehaviorTreeNode& node) noexcept;
 
@@ -262,10 +438,22 @@ public:
     void Execute(const BehaviorTreeSelectorNode& node) noexcept;
     void Execute(const BehaviorTreeRepeatNode& node) noexcept;
     void Execute(const BehaviorTreeActionNode& node) noexcept;
+
+    /**
+     *   Assigns a pre-order StateIndex to node and everything below it,
+     * starting at startIndex. Nodes that already have an index (because
+     * they are shared by several parents) are skipped.
+     *
+     * @return The next free index.
+     */
+    static ::std::int32_t InitChildren(BehaviorTreeNode* const node, const ::std::int32_t startIndex) noexcept;
 private:
+    void TickPointer() noexcept;
+    void AdvanceCompiled() noexcept;
+    void ExecuteCompiled(::std::int32_t nodeIndex) noexcept;
+
     void InitState() noexcept;
     ::std::int32_t CountChildren(const BehaviorTreeNode* const node) const noexcept;
-    ::std::int32_t InitChildren(BehaviorTreeNode* const node, const ::std::int32_t startIndex) const noexcept;
 private:
     enum State
     {
@@ -275,9 +463,12 @@ private:
     };
 private:
     BehaviorTreeRepeatNode* m_Root;
+    const CompiledBehaviorTree* m_CompiledTree;
     const BehaviorTreeNode* m_Current;
-    Blackboard* m_Blackboard;
+    ::std::int32_t m_CurrentIndex;
+    ::Blackboard* m_Blackboard;
     PetManager* m_PetManager;
     State m_CurrentState;
     float m_CurrentDeltaTime;
+    ::std::uint32_t m_SuspendTime;
 };
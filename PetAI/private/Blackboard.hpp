@@ -1,8 +1,8 @@
 #pragma once
 
 #include "Objects.hpp"
+#include "PetAI.h"
 #include <SysLib.h>
-#include "AVLTree.hpp"
 
 struct BlackboardKey final
 {
@@ -47,21 +47,39 @@ public:
 [[nodiscard]] static bool operator>=(const BlackboardKeyName& left, const BlackboardKeyName& right) noexcept;
 [[nodiscard]] static bool operator<=(const BlackboardKeyName& left, const BlackboardKeyName& right) noexcept;
 
+/**
+ * Where the value of a key is kept.
+ */
+enum class BlackboardKeyStorage : uint8_t
+{
+    /**
+     * Stored inside each pet's Blackboard.
+     */
+    Row = 0,
+    /**
+     *   Stored in a BlackboardColumns array shared by every pet, for keys
+     * that are touched by most pets on most ticks.
+     */
+    Column
+};
+
 struct BlackboardKeyData final
 {
     DEFAULT_CONSTRUCT_PU(BlackboardKeyData);
     DEFAULT_DESTRUCT(BlackboardKeyData);
     DEFAULT_CM_PU(BlackboardKeyData);
 public:
-    BlackboardKeyData(const BlackboardKey key, const BlackboardKeyName& name, const size_t dataSize) noexcept
+    BlackboardKeyData(const BlackboardKey key, const BlackboardKeyName& name, const size_t dataSize, const BlackboardKeyStorage storage = BlackboardKeyStorage::Row) noexcept
         : Key(key)
         , Name(name)
         , DataSize(dataSize)
+        , Storage(storage)
     { }
 public:
     BlackboardKey Key;
     BlackboardKeyName Name;
     size_t DataSize;
+    BlackboardKeyStorage Storage;
 };
 
 [[nodiscard]] static bool operator==(const BlackboardKeyData& left, const BlackboardKeyData& right) noexcept;
@@ -88,33 +106,322 @@ public:
 [[nodiscard]] static bool operator<=(const BlackboardKeyData& left, const BlackboardKeyName& right) noexcept;
 [[nodiscard]] static bool operator<=(const BlackboardKeyName& left, const BlackboardKeyData& right) noexcept;
 
+/**
+ *   Hands out a BlackboardKey for every key name.
+ *
+ *   The keys are kept in an open addressing hash table keyed on the
+ * FNV-1a hash of the name, the length and the string itself are only
+ * compared once the hashes match.
+ */
 class BlackboardKeyManager final
 {
-    DEFAULT_DESTRUCT(BlackboardKeyManager);
     DELETE_CM(BlackboardKeyManager);
 public:
     using KeyChar = BlackboardKeyName::KeyChar;
-    using TreeT = FastAVLTree<BlackboardKeyData, InsertMethod::Greater>;
 public:
     BlackboardKeyManager() noexcept;
 
-    BlackboardKey CalculateKey(const KeyChar* key, const size_t dataSize) noexcept;
+    ~BlackboardKeyManager() noexcept;
+
+    /**
+     *   A key that was loaded without a size (see BlackboardKeyLoader)
+     * takes on the size and storage passed here.
+     *
+     * @return The key for key, or -1 if it could not be registered.
+     */
+    BlackboardKey CalculateKey(const KeyChar* key, const size_t dataSize, BlackboardKeyStorage storage = BlackboardKeyStorage::Row) noexcept;
 
-    void StoreKey(BlackboardKey key, const BlackboardKeyName& name, const size_t dataSize) noexcept;
+    /**
+     * Registers a key that was loaded, replacing any key with the same name.
+     */
+    void StoreKey(BlackboardKey key, const BlackboardKeyName& name, const size_t dataSize, BlackboardKeyStorage storage = BlackboardKeyStorage::Row) noexcept;
 
+    [[nodiscard]] const BlackboardKeyData* Find(const BlackboardKeyName& name) const noexcept;
+
+    /**
+     * @return The size of every key, including the column keys.
+     */
     [[nodiscard]] size_t TotalSize() const noexcept { return m_TotalSize; }
-    [[nodiscard]] const TreeT& NameTree() const noexcept { return m_NameTree; }
+    /**
+     * @return One past the highest key, this is how large a table indexed by key has to be.
+     */
+    [[nodiscard]] int32_t KeyCount() const noexcept { return m_CurrentKeyIndex; }
+
+    /**
+     * The number of names that were registered.
+     */
+    [[nodiscard]] uint32_t EntryCount() const noexcept { return m_EntryCount; }
+    /**
+     * Every registered key, in the order they were registered.
+     */
+    [[nodiscard]] const BlackboardKeyData* Entries() const noexcept { return m_Entries; }
+
+    /**
+     *   The indices into Entries sorted by name, so that layouts don't
+     * depend on the order the keys were registered in. This is sorted
+     * lazily the first time it is needed after a key was added, so it
+     * must not be called from several threads at once.
+     */
+    [[nodiscard]] const uint32_t* NameOrder() const noexcept;
 private:
-    TreeT m_NameTree;
+    static inline constexpr uint32_t EmptySlot = UINT32_MAX;
+    static inline constexpr uint32_t InitialSlotCount = 64;
+private:
+    /**
+     * @return The slot holding name, or the empty slot it would go into.
+     */
+    [[nodiscard]] uint32_t FindSlot(const BlackboardKeyName& name) const noexcept;
+
+    [[nodiscard]] PetStatus Reserve(uint32_t entryCount) noexcept;
+
+    [[nodiscard]] BlackboardKeyData* AddEntry(BlackboardKey key, const BlackboardKeyName& name, size_t dataSize, BlackboardKeyStorage storage) noexcept;
+private:
+    BlackboardKeyData* m_Entries;
+    uint32_t m_EntryCount;
+    uint32_t m_EntryCapacity;
+    /**
+     * Indices into m_Entries, the slot count is always a power of two.
+     */
+    uint32_t* m_Slots;
+    uint32_t m_SlotCount;
+    mutable uint32_t* m_NameOrder;
+    mutable bool m_NameOrderValid;
     int32_t m_CurrentKeyIndex;
     size_t m_TotalSize;
 };
 
+/**
+ *   Struct-of-arrays storage for the keys registered with
+ * BlackboardKeyStorage::Column.
+ *
+ *   Every column key gets one array with an element per pet, and each
+ * pet's Blackboard knows its slot in those arrays. Handlers that look
+ * at the same key across many pets (see BehaviorTreeActionBatch) can
+ * then walk a single array instead of one blackboard per pet.
+ *
+ *   The arrays grow by reallocating, so pointers into them are only
+ * valid until the next AllocSlot.
+ */
+class BlackboardColumns final
+{
+    DELETE_CM(BlackboardColumns);
+public:
+    BlackboardColumns() noexcept;
+
+    ~BlackboardColumns() noexcept;
+
+    /**
+     *   Creates an (empty) array for every column key. No keys can be
+     * added to keyManager afterwards.
+     */
+    PetStatus Init(const BlackboardKeyManager& keyManager) noexcept;
+
+    void Reset() noexcept;
+
+    [[nodiscard]] bool IsInitialized() const noexcept { return m_Columns; }
+
+    /**
+     * Reserves a zeroed slot in every column, reusing a freed slot if there is one.
+     */
+    PetStatus AllocSlot(uint32_t* pSlot) noexcept;
+
+    /**
+     * Returns slot to AllocSlot.
+     */
+    void FreeSlot(uint32_t slot) noexcept;
+
+    /**
+     * One past the highest slot ever handed out, including freed slots.
+     */
+    [[nodiscard]] uint32_t SlotCount() const noexcept { return m_SlotCount; }
+    [[nodiscard]] uint32_t FreeSlotCount() const noexcept { return m_FreeSlotCount; }
+
+    [[nodiscard]] int32_t KeyCount() const noexcept { return m_KeyCount; }
+
+    [[nodiscard]] bool IsColumn(const BlackboardKey key) const noexcept
+    {
+        return key.Key >= 0 && key.Key < m_KeyCount && m_Columns[key.Key].ElementSize > 0;
+    }
+
+    /**
+     * @return The size of a single element of the column for key, 0 if key is not a column.
+     */
+    [[nodiscard]] size_t ElementSize(const BlackboardKey key) const noexcept
+    {
+        return IsColumn(key) ? m_Columns[key.Key].ElementSize : 0;
+    }
+
+    /**
+     * @return The first element of the column for key, or null if key is not a column.
+     */
+    [[nodiscard]] void* ColumnData(const BlackboardKey key) noexcept
+    {
+        return IsColumn(key) ? m_Columns[key.Key].Data : nullptr;
+    }
+
+    template<typename T>
+    [[nodiscard]] T* Column(const BlackboardKey key) noexcept
+    {
+        return static_cast<T*>(ColumnData(key));
+    }
+
+    [[nodiscard]] void* Get(const BlackboardKey key, const uint32_t slot) noexcept
+    {
+        if(!IsColumn(key) || slot >= m_SlotCount)
+        {
+            return nullptr;
+        }
+
+        return static_cast<unsigned char*>(m_Columns[key.Key].Data) + static_cast<size_t>(slot) * m_Columns[key.Key].ElementSize;
+    }
+private:
+    struct ColumnArray final
+    {
+        void* Data;
+        size_t ElementSize;
+    };
+private:
+    void AddColumn(const BlackboardKeyData& keyData) noexcept;
+
+    PetStatus Grow() noexcept;
+private:
+    /**
+     * Indexed by key, ElementSize is 0 for row keys.
+     */
+    ColumnArray* m_Columns;
+    int32_t m_KeyCount;
+    uint32_t m_SlotCount;
+    uint32_t m_SlotCapacity;
+    /**
+     * A stack of freed slots, with room for every slot.
+     */
+    uint32_t* m_FreeSlots;
+    uint32_t m_FreeSlotCount;
+};
+
+/**
+ *   Where every key's value lives inside a Blackboard.
+ *
+ *   The layout only depends on the key manager and the columns, so it is
+ * computed once and shared by every blackboard built from it. It is
+ * frozen after Init: keys added to the key manager afterwards have no
+ * offset, and need a new layout (and new blackboards).
+ *
+ *   For dirty tracking the data is split into (at most) 64 lines of
+ * DirtyLineSize() bytes, a cache line unless the blackboard is larger
+ * than 4KiB. A set of lines is a 64 bit mask.
+ */
+class BlackboardLayout final
+{
+    DELETE_CM(BlackboardLayout);
+public:
+    /**
+     * The offset of keys whose value lives in Columns().
+     */
+    static inline constexpr size_t ColumnOffset = SIZE_MAX;
+    /**
+     * The offset of keys that are not part of the layout.
+     */
+    static inline constexpr size_t InvalidOffset = SIZE_MAX - 1;
+    static inline constexpr uint32_t MinDirtyLineShift = 6;
+public:
+    BlackboardLayout() noexcept;
+
+    ~BlackboardLayout() noexcept;
+
+    /**
+     *   Assigns an offset to every key in keyManager. If columns is null,
+     * column keys are stored in the blackboard itself, like every other
+     * key.
+     *
+     * @param reservedSize The number of bytes to keep free at the start
+     *   of every blackboard, this is BlackboardSchema::Size.
+     */
+    PetStatus Init(const BlackboardKeyManager& keyManager, BlackboardColumns* columns = nullptr, size_t reservedSize = 0) noexcept;
+
+    void Reset() noexcept;
+
+    [[nodiscard]] bool IsInitialized() const noexcept { return m_KeyOffsets; }
+
+    /**
+     * The number of bytes every blackboard needs for its values.
+     */
+    [[nodiscard]] size_t DataSize() const noexcept { return m_DataSize; }
+    [[nodiscard]] size_t ReservedSize() const noexcept { return m_ReservedSize; }
+    [[nodiscard]] int32_t KeyCount() const noexcept { return m_KeyCount; }
+    [[nodiscard]] BlackboardColumns* Columns() const noexcept { return m_Columns; }
+
+    [[nodiscard]] size_t Offset(const BlackboardKey key) const noexcept
+    {
+        if(key.Key < 0 || key.Key >= m_KeyCount)
+        {
+            return InvalidOffset;
+        }
+
+        return m_KeyOffsets[key.Key];
+    }
+
+    [[nodiscard]] size_t DirtyLineSize() const noexcept { return static_cast<size_t>(1) << m_DirtyLineShift; }
+
+    /**
+     * @return The lines a row key's value covers, 0 for column keys.
+     */
+    [[nodiscard]] uint64_t DirtyMask(const BlackboardKey key) const noexcept
+    {
+        if(key.Key < 0 || key.Key >= m_KeyCount)
+        {
+            return 0;
+        }
+
+        return m_KeyDirtyMasks[key.Key];
+    }
+
+    /**
+     * @return The lines [offset, offset + size) covers.
+     */
+    [[nodiscard]] uint64_t DirtyMask(const size_t offset, const size_t size) const noexcept
+    {
+        if(size == 0 || offset >= m_DataSize)
+        {
+            return 0;
+        }
+
+        const size_t firstLine = offset >> m_DirtyLineShift;
+        const size_t lastLine = (offset + size - 1) >> m_DirtyLineShift;
+        const uint64_t upToLast = lastLine >= 63 ? ~static_cast<uint64_t>(0) : (static_cast<uint64_t>(1) << (lastLine + 1)) - 1;
+
+        return upToLast & ~((static_cast<uint64_t>(1) << firstLine) - 1);
+    }
+private:
+    void AddOffset(const BlackboardKeyData& keyData) noexcept;
+private:
+    size_t* m_KeyOffsets;
+    uint64_t* m_KeyDirtyMasks;
+    uint32_t m_DirtyLineShift;
+    int32_t m_KeyCount;
+    size_t m_DataSize;
+    size_t m_ReservedSize;
+    BlackboardColumns* m_Columns;
+};
+
 class Blackboard final
 {
     DELETE_CM(Blackboard);
 public:
-    Blackboard(const BlackboardKeyManager& keyManager) noexcept;
+    /**
+     *   Creates a blackboard with a zeroed value for every key in layout,
+     * layout must outlive the blackboard.
+     *
+     * @param columnSlot The index of this blackboard in layout's columns.
+     */
+    Blackboard(const BlackboardLayout& layout, uint32_t columnSlot = 0) noexcept;
+
+    /**
+     *   Creates a blackboard inside storage, which must be at least
+     * layout.DataSize() bytes, aligned to a size_t, and outlive the
+     * blackboard. The blackboard never frees it.
+     */
+    Blackboard(const BlackboardLayout& layout, uint32_t columnSlot, void* storage) noexcept;
 
     ~Blackboard() noexcept;
 
@@ -124,20 +431,99 @@ public:
         return static_cast<T*>(Get(key));
     }
 
+    /**
+     *   Gets a value for writing, this marks the value as dirty. Use the
+     * const overload to only read it.
+     */
     [[nodiscard]] void* Get(const BlackboardKey key) noexcept;
+    [[nodiscard]] const void* Get(const BlackboardKey key) const noexcept;
+
+    template<typename T>
+    [[nodiscard]] const T* GetT(const BlackboardKey key) const noexcept
+    {
+        return static_cast<const T*>(Get(key));
+    }
+
+    /**
+     *   Gets a value from a BlackboardSchema, this is a fixed offset from
+     * the blackboard data. The layout of this blackboard must have
+     * reserved at least KeyT::Schema::Size bytes. Like Get(key), this
+     * marks the value as dirty, use the const overload to only read it.
+     */
+    template<typename KeyT>
+    [[nodiscard]] typename KeyT::Type* Get() noexcept
+    {
+        m_DirtyLines |= m_Layout->DirtyMask(KeyT::Offset, sizeof(typename KeyT::Type));
+        return reinterpret_cast<typename KeyT::Type*>(static_cast<unsigned char*>(m_BlackboardData) + KeyT::Offset);
+    }
+
+    template<typename KeyT>
+    [[nodiscard]] const typename KeyT::Type* Get() const noexcept
+    {
+        return reinterpret_cast<const typename KeyT::Type*>(static_cast<const unsigned char*>(m_BlackboardData) + KeyT::Offset);
+    }
+
+    /**
+     *   The write barrier, for values that are written through a pointer
+     * that was kept around rather than fetched with Get.
+     */
+    void MarkDirty(const BlackboardKey key) noexcept
+    {
+        if(m_Layout->Offset(key) == BlackboardLayout::ColumnOffset)
+        {
+            m_ColumnsDirty = true;
+        }
+        else
+        {
+            m_DirtyLines |= m_Layout->DirtyMask(key);
+        }
+    }
+
+    void MarkDirty(const size_t offset, const size_t size) noexcept
+    {
+        m_DirtyLines |= m_Layout->DirtyMask(offset, size);
+    }
+
+    /**
+     *   The lines of Data() written since the last ClearDirty, see
+     * BlackboardLayout::DirtyLineSize.
+     */
+    [[nodiscard]] uint64_t DirtyLines() const noexcept { return m_DirtyLines; }
+
+    /**
+     * Whether any column value was written since the last ClearDirty.
+     */
+    [[nodiscard]] bool ColumnsDirty() const noexcept { return m_ColumnsDirty; }
+
+    void ClearDirty() noexcept
+    {
+        m_DirtyLines = 0;
+        m_ColumnsDirty = false;
+    }
 
     [[nodiscard]] void* operator[](const BlackboardKey key) noexcept
     {
         return Get(key);
     }
+
+    [[nodiscard]] const BlackboardLayout& Layout() const noexcept { return *m_Layout; }
+
+    /**
+     *   The values of the row keys, Layout().DataSize() bytes. The column
+     * keys live in the layout's BlackboardColumns.
+     */
+    [[nodiscard]]       void* Data()       noexcept { return m_BlackboardData; }
+    [[nodiscard]] const void* Data() const noexcept { return m_BlackboardData; }
+
+    /**
+     * The index of this blackboard in the BlackboardColumns of its layout.
+     */
+    [[nodiscard]] uint32_t ColumnSlot() const noexcept { return m_ColumnSlot; }
 private:
-    void CountKeyCallback(const BlackboardKeyManager::TreeT::Node* node) noexcept;
-    void AddOffsetsCallback(const BlackboardKeyManager::TreeT::Node* node) noexcept;
-private:
-    const BlackboardKeyManager* m_KeyManager;
+    const BlackboardLayout* m_Layout;
     void* m_BlackboardData;
-    size_t m_BlackboardSize;
-    int32_t m_KeyCount;
-    size_t* m_KeyOffsets;
-    size_t m_CurrentOffset;
+    uint32_t m_ColumnSlot;
+    bool m_OwnsData;
+    bool m_ColumnsDirty;
+    uint64_t m_DirtyLines;
 };
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+
+/**
+ * A string literal that can be used as a template argument.
+ */
+template<typename CharT, ::std::size_t N>
+struct FixedString final
+{
+    constexpr FixedString(const CharT (&string)[N]) noexcept
+        : String { }
+    {
+        for(::std::size_t i = 0; i < N; ++i)
+        {
+            String[i] = string[i];
+        }
+    }
+
+    [[nodiscard]] constexpr ::std::size_t Length() const noexcept { return N - 1; }
+
+    template<typename OtherCharT, ::std::size_t OtherN>
+    [[nodiscard]] constexpr bool operator==(const FixedString<OtherCharT, OtherN>& other) const noexcept
+    {
+        if constexpr(!::std::is_same_v<CharT, OtherCharT> || N != OtherN)
+        {
+            return false;
+        }
+        else
+        {
+            for(::std::size_t i = 0; i < N; ++i)
+            {
+                if(String[i] != other.String[i])
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+    }
+
+    CharT String[N];
+};
+
+/**
+ * A value in a BlackboardSchema.
+ */
+template<FixedString Name, typename T>
+struct BlackboardField final
+{
+    static_assert(::std::is_trivially_copyable_v<T>, "Blackboard values are zero initialized and copied as bytes.");
+
+    using Type = T;
+
+    static inline constexpr auto KeyName = Name;
+};
+
+/**
+ *   A key that was resolved at compile time, pass it to Blackboard::Get
+ * to get a pointer at a fixed offset from the blackboard data.
+ */
+template<typename SchemaT, typename T, ::std::size_t OffsetV>
+struct BlackboardSchemaKey final
+{
+    using Schema = SchemaT;
+    using Type = T;
+
+    static inline constexpr ::std::size_t Offset = OffsetV;
+};
+
+/**
+ *   A set of blackboard values whose names, types and offsets are all
+ * known at compile time.
+ *
+ *   The schema is laid out in declaration order at the start of the
+ * blackboard, pass Size as the reserved size to BlackboardLayout::Init
+ * and the runtime keys are placed after it. Schema values are not
+ * known to the BlackboardKeyManager, the key manager is still used for
+ * keys that are only known at runtime (and for the keys the behavior
+ * tree nodes store their state in).
+ *
+ * @code
+ *   using Schema = BlackboardSchema<BlackboardField<"Hunger", float>>;
+ *   float* hunger = blackboard.Get<Schema::Key<"Hunger">>();
+ * @endcode
+ */
+template<typename... Fields>
+class BlackboardSchema final
+{
+public:
+    static inline constexpr ::std::size_t FieldCount = sizeof...(Fields);
+private:
+    using FieldTuple = ::std::tuple<Fields...>;
+
+    template<::std::size_t Index>
+    using FieldAt = ::std::tuple_element_t<Index, FieldTuple>;
+
+    static constexpr ::std::array<::std::size_t, FieldCount + 1> ComputeOffsets() noexcept
+    {
+        constexpr ::std::size_t sizes[] = { sizeof(typename Fields::Type)..., 0 };
+        constexpr ::std::size_t alignments[] = { alignof(typename Fields::Type)..., 1 };
+
+        ::std::array<::std::size_t, FieldCount + 1> offsets { };
+        ::std::size_t offset = 0;
+
+        for(::std::size_t i = 0; i < FieldCount; ++i)
+        {
+            offset = (offset + alignments[i] - 1) & ~(alignments[i] - 1);
+            offsets[i] = offset;
+            offset += sizes[i];
+        }
+
+        // Round the end up, so that whatever follows the schema is aligned.
+        offsets[FieldCount] = (offset + alignof(::std::max_align_t) - 1) & ~(alignof(::std::max_align_t) - 1);
+
+        return offsets;
+    }
+
+    static inline constexpr ::std::array<::std::size_t, FieldCount + 1> s_Offsets = ComputeOffsets();
+
+    template<FixedString Name>
+    static constexpr ::std::size_t IndexOf() noexcept
+    {
+        constexpr bool matches[] = { (Fields::KeyName == Name)..., false };
+
+        for(::std::size_t i = 0; i < FieldCount; ++i)
+        {
+            if(matches[i])
+            {
+                return i;
+            }
+        }
+
+        return FieldCount;
+    }
+
+    template<FixedString Name>
+    static constexpr ::std::size_t CheckedIndexOf() noexcept
+    {
+        constexpr ::std::size_t index = IndexOf<Name>();
+        static_assert(index < FieldCount, "The key is not part of this schema.");
+        return index;
+    }
+public:
+    /**
+     * The number of bytes the schema reserves at the start of a blackboard.
+     */
+    static inline constexpr ::std::size_t Size = s_Offsets[FieldCount];
+
+    template<FixedString Name>
+    using Key = BlackboardSchemaKey<BlackboardSchema, typename FieldAt<CheckedIndexOf<Name>()>::Type, s_Offsets[CheckedIndexOf<Name>()]>;
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "Objects.hpp"
+#include "PetAI.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+/**
+ *   The writes of a single checkpoint, along with a copy of the bytes
+ * to write. Once captured, a batch no longer refers to the pets, so it
+ * can be written out while they keep changing.
+ */
+class CheckpointBatch final
+{
+    DELETE_CM(CheckpointBatch);
+public:
+    struct Range final
+    {
+        ::std::size_t FileOffset;
+        ::std::size_t DataOffset;
+        ::std::size_t Size;
+    };
+public:
+    CheckpointBatch() noexcept
+        : m_Ranges()
+        , m_Data()
+    { }
+
+    ~CheckpointBatch() noexcept = default;
+
+    /**
+     * Empties the batch, keeping its memory for the next checkpoint.
+     */
+    void Clear() noexcept
+    {
+        m_Ranges.clear();
+        m_Data.clear();
+    }
+
+    /**
+     *   Copies size bytes to write at fileOffset, a range that continues
+     * the previous one is merged into it.
+     */
+    void Append(::std::size_t fileOffset, const void* data, ::std::size_t size) noexcept;
+
+    [[nodiscard]] bool IsEmpty() const noexcept { return m_Ranges.empty(); }
+    [[nodiscard]] ::std::size_t RangeCount() const noexcept { return m_Ranges.size(); }
+    [[nodiscard]] ::std::size_t ByteCount() const noexcept { return m_Data.size(); }
+
+    /**
+     * Writes every range in order, stopping at the first failure.
+     */
+    PetStatus Write(SavePetState_f* savePetState, PetAppHandle appHandle, PetFileHandle file) const noexcept;
+private:
+    ::std::vector<Range> m_Ranges;
+    ::std::vector<::std::uint8_t> m_Data;
+};
+
+/**
+ *   Writes checkpoints on a thread of its own, so that the tick loop
+ * never waits on the application's file I/O.
+ *
+ *   There are two batches. The tick loop captures a checkpoint into one
+ * at a frame boundary while the writer works through the other, if
+ * both are taken the checkpoint has to wait for a later frame. The
+ * results are handed back to the tick loop through PopResult, so that
+ * the application only ever hears about them from the thread that
+ * runs the pets.
+ */
+class CheckpointWriter final
+{
+    DELETE_CM(CheckpointWriter);
+public:
+    static inline constexpr ::std::uint32_t BatchCount = 2;
+
+    struct Result final
+    {
+        PetStatus Status;
+        ::std::size_t BytesWritten;
+    };
+public:
+    CheckpointWriter() noexcept;
+
+    ~CheckpointWriter() noexcept;
+
+    PetStatus Start(SavePetState_f* savePetState, PetAppHandle appHandle, PetFileHandle file) noexcept;
+
+    /**
+     * Writes out every submitted batch, then joins the writer.
+     */
+    void Stop() noexcept;
+
+    [[nodiscard]] bool IsRunning() const noexcept { return m_Thread.joinable(); }
+
+    /**
+     *   Gets an empty batch to capture a checkpoint into, this is null
+     * while the writer is still busy with both batches (or their
+     * results haven't been popped yet).
+     */
+    [[nodiscard]] CheckpointBatch* AcquireBatch() noexcept;
+
+    /**
+     * Hands the batch from AcquireBatch to the writer.
+     */
+    void Submit() noexcept;
+
+    /**
+     * @return Whether a batch finished, and if so its result.
+     */
+    [[nodiscard]] bool PopResult(Result* pResult) noexcept;
+private:
+    void WriterMain() noexcept;
+private:
+    ::std::thread m_Thread;
+    CheckpointBatch m_Batches[BatchCount];
+    Result m_Results[BatchCount];
+
+    SavePetState_f* m_SavePetState;
+    PetAppHandle m_AppHandle;
+    PetFileHandle m_File;
+
+    ::std::atomic<::std::uint32_t> m_Submitted;
+    ::std::atomic<::std::uint32_t> m_Completed;
+    /**
+     *   Bumped for every submit and for the stop request, this is what
+     * the writer sleeps on.
+     */
+    ::std::atomic<::std::uint32_t> m_Wakeups;
+    ::std::atomic_bool m_Stopping;
+
+    /**
+     * Only touched by the tick loop.
+     */
+    ::std::uint32_t m_Reported;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Objects.hpp"
+#include "PetAI.h"
+#include "BehaviorTree.hpp"
+#include <cstdint>
+
+enum class BehaviorTreeNodeType : ::std::uint8_t
+{
+    Sequence = 0,
+    Selector,
+    Repeat,
+    Action
+};
+
+/**
+ *   A single node of a CompiledBehaviorTree.
+ *
+ *   All links are indices into the owning tree, -1 is used for a
+ * missing node (the parent of the root, or a null child).
+ */
+struct CompiledBehaviorTreeNode final
+{
+    BehaviorTreeNodeType Type;
+    /**
+     * Set once the node has been filled in, so that shared subtrees are only compiled once.
+     */
+    bool Compiled;
+    ::std::int32_t Parent;
+    /**
+     * The index of the first child in CompiledBehaviorTree::ChildIndices.
+     */
+    ::std::uint32_t ChildOffset;
+    ::std::uint32_t ChildCount;
+    /**
+     * The sequence or selector key, unused for the other node types.
+     */
+    BlackboardKey Key;
+    /**
+     * The node this was compiled from, only the member matching Type is valid.
+     */
+    union
+    {
+        const BehaviorTreeSequenceNode* Sequence;
+        const BehaviorTreeSelectorNode* Selector;
+        const BehaviorTreeRepeatNode* Repeat;
+        const BehaviorTreeActionNode* Action;
+    } Source;
+};
+
+/**
+ *   A flattened copy of a behavior tree.
+ *
+ *   The nodes are stored in pre-order in a single array, where the
+ * index of each node is the StateIndex assigned by
+ * BehaviorTreeExecutor::InitChildren. A node that is shared between
+ * several parents (like the life stage subtrees) only appears once.
+ *
+ *   The compiled tree copies the blackboard keys out of the original
+ * nodes, so it has to be compiled after the keys are initialized. The
+ * original nodes still own the handlers, and must outlive the compiled
+ * tree.
+ */
+class CompiledBehaviorTree final
+{
+    DELETE_CM(CompiledBehaviorTree);
+public:
+    using Node = CompiledBehaviorTreeNode;
+public:
+    CompiledBehaviorTree() noexcept
+        : m_Nodes(nullptr)
+        , m_NodeCount(0)
+        , m_ChildIndices(nullptr)
+        , m_ChildIndexCount(0)
+    { }
+
+    ~CompiledBehaviorTree() noexcept;
+
+    PetStatus Compile(BehaviorTreeRepeatNode* root) noexcept;
+
+    void Reset() noexcept;
+
+    [[nodiscard]] bool IsCompiled() const noexcept { return m_NodeCount > 0; }
+
+    [[nodiscard]] const Node* Nodes() const noexcept { return m_Nodes; }
+    [[nodiscard]] ::std::uint32_t NodeCount() const noexcept { return m_NodeCount; }
+
+    [[nodiscard]] const ::std::int32_t* ChildIndices() const noexcept { return m_ChildIndices; }
+    [[nodiscard]] ::std::uint32_t ChildIndexCount() const noexcept { return m_ChildIndexCount; }
+
+    [[nodiscard]] const Node& Root() const noexcept { return m_Nodes[0]; }
+
+    [[nodiscard]] ::std::int32_t Child(const Node& node, const ::std::uint32_t childIndex) const noexcept
+    {
+        return m_ChildIndices[node.ChildOffset + childIndex];
+    }
+private:
+    void CompileNode(const BehaviorTreeNode* node, ::std::uint32_t* pChildOffset) noexcept;
+private:
+    Node* m_Nodes;
+    ::std::uint32_t m_NodeCount;
+    ::std::int32_t* m_ChildIndices;
+    ::std::uint32_t m_ChildIndexCount;
+};
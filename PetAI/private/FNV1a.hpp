@@ -1,9 +1,26 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 namespace Victoria {
 
+inline constexpr uint32_t FNV1AOffsetBasis = 0x811C9DC5;
+inline constexpr uint32_t FNV1APrime = 0x01000193;
+inline constexpr uint64_t FNV1A64OffsetBasis = 0xCBF29CE484222325;
+inline constexpr uint64_t FNV1A64Prime = 0x00000100000001B3;
+
+/**
+ * The number of strings FNV1ABatch hashes side by side.
+ */
+inline constexpr uint32_t FNV1ABatchWidth = 8;
+
+template<typename CharT>
+constexpr static inline uint32_t FNV1AUpper(const CharT c) noexcept
+{
+    return static_cast<uint32_t>((c >= 'a' && c <= 'z') ? (c - 'a' + 'A') : c);
+}
+
 /**
 *   This function pre-computes the FNV-1a (32-bit) hash for a given string (all upper case).
 *   @param aString The input string to be hashed.
@@ -29,17 +46,132 @@ namespace Victoria {
 *
 */
 template<typename CharT>
-constexpr static inline uint32_t FNV1A(const CharT* const aString, const uint32_t val = 0x811C9DC5)
+constexpr static inline uint32_t FNV1A(const CharT* const aString, const uint32_t val = FNV1AOffsetBasis)
 {
     if(aString[0] == '\0')
     {
         return val;
     }
 
-    const uint32_t c = static_cast<uint32_t>((aString[0] >= 'a' && aString[0] <= 'z') ? (aString[0] - 'a' + 'A') : aString[0]);
+    const uint32_t c = FNV1AUpper(aString[0]);
 
     // Convert the string to upper case and compute the FNV-1a hash.
-    return FNV1A<CharT>(&aString[1], (val ^ c) * 0x01000193);
+    return FNV1A<CharT>(&aString[1], (val ^ c) * FNV1APrime);
+}
+
+/**
+ *   The same hash as FNV1A, but computed with a loop instead of
+ * recursion. Use this for strings only known at runtime, especially
+ * when the length is already known.
+ */
+template<typename CharT>
+constexpr static inline uint32_t FNV1AIterative(const CharT* const string, const size_t length) noexcept
+{
+    uint32_t hash = FNV1AOffsetBasis;
+
+    for(size_t i = 0; i < length; ++i)
+    {
+        hash = (hash ^ FNV1AUpper(string[i])) * FNV1APrime;
+    }
+
+    return hash;
+}
+
+template<typename CharT>
+constexpr static inline uint32_t FNV1AIterative(const CharT* const string) noexcept
+{
+    uint32_t hash = FNV1AOffsetBasis;
+
+    for(size_t i = 0; string[i] != '\0'; ++i)
+    {
+        hash = (hash ^ FNV1AUpper(string[i])) * FNV1APrime;
+    }
+
+    return hash;
+}
+
+/**
+ *   The 64-bit FNV-1a hash (all upper case), for when there are enough
+ * keys that 32-bit collisions start to show up.
+ */
+template<typename CharT>
+constexpr static inline uint64_t FNV1A64(const CharT* const string, const size_t length) noexcept
+{
+    uint64_t hash = FNV1A64OffsetBasis;
+
+    for(size_t i = 0; i < length; ++i)
+    {
+        hash = (hash ^ FNV1AUpper(string[i])) * FNV1A64Prime;
+    }
+
+    return hash;
+}
+
+template<typename CharT>
+constexpr static inline uint64_t FNV1A64(const CharT* const string) noexcept
+{
+    uint64_t hash = FNV1A64OffsetBasis;
+
+    for(size_t i = 0; string[i] != '\0'; ++i)
+    {
+        hash = (hash ^ FNV1AUpper(string[i])) * FNV1A64Prime;
+    }
+
+    return hash;
+}
+
+/**
+ *   Computes FNV1A for count strings at once, hashes[i] is the hash of
+ * the first lengths[i] characters of strings[i].
+ *
+ *   Each character of a string depends on the hash of the previous one,
+ * so a single string is bound by the latency of the multiply. This
+ * hashes FNV1ABatchWidth strings side by side, one character of each
+ * per step, which keeps the multiplies independent and lets the
+ * compiler vectorize the update across the strings.
+ */
+template<typename CharT>
+static inline void FNV1ABatch(const CharT* const* const strings, const uint32_t* const lengths, const uint32_t count, uint32_t* const hashes) noexcept
+{
+    for(uint32_t base = 0; base < count; base += FNV1ABatchWidth)
+    {
+        const uint32_t laneCount = count - base < FNV1ABatchWidth ? count - base : FNV1ABatchWidth;
+
+        const CharT* laneStrings[FNV1ABatchWidth];
+        uint32_t laneLengths[FNV1ABatchWidth];
+        uint32_t laneHashes[FNV1ABatchWidth];
+        uint32_t maxLength = 0;
+
+        for(uint32_t lane = 0; lane < FNV1ABatchWidth; ++lane)
+        {
+            laneStrings[lane] = lane < laneCount ? strings[base + lane] : nullptr;
+            laneLengths[lane] = lane < laneCount ? lengths[base + lane] : 0;
+            laneHashes[lane] = FNV1AOffsetBasis;
+            maxLength = laneLengths[lane] > maxLength ? laneLengths[lane] : maxLength;
+        }
+
+        for(uint32_t i = 0; i < maxLength; ++i)
+        {
+            uint32_t characters[FNV1ABatchWidth];
+
+            for(uint32_t lane = 0; lane < FNV1ABatchWidth; ++lane)
+            {
+                characters[lane] = i < laneLengths[lane] ? FNV1AUpper(laneStrings[lane][i]) : 0;
+            }
+
+            // Strings that already ended keep their hash.
+            for(uint32_t lane = 0; lane < FNV1ABatchWidth; ++lane)
+            {
+                const uint32_t mixed = (laneHashes[lane] ^ characters[lane]) * FNV1APrime;
+                laneHashes[lane] = i < laneLengths[lane] ? mixed : laneHashes[lane];
+            }
+        }
+
+        for(uint32_t lane = 0; lane < laneCount; ++lane)
+        {
+            hashes[base + lane] = laneHashes[lane];
+        }
+    }
 }
 
 }
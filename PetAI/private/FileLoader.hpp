@@ -3,7 +3,9 @@
 #include "Objects.hpp"
 #include "PetAI.h"
 #include "Blackboard.hpp"
-#include "PetManager.hpp"
+#include <limits>
+
+class PetManager;
 
 constexpr PetFileHandle BlackboardKeyFileHandle = 7;
 
@@ -115,6 +117,10 @@ private:
     friend class FileBlock;
 };
 
+/**
+ *   Reads a file one block at a time, a read that stays inside the last
+ * block loaded doesn't call LoadPetState again.
+ */
 class FileReader final
 {
     DELETE_CM(FileReader);
@@ -139,24 +145,35 @@ private:
         , m_FileLength(0)
         , m_DataBlock(nullptr)
         , m_DataBlockSize(0)
-        // , m_DataBlockOffset(0)
-        , m_FileOffset(0)
+        , m_FileOffset(InvalidFileOffset)
     { }
 public:
     FileReader() noexcept
-        : m_FileHandle(0)
+        : m_PetManager(nullptr)
+        , m_FileHandle(0)
         , m_TargetBlockSize(0)
         , m_FileLength(0)
         , m_DataBlock(nullptr)
-        // , m_DataBlockSize(0)
-        , m_FileOffset(0)
+        , m_DataBlockSize(0)
+        , m_FileOffset(InvalidFileOffset)
     { }
 
     ~FileReader() noexcept;
 
+    /**
+     *   Reads *pSize bytes at offset. If the file ends first *pSize is
+     * set to the number of bytes that were read.
+     */
     PetStatus ReadBytes(const size_t offset, void* const data, size_t* const pSize) noexcept;
+
+    [[nodiscard]] size_t FileLength() const noexcept { return m_FileLength; }
 private:
     PetStatus Init() noexcept;
+
+    /**
+     * Loads the block starting at fileOffset, unless it is already loaded.
+     */
+    PetStatus LoadBlock(size_t fileOffset) noexcept;
 private:
     PetManager* m_PetManager;
     PetFileHandle m_FileHandle;
@@ -169,6 +186,9 @@ private:
     size_t m_FileLength;
     uint8_t* m_DataBlock;
     size_t m_DataBlockSize;
+    /**
+     * The offset of the data block in the file, or InvalidFileOffset if nothing is loaded.
+     */
     size_t m_FileOffset;
 };
 
@@ -187,6 +207,15 @@ struct BlackboardKeyFileBaseHeader final
 };
 #pragma pack(pop)
 
+/**
+ *   Loads the BlackboardKey file into a BlackboardKeyManager without
+ * copying the key names.
+ *
+ *   The file is mapped with MapPetState when the application supports
+ * it, otherwise it is read into a single buffer with LoadPetState. The
+ * names handed to the key manager point straight into that memory, so
+ * the loader has to stay loaded for as long as the key manager is used.
+ */
 class BlackboardKeyLoader final
 {
     DELETE_CM(BlackboardKeyLoader);
@@ -197,44 +226,49 @@ public:
     static inline constexpr uint16_t FileVersion1_0 = FileUtils::MakeVersion(1, 0);
 public:
     BlackboardKeyLoader() noexcept
-        : m_TargetBlockSize(4096)
+        : m_PetManager(nullptr)
+        , m_FileData(nullptr)
         , m_FileLength(0)
-        , m_DataBlock(nullptr)
-        , m_DataBlockSize(0)
-        , m_DataBlockOffset(0)
-        , m_FileOffset(0)
-        , m_StringBlock(nullptr)
-        , m_CurrentStringOffset(0)
-        , m_StringLength(0)
-        , m_FileStringOffset(0)
+        , m_OwnedData(nullptr)
+        , m_FlipEndian(false)
         , m_BaseHeader{}
     { }
 
     ~BlackboardKeyLoader() noexcept;
 
-    [[nodiscard]] size_t& TargetBlockSize()       noexcept { return m_TargetBlockSize; }
-    [[nodiscard]] size_t  TargetBlockSize() const noexcept { return m_TargetBlockSize; }
-
+    /**
+     *   Stores every key in the file in keyManager. A missing or empty
+     * file is not an error, there just aren't any keys to load.
+     */
     PetStatus Load(BlackboardKeyManager& keyManager, PetManager& petManager) noexcept;
+
+    /**
+     *   Releases the file, the key names in the key manager are invalid
+     * after this.
+     */
+    void Unload() noexcept;
+
+    [[nodiscard]] bool IsLoaded() const noexcept { return m_FileData; }
+
+    /**
+     * @return Whether the file was mapped, rather than copied into memory.
+     */
+    [[nodiscard]] bool IsMapped() const noexcept { return m_FileData && !m_OwnedData; }
 private:
-    PetStatus LoadV1_0(BlackboardKeyManager& keyManager, PetManager& petManager) noexcept;
+    PetStatus MapFile(PetManager& petManager) noexcept;
+    PetStatus ReadFile(PetManager& petManager) noexcept;
+
+    PetStatus LoadV1_0(BlackboardKeyManager& keyManager) noexcept;
 
     static void FlipEndian(BlackboardKeyFileBaseHeader& baseHeader) noexcept;
 private:
+    PetManager* m_PetManager;
+    const uint8_t* m_FileData;
+    size_t m_FileLength;
     /**
-     * The target size of the data block.
-     * This is how much to read in at any given time.
+     * The buffer the file was read into when it couldn't be mapped.
      */
-    size_t m_TargetBlockSize;
-
-    size_t m_FileLength;
-    uint8_t* m_DataBlock;
-    size_t m_DataBlockSize;
-    uint32_t m_DataBlockOffset;
-    size_t m_FileOffset;
-    uint8_t* m_StringBlock;
-    uint32_t m_CurrentStringOffset;
-    size_t m_StringLength;
-    size_t m_FileStringOffset;
+    uint8_t* m_OwnedData;
+    bool m_FlipEndian;
     BlackboardKeyFileBaseHeader m_BaseHeader;
 };
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Objects.hpp"
+#include "PetAI.h"
+#include <cstdint>
+
+/**
+ *   Decides how long the main loop can sleep between frames.
+ *
+ *   A frame is Update, TickPets and possibly Present. Once that work
+ * is done the loop sleeps until the earliest of:
+ *   - the next Present, based on the target present rate,
+ *   - ActiveTickInterval after the frame started, if any pet is awake,
+ *   - the first sleeping pet waking up,
+ *   - MaxSleepTime from now, so that the application still gets its
+ *     Update called when nothing is going on.
+ *
+ *   The pacer also keeps track of how much of each frame was spent
+ * working and how much was spent asleep.
+ */
+class FramePacer final
+{
+    DELETE_CM(FramePacer);
+    DEFAULT_DESTRUCT(FramePacer);
+public:
+    /**
+     * Passed as the wake delay when no pet is sleeping.
+     */
+    static inline constexpr TimeMs_t NoWakeup = INT64_MAX;
+    static inline constexpr ::std::uint32_t DefaultPresentRate = 1;
+    static inline constexpr TimeMs_t ActiveTickInterval = 5;
+    static inline constexpr TimeMs_t MaxSleepTime = 1000;
+public:
+    FramePacer() noexcept;
+
+    /**
+     * @param presentRate The number of presents per second, 0 uses
+     *   DefaultPresentRate.
+     */
+    void SetTargetPresentRate(::std::uint32_t presentRate) noexcept;
+
+    [[nodiscard]] TimeMs_t PresentInterval() const noexcept { return m_PresentInterval; }
+
+    /**
+     * Resets the statistics, the first present is due straight away.
+     */
+    void Start(TimeMs_t now) noexcept;
+
+    void BeginFrame(TimeMs_t now) noexcept;
+
+    [[nodiscard]] bool ShouldPresent(const TimeMs_t now) const noexcept { return now >= m_NextPresentTime; }
+
+    void MarkPresented(TimeMs_t now) noexcept;
+
+    /**
+     * @param now The time the work for this frame finished.
+     * @param hasActivePets Whether any pet needs to be ticked next frame.
+     * @param wakeDelay How long until the first sleeping pet wakes up,
+     *   or NoWakeup.
+     * @return The time the next frame should start.
+     */
+    [[nodiscard]] TimeMs_t NextDeadline(TimeMs_t now, bool hasActivePets, TimeMs_t wakeDelay) const noexcept;
+
+    /**
+     * @param busyEndTime The time the work for this frame finished.
+     * @param endTime The time the frame ended, after sleeping.
+     * @param wokeEarly Whether the application cut the sleep short.
+     */
+    void EndFrame(TimeMs_t busyEndTime, TimeMs_t endTime, bool wokeEarly) noexcept;
+
+    [[nodiscard]] const PetFrameStats& Stats() const noexcept { return m_Stats; }
+private:
+    TimeMs_t m_PresentInterval;
+    TimeMs_t m_NextPresentTime;
+    TimeMs_t m_FrameStartTime;
+    PetFrameStats m_Stats;
+};
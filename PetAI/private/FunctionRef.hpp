@@ -0,0 +1,111 @@
+#pragma once
+
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+template<typename SignatureT>
+class FunctionRef;
+
+/**
+ *   A non-owning, non-allocating reference to something callable.
+ *
+ *   This is two pointers: the thing to call, and a thunk that knows how
+ * to call it. Unlike ::std::function it never allocates, and it never
+ * copies the callable, so whatever it refers to has to outlive it. Plain
+ * function pointers are stored by value and are always safe.
+ *
+ *   Bind<Function>() bakes the function into the thunk itself, which
+ * lets the compiler inline the handler straight into the call, and
+ * Bind<Function>(context) does the same while passing a context pointer
+ * as the first argument (this also works for member functions).
+ */
+template<typename ReturnT, typename... Args>
+class FunctionRef<ReturnT(Args...)> final
+{
+public:
+    using FunctionPtr = ReturnT(*)(Args...);
+private:
+    union Storage
+    {
+        void* Object;
+        FunctionPtr Function;
+    };
+
+    using InvokerT = ReturnT(*)(Storage storage, Args... args);
+public:
+    constexpr FunctionRef() noexcept
+        : m_Storage { nullptr }
+        , m_Invoker(nullptr)
+    { }
+
+    constexpr FunctionRef(const ::std::nullptr_t) noexcept
+        : FunctionRef()
+    { }
+
+    FunctionRef(const FunctionPtr function) noexcept
+        : m_Storage { nullptr }
+        , m_Invoker(function ? &InvokeFunction : nullptr)
+    {
+        m_Storage.Function = function;
+    }
+
+    /**
+     * References callable, which has to outlive this.
+     */
+    template<typename CallableT>
+        requires (!::std::is_convertible_v<CallableT&, FunctionPtr> && !::std::is_same_v<::std::remove_cv_t<CallableT>, FunctionRef> && ::std::is_invocable_r_v<ReturnT, CallableT&, Args...>)
+    FunctionRef(CallableT& callable) noexcept
+        : m_Storage { const_cast<void*>(static_cast<const void*>(&callable)) }
+        , m_Invoker(&InvokeCallable<CallableT>)
+    { }
+
+    constexpr FunctionRef(const FunctionRef& copy) noexcept = default;
+    constexpr FunctionRef& operator=(const FunctionRef& copy) noexcept = default;
+
+    ~FunctionRef() noexcept = default;
+
+    template<auto Function>
+    [[nodiscard]] static FunctionRef Bind() noexcept
+    {
+        FunctionRef ret;
+        ret.m_Invoker = [](Storage, Args... args) -> ReturnT
+        {
+            return ::std::invoke(Function, ::std::forward<Args>(args)...);
+        };
+        return ret;
+    }
+
+    template<auto Function, typename ContextT>
+    [[nodiscard]] static FunctionRef Bind(ContextT* const context) noexcept
+    {
+        FunctionRef ret;
+        ret.m_Storage.Object = const_cast<void*>(static_cast<const void*>(context));
+        ret.m_Invoker = [](const Storage storage, Args... args) -> ReturnT
+        {
+            return ::std::invoke(Function, static_cast<ContextT*>(storage.Object), ::std::forward<Args>(args)...);
+        };
+        return ret;
+    }
+
+    ReturnT operator()(Args... args) const noexcept
+    {
+        return m_Invoker(m_Storage, ::std::forward<Args>(args)...);
+    }
+
+    [[nodiscard]] explicit operator bool() const noexcept { return m_Invoker; }
+private:
+    static ReturnT InvokeFunction(const Storage storage, Args... args)
+    {
+        return storage.Function(::std::forward<Args>(args)...);
+    }
+
+    template<typename CallableT>
+    static ReturnT InvokeCallable(const Storage storage, Args... args)
+    {
+        return ::std::invoke(*static_cast<CallableT*>(storage.Object), ::std::forward<Args>(args)...);
+    }
+private:
+    Storage m_Storage;
+    InvokerT m_Invoker;
+};
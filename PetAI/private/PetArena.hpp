@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Objects.hpp"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ *   A slab allocator for fixed size blocks, used to keep every pet (the
+ * PetEntity and its Blackboard storage) in a single block, and to keep
+ * those blocks next to each other.
+ *
+ *   Block sizes are rounded up to a power of two size class, starting at
+ * MinBlockSize. Each size class carves its blocks out of slabs of
+ * SlabBlockCount blocks, and keeps the freed blocks on an intrusive
+ * free list, so both Allocate and Deallocate are O(1) once a slab is
+ * available. Slabs are only returned by Reset or the destructor.
+ *
+ *   Blocks larger than the largest size class fall back to Alloc.
+ */
+class PetArena final
+{
+    DELETE_CM(PetArena);
+public:
+    static inline constexpr ::std::size_t MinBlockSize = 64;
+    static inline constexpr ::std::uint32_t SizeClassCount = 16;
+    static inline constexpr ::std::size_t MaxBlockSize = MinBlockSize << (SizeClassCount - 1);
+    static inline constexpr ::std::size_t SlabBlockCount = 64;
+    /**
+     * Every block is aligned to at least this.
+     */
+    static inline constexpr ::std::size_t BlockAlignment = 64;
+public:
+    PetArena() noexcept;
+
+    ~PetArena() noexcept;
+
+    [[nodiscard]] void* Allocate(::std::size_t size) noexcept;
+
+    /**
+     * @param size The size that was passed to Allocate.
+     */
+    void Deallocate(void* block, ::std::size_t size) noexcept;
+
+    /**
+     * Frees every slab, all blocks are invalid after this.
+     */
+    void Reset() noexcept;
+
+    [[nodiscard]] ::std::uint32_t SlabCount() const noexcept { return m_SlabCount; }
+
+    [[nodiscard]] static ::std::size_t BlockSize(::std::size_t size) noexcept;
+private:
+    struct FreeBlock final
+    {
+        FreeBlock* Next;
+    };
+
+    struct alignas(BlockAlignment) Slab final
+    {
+        Slab* Next;
+    };
+private:
+    [[nodiscard]] static ::std::uint32_t SizeClass(::std::size_t size) noexcept;
+
+    [[nodiscard]] bool AllocateSlab(::std::uint32_t sizeClass) noexcept;
+private:
+    FreeBlock* m_FreeLists[SizeClassCount];
+    Slab* m_Slabs;
+    ::std::uint32_t m_SlabCount;
+};
@@ -1,8 +1,28 @@
 #pragma once
 
+#include "BlackboardSchema.hpp"
+#include <cstdint>
+
 class BehaviorTreeRepeatNode;
 class BlackboardKeyManager;
 
+enum class LifeStage : ::std::uint8_t
+{
+    Infant = 0,
+    Childhood,
+    Adolescent,
+    Adult,
+    Elder,
+    MaxValue = Elder
+};
+
+/**
+ * The values every pet has, these are reserved at the start of each pet's Blackboard.
+ */
+using PetBlackboardSchema = BlackboardSchema<
+    BlackboardField<"LifeStage", LifeStage>
+>;
+
 extern BehaviorTreeRepeatNode g_RootNode;
 
 void InitBlackboardKeys(BlackboardKeyManager& keyManager) noexcept;
@@ -3,6 +3,14 @@
 #include "PetAI.h"
 #include "Objects.hpp"
 #include "Blackboard.hpp"
+#include "CheckpointWriter.hpp"
+#include "CompiledBehaviorTree.hpp"
+#include "FileLoader.hpp"
+#include "FramePacer.hpp"
+#include "PetArena.hpp"
+#include "PetSnapshot.hpp"
+#include "RenderThread.hpp"
+#include "WorkerPool.hpp"
 
 // I can't be bothered to handle this better right now...
 #include <vector>
@@ -11,7 +19,6 @@ class PetEntity;
 
 class PetManager final
 {
-    DEFAULT_DESTRUCT(PetManager);
     DELETE_CM(PetManager);
 public:
     static PetManager* FromHandle(const PetAIHandle handle) noexcept
@@ -23,6 +30,8 @@ public:
 public:
     PetManager() noexcept;
 
+    ~PetManager() noexcept;
+
     [[nodiscard]]       PetFunctions& AppFunctions()       noexcept { return m_AppFunctions; }
     [[nodiscard]] const PetFunctions& AppFunctions() const noexcept { return m_AppFunctions; }
 
@@ -35,6 +44,20 @@ public:
     [[nodiscard]]       ::BlackboardKeyManager& BlackboardKeyManager()       noexcept { return m_BlackboardKeyManager; }
     [[nodiscard]] const ::BlackboardKeyManager& BlackboardKeyManager() const noexcept { return m_BlackboardKeyManager; }
 
+    [[nodiscard]] const CompiledBehaviorTree& BehaviorTree() const noexcept { return m_BehaviorTree; }
+
+    /**
+     *   The column keys of every pet. This is set up when the first pet is
+     * created, no keys can be added after that.
+     */
+    [[nodiscard]]       ::BlackboardColumns& BlackboardColumns()       noexcept { return m_BlackboardColumns; }
+    [[nodiscard]] const ::BlackboardColumns& BlackboardColumns() const noexcept { return m_BlackboardColumns; }
+
+    /**
+     * The layout shared by every pet's Blackboard, this is set up along with BlackboardColumns.
+     */
+    [[nodiscard]] const ::BlackboardLayout& BlackboardLayout() const noexcept { return m_BlackboardLayout; }
+
     [[nodiscard]] PetRendererHandle& RendererHandle()       noexcept { return m_RendererHandle; }
     [[nodiscard]] PetRendererHandle  RendererHandle() const noexcept { return m_RendererHandle; }
 
@@ -47,23 +70,305 @@ public:
     [[nodiscard]]       PetArray& Pets()       noexcept { return m_Pets; }
     [[nodiscard]] const PetArray& Pets() const noexcept { return m_Pets; }
 
+    /**
+     * The pets that will be ticked by the next TickPets.
+     */
+    [[nodiscard]] const PetArray& ActivePets() const noexcept { return m_ActivePets; }
+    [[nodiscard]] ::std::uint32_t SleepingPetCount() const noexcept { return static_cast<::std::uint32_t>(m_SleepingPets.size()); }
+
+    /**
+     * The sum of every deltaTime passed to TickPets, in microseconds.
+     */
+    [[nodiscard]] ::std::uint64_t TickTime() const noexcept { return m_TickTime; }
+
+    /**
+     *   The tick time at which the first sleeping pet wakes up, or
+     * UINT64_MAX if no pet is sleeping.
+     */
+    [[nodiscard]] ::std::uint64_t NextWakeTime() const noexcept { return m_SleepingPets.empty() ? UINT64_MAX : m_SleepingPets.front().WakeTime; }
+
+    [[nodiscard]] bool IsTicking() const noexcept { return m_IsTicking; }
+
+    /**
+     *   Every PetEntity and its Blackboard storage live in a single block
+     * of this arena.
+     */
+    [[nodiscard]] const PetArena& Arena() const noexcept { return m_PetArena; }
+
+    [[nodiscard]]       ::FramePacer& FramePacer()       noexcept { return m_FramePacer; }
+    [[nodiscard]] const ::FramePacer& FramePacer() const noexcept { return m_FramePacer; }
+
     PetStatus NotifyExit() noexcept;
     PetStatus GetPetState(const PetHandle petHandle, void** const pState, uint32_t* const pSize) noexcept;
     PetStatus CreatePet(const CreatePetAIData* const pCreatePetData, PetHandle* const pPetHandle) noexcept;
+    /**
+     *   Removes the pet from every list, clears any parent links to it,
+     * and returns its memory and column slot for the next CreatePet.
+     * This cannot be called while the pets are being ticked.
+     */
+    PetStatus DestroyPet(PetHandle petHandle) noexcept;
+    PetStatus GetFrameStats(PetFrameStats* pFrameStats) const noexcept;
+
+    /**
+     *   Writes every pet into a single CRC32 checked block, see
+     * PetSnapshotHeader. The block is owned by the PetManager and is
+     * only valid until the next SaveSnapshot. This cannot be called
+     * while the pets are being ticked.
+     */
+    PetStatus SaveSnapshot(const void** ppData, size_t* pSize) noexcept;
+
+    /**
+     *   Replaces every pet with the pets in a block written by
+     * SaveSnapshot. The blackboard keys have to be set up the same way
+     * as when the snapshot was written. Restored pets don't have any
+     * application state (see GetPetState).
+     *
+     *   Only a bad header rejects the whole block, a pet whose record is
+     * damaged is left out, and pets lose any parent that was left out.
+     */
+    PetStatus RestoreSnapshot(const void* data, size_t size) noexcept;
+
+    /**
+     *   Writes the pets out with SavePetState. The first checkpoint (and
+     * any after a pet was created or destroyed) is a full snapshot,
+     * after that only the records of pets that changed are written, and
+     * of their blackboards only the lines that were marked dirty.
+     */
+    PetStatus WriteCheckpoint() noexcept;
+
+    /**
+     *   Starts a thread that writes the checkpoints passed to
+     * QueueCheckpoint, the application's SavePetState is called from
+     * that thread.
+     */
+    PetStatus StartCheckpointWriter() noexcept;
+    /**
+     * Waits for the queued checkpoints to be written, then stops the thread.
+     */
+    void StopCheckpointWriter() noexcept;
+
+    /**
+     *   Captures a checkpoint (see WriteCheckpoint) and hands it to the
+     * checkpoint writer, or writes it right away if the writer isn't
+     * running. This has to be called between ticks.
+     *
+     * @return PetNoMoreItems if the writer is still busy with the
+     *   previous checkpoints, the changes are kept for the next one.
+     */
+    PetStatus QueueCheckpoint() noexcept;
+
+    /**
+     *   Reports the checkpoints the writer finished to the application,
+     * as a SaveComplete PetEvent.
+     */
+    void PollCheckpoints() noexcept;
 
     PetStatus CreateDefaultRenderer(const CreateDefaultPetRenderer* pCreateDefaultRenderer) const noexcept;
     PetStatus DestroyDefaultRenderer(PetRendererHandle rendererHandle) const noexcept;
 
     PetStatus CreateRenderer() noexcept;
+
+    /**
+     *   Starts a thread that draws the published scenes and presents them,
+     * the application's Present is called from that thread.
+     */
+    PetStatus StartRenderThread() noexcept;
+    /**
+     * Presents the last published scene, then stops the thread.
+     */
+    void StopRenderThread() noexcept;
+
+    /**
+     *   Captures the scene and hands it to the render thread, or draws and
+     * presents it right away if the render thread isn't running. This has
+     * to be called between ticks.
+     */
+    void PresentFrame() noexcept;
+
+    /**
+     * Appends everything drawn this frame to snapshot.
+     */
+    void CaptureScene(SceneSnapshot& snapshot) const noexcept;
+
+    [[nodiscard]] const ::RenderThread& RenderThread() const noexcept { return m_RenderThread; }
+
+    /**
+     *   Loads the keys from the BlackboardKey file, this has to happen
+     * before any key is calculated. The file stays loaded until
+     * UnloadBlackboardKeys, the key names point into it.
+     */
+    PetStatus LoadBlackboardKeys() noexcept;
+    void UnloadBlackboardKeys() noexcept;
+
+    /**
+     *   Flattens the behavior tree every new pet will run. This has to be
+     * called after the blackboard keys have been initialized, pets
+     * created before this run the pointer based tree.
+     */
+    PetStatus CompileBehaviorTree(BehaviorTreeRepeatNode* root) noexcept;
+
+    PetStatus StartTickWorkers() noexcept;
+    void StopTickWorkers() noexcept;
+
+    /**
+     *   Ticks the behavior tree of every pet.
+     *
+     *   When more than one tick thread was requested the pets are split
+     * into chunks and ticked in parallel. While this is running the
+     * following holds for the handlers in a behavior tree:
+     *   - The Blackboard and PetEntity of the pet being ticked belong to
+     *     the handler, nothing else is touching them.
+     *   - The PetManager, the behavior tree nodes and every other pet are
+     *     shared, handlers may only read from them.
+     *   - Anything that changes the PetManager (creating pets, exiting,
+     *     rendering, calling into the application) has to happen outside
+     *     of the tick. IsTicking() can be used to check for this.
+     *
+     *   Pets whose action suspended (see BehaviorTreeActionResult) are
+     * moved onto a min-heap ordered by their wake time, and are skipped
+     * until a later TickPets reaches that time. A woken pet is passed
+     * the full time since it was last ticked as its deltaTime.
+     *
+     *   Pets running the compiled tree are ticked in two passes. First
+     * the pets are grouped by the action they are waiting on, and each
+     * group is handed to the action's batch handler (or its regular
+     * handler, one pet at a time). Then every pet moves on through its
+     * tree to the next action.
+     *
+     * @param deltaTime The time since the last tick in seconds.
+     */
+    void TickPets(float deltaTime) noexcept;
+private:
+    struct SleepingPet final
+    {
+        ::std::uint64_t WakeTime;
+        PetEntity* Pet;
+    };
+
+    /**
+     * Used to find the index of a pet in a snapshot.
+     */
+    struct SnapshotIndex final
+    {
+        const PetEntity* Pet;
+        ::std::uint32_t Index;
+    };
+
+    /**
+     * The heap comparison, this puts the earliest wake time at the front.
+     */
+    [[nodiscard]] static bool WakesLater(const SleepingPet& left, const SleepingPet& right) noexcept { return left.WakeTime > right.WakeTime; }
+
+    /**
+     *   The largest batch passed to a batch handler, this is also the
+     * number of pets a tick worker grabs at a time.
+     */
+    static inline constexpr ::std::uint32_t TickBatchSize = 64;
+private:
+    /**
+     *   Sets up the blackboard columns and layout, and figures out the
+     * arena block size, the first time a pet is created.
+     */
+    PetStatus InitPetStorage() noexcept;
+
+    /**
+     *   Allocates a pet and adds it to Pets(), but not to the active or
+     * sleeping pets.
+     */
+    PetStatus ConstructPet(void* state, ::std::uint32_t stateSize, PetEntity** ppPet) noexcept;
+
+    /**
+     * Destroys every pet at once, without going through DestroyPet.
+     */
+    void DestroyAllPets() noexcept;
+
+    /**
+     * Fills m_SnapshotRecords with the current PetSnapshotRecord of every pet.
+     */
+    void BuildSnapshotRecords() noexcept;
+    ::std::uint8_t* CopyColumnsToSnapshot(PetEntity& pet, ::std::uint8_t* column) noexcept;
+    void SealSnapshotRecord(::std::uint8_t* record) const noexcept;
+    /**
+     *   Brings the snapshot buffer up to date, and adds the parts of it
+     * that changed since the last checkpoint to batch.
+     */
+    PetStatus CaptureCheckpoint(CheckpointBatch& batch) noexcept;
+
+    [[nodiscard]] ::std::size_t SnapshotColumnSize() const noexcept;
+    [[nodiscard]] ::std::uint32_t SnapshotLayoutCrc() const noexcept;
+    [[nodiscard]] ::std::int32_t FindSnapshotIndex(const PetEntity* pet) const noexcept;
+
+    [[nodiscard]] static bool RemovePet(PetArray& pets, const PetEntity* pet) noexcept;
+
+    void WakePets() noexcept;
+    void SortPendingActions() noexcept;
+    void SuspendPets() noexcept;
+
+    void TickActionRange(::std::uint32_t workerIndex, ::std::uint32_t begin, ::std::uint32_t end) noexcept;
+    void RunActionBatch(const BehaviorTreeActionNode* action, PetEntity* const* pets, ::std::uint32_t count) noexcept;
+    void EndTickRange(::std::uint32_t workerIndex, ::std::uint32_t begin, ::std::uint32_t end) noexcept;
 private:
     PetFunctions m_AppFunctions;
     PetAppHandle m_AppHandle;
     void* m_PetCallbackHandle;
+    /**
+     * Declared before the key manager, as the loaded key names must outlive it.
+     */
+    BlackboardKeyLoader m_BlackboardKeyLoader;
     ::BlackboardKeyManager m_BlackboardKeyManager;
+    ::BlackboardColumns m_BlackboardColumns;
+    ::BlackboardLayout m_BlackboardLayout;
+    PetArena m_PetArena;
+    /**
+     *   The size of a pet's arena block, the PetEntity followed by its
+     * Blackboard storage at m_BlackboardStorageOffset.
+     */
+    ::std::size_t m_PetBlockSize;
+    ::std::size_t m_BlackboardStorageOffset;
+    CompiledBehaviorTree m_BehaviorTree;
     PetRendererHandle m_RendererHandle;
     PetRendererFunctions m_RendererFunctions;
 
+    ::std::uint16_t m_ScreenWidth;
+    ::std::uint16_t m_ScreenHeight;
+    ::RenderThread m_RenderThread;
+
     bool m_ShouldExit;
     bool m_HasRenderer;
     PetArray m_Pets;
+    PetArray m_ActivePets;
+    ::std::vector<SleepingPet> m_SleepingPets;
+    ::std::uint64_t m_TickTime;
+
+    /**
+     *   The active pets that have an action to run this tick, sorted by
+     * that action's compiled index.
+     */
+    PetArray m_PendingActionPets;
+    ::std::vector<::std::uint32_t> m_PendingActionOffsets;
+
+    WorkerPool m_TickWorkers;
+    ::std::atomic_bool m_IsTicking;
+
+    /**
+     * The last snapshot, after a checkpoint this matches the file.
+     */
+    ::std::uint8_t* m_SnapshotBuffer;
+    ::std::size_t m_SnapshotCapacity;
+    ::std::size_t m_SnapshotSize;
+    ::std::size_t m_SnapshotRecordSize;
+    /**
+     * Sorted by pet, this is only used while writing a snapshot.
+     */
+    ::std::vector<SnapshotIndex> m_SnapshotIndices;
+    ::std::vector<PetSnapshotRecord> m_SnapshotRecords;
+    /**
+     *   Whether the file matches the snapshot buffer once every captured
+     * checkpoint is written.
+     */
+    bool m_CheckpointWritten;
+    CheckpointBatch m_CheckpointBatch;
+    CheckpointWriter m_CheckpointWriter;
+
+    ::FramePacer m_FramePacer;
 };
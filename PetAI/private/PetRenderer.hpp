@@ -2,33 +2,85 @@
 
 #include "PetAI.h"
 #include "Objects.hpp"
+#include "WorkerPool.hpp"
+#include <algorithm>
+#include <limits>
+#include <vector>
 
 class DefaultPetRenderer final
 {
     DELETE_CM(DefaultPetRenderer);
+public:
+    /**
+     *   Draws are tracked as this many rects at most, past that they are
+     * merged into whichever rect grows the least.
+     */
+    static inline constexpr uint32_t MaxDirtyRects = 16;
+    /**
+     *   The number of rectangles EndDrawCommands checks other draws
+     * against, the largest ones are kept.
+     */
+    static inline constexpr uint32_t MaxOccluders = 8;
 public:
     static DefaultPetRenderer* FromHandle(const PetRendererHandle handle) noexcept
     {
         return static_cast<DefaultPetRenderer*>(handle.Ptr);
     }
 public:
+    /**
+     * @param depthBuffer Optional, width * height depths.
+     * @param tileDepths Required with depthBuffer, TileCount(width, height) depths.
+     */
     DefaultPetRenderer(
         const uint16_t width,
         const uint16_t height,
-        uint8_t* const framebuffer
+        uint8_t* const framebuffer,
+        uint16_t* const depthBuffer,
+        uint16_t* const tileDepths
     ) noexcept
         : m_Width(width)
         , m_Height(height)
         , m_Framebuffer(framebuffer)
-    { }
+        , m_DepthBuffer(depthBuffer)
+        , m_TileDepths(tileDepths)
+        , m_TileCountX((width + TileSize - 1) / TileSize)
+        // Nobody has seen the framebuffer yet.
+        , m_DirtyRects { { 0, 0, width, height } }
+        , m_DirtyRectCount(width != 0 && height != 0 ? 1 : 0)
+        , m_Recording(false)
+        , m_HasRecordedClear(false)
+        , m_RecordedClear { }
+        , m_Commands()
+        , m_SortKeys()
+        , m_CulledCount(0)
+        , m_Workers()
+        , m_TriangleSetups()
+        , m_BinCountX((width + BinSize - 1) / BinSize)
+        , m_BinOffsets()
+        , m_BinCommands()
+        , m_FrontBuffer(nullptr)
+        , m_Locked(false)
+    {
+        // Nothing has been drawn, so everything is in front.
+        if(m_DepthBuffer)
+        {
+            ::std::fill_n(m_DepthBuffer, static_cast<size_t>(width) * static_cast<size_t>(height), static_cast<uint16_t>(0));
+            ::std::fill_n(m_TileDepths, TileCount(width, height), static_cast<uint16_t>(0));
+        }
+    }
 
     ~DefaultPetRenderer() noexcept
     {
         delete[] m_Framebuffer;
+        delete[] m_DepthBuffer;
+        delete[] m_TileDepths;
+        delete[] m_FrontBuffer;
     }
 
     [[nodiscard]] size_t FramebufferSize() const noexcept { return FramebufferSize(m_Width, m_Height); }
 
+    [[nodiscard]] bool HasDepthBuffer() const noexcept { return m_DepthBuffer; }
+
     PetStatus GetScreenSize(uint16_t* const pWidth, uint16_t* const pHeight) const noexcept;
 
     PetStatus ClearScreen(const uint8_t r, const uint8_t g, const uint8_t b, const uint16_t depth) noexcept;
@@ -37,7 +89,35 @@ public:
 
     PetStatus DrawTriangle(const DrawTriangleData* pDrawData) noexcept;
 
-    PetStatus CopyFramebuffer(uint8_t* const pOutFramebuffer, const size_t size) const noexcept;
+    PetStatus CopyFramebuffer(uint8_t* const pOutFramebuffer, const size_t size) noexcept;
+
+    PetStatus CopyDirtyFramebuffer(uint8_t* pOutFramebuffer, size_t size, ScreenRect* pOutRects, uint32_t* pRectCount) noexcept;
+
+    [[nodiscard]] uint32_t DirtyRectCount() const noexcept { return m_DirtyRectCount; }
+
+    PetStatus LockFramebuffer(PetFramebufferLock* pLock) noexcept;
+
+    PetStatus UnlockFramebuffer() noexcept;
+
+    [[nodiscard]] bool IsLocked() const noexcept { return m_Locked; }
+
+    PetStatus BeginDrawCommands() noexcept;
+
+    PetStatus SubmitDrawCommands(const PetDrawCommand* pCommands, uint32_t commandCount) noexcept;
+
+    PetStatus EndDrawCommands() noexcept;
+
+    [[nodiscard]] bool IsRecording() const noexcept { return m_Recording; }
+
+    /**
+     * @return The number of draws the last EndDrawCommands skipped because they were hidden.
+     */
+    [[nodiscard]] uint32_t CulledCount() const noexcept { return m_CulledCount; }
+
+    /**
+     * @return Whether draws are binned into screen tiles and rasterized on several threads.
+     */
+    [[nodiscard]] bool IsTiled() const noexcept { return m_Workers.ThreadCount() > 1; }
 public:
     static PetStatus CreateDefaultRenderer(const CreateDefaultPetRenderer* const pCreateDefaultRenderer) noexcept;
     static PetStatus DestroyDefaultRenderer(const PetRendererHandle handle) noexcept;
@@ -46,8 +126,207 @@ public:
     {
         return static_cast<size_t>(width) * static_cast<size_t>(height) * 3;
     }
+public:
+    /**
+     * Triangles are rasterized in squares of TileSize pixels.
+     */
+    static inline constexpr int32_t TileSize = 8;
+    /**
+     *   In tiled mode draws are binned into squares of BinSize pixels,
+     * each of which is rasterized by one thread.
+     */
+    static inline constexpr int32_t BinSize = 64;
+
+    static_assert(BinSize % TileSize == 0, "A raster tile can't straddle two bins.");
+    /**
+     *   Vertices and pixel centers are in fixed point with this many
+     * fractional bits. A vertex at (x, y) sits on the top left corner of
+     * pixel (x, y), the same as the corners of a rectangle.
+     */
+    static inline constexpr int32_t SubPixelBits = 4;
+    static inline constexpr int64_t SubPixelHalf = int64_t { 1 } << (SubPixelBits - 1);
+
+    /**
+     *   The half-space function of one triangle edge, this is >= 0 for the
+     * pixel centers on the inside.
+     */
+    struct TriangleEdge final
+    {
+        int64_t Origin;
+        int64_t StepX;
+        int64_t StepY;
+
+        [[nodiscard]] int64_t At(const int32_t x, const int32_t y) const noexcept
+        {
+            return Origin + StepX * x + StepY * y;
+        }
+    };
+
+    struct TriangleSetup final
+    {
+        TriangleEdge Edges[3];
+        /**
+         * The pixels that may be covered, [Min, Max), clipped to the screen.
+         */
+        int32_t MinX;
+        int32_t MinY;
+        int32_t MaxX;
+        int32_t MaxY;
+        RGBColor Color;
+        uint16_t Depth;
+    };
+
+    static size_t TileCount(const uint16_t width, const uint16_t height) noexcept
+    {
+        return static_cast<size_t>((width + TileSize - 1) / TileSize) * static_cast<size_t>((height + TileSize - 1) / TileSize);
+    }
+
+    /**
+     * @return false if the triangle doesn't cover any pixels.
+     */
+    [[nodiscard]] bool SetupTriangle(const DrawTriangleData& drawData, TriangleSetup* pSetup) const noexcept;
+
+    /**
+     *   Draws the part of a triangle inside a single tile. Tiles don't
+     * overlap, so separate tiles can be drawn from separate threads.
+     */
+    void RasterizeTriangleTile(const TriangleSetup& setup, int32_t tileX, int32_t tileY) noexcept;
+private:
+    /**
+     * Replaces the sort key of a command that won't be drawn.
+     */
+    static inline constexpr uint64_t CulledKey = ::std::numeric_limits<uint64_t>::max();
+
+    struct RecordedClear final
+    {
+        RGBColor Color;
+        uint16_t Depth;
+    };
+
+    struct DrawCommand final
+    {
+        PetDrawCommand Command;
+        /**
+         * The pixels the draw can cover, [Min, Max), clipped to the screen.
+         */
+        int32_t MinX;
+        int32_t MinY;
+        int32_t MaxX;
+        int32_t MaxY;
+    };
+private:
+    void RasterizeClear(RGBColor color, uint16_t depth) noexcept;
+    void RasterizeRectangle(const DrawRectData& drawData) noexcept;
+    void RasterizeTriangle(const DrawTriangleData& drawData) noexcept;
+
+    /**
+     *   These draw only the pixels inside [startX, endX) x [startY, endY),
+     * which has to line up with the raster tiles. Separate areas can be
+     * drawn from separate threads.
+     */
+    void ClearArea(RGBColor color, uint16_t depth, int32_t startX, int32_t startY, int32_t endX, int32_t endY) noexcept;
+    void RasterizeRectangleArea(const DrawRectData& drawData, int32_t startX, int32_t startY, int32_t endX, int32_t endY) noexcept;
+    void RasterizeTriangleArea(const TriangleSetup& setup, int32_t startX, int32_t startY, int32_t endX, int32_t endY) noexcept;
+
+    PetStatus RecordCommand(const PetDrawCommand& command) noexcept;
+
+    /**
+     *   Draws the recorded commands, then empties the buffer. With
+     * sortByDepth they are sorted and culled first, otherwise they are
+     * drawn in the order they were made.
+     */
+    void FlushCommands(bool sortByDepth) noexcept;
+
+    /**
+     * Draws whatever tiled mode has held back, outside of BeginDrawCommands.
+     */
+    void FlushPending() noexcept;
+
+    /**
+     *   Bins the commands in m_SortKeys, and rasterizes the bins on the
+     * worker threads.
+     */
+    void RasterizeTiled() noexcept;
+
+    /**
+     * Rasterizes the bins [begin, end), this runs on the worker threads.
+     */
+    void RasterizeBins(uint32_t workerIndex, uint32_t begin, uint32_t end) noexcept;
+
+    /**
+     *   Fills the pixels [startX, endX) of row y, clipped to the screen.
+     * With a depth buffer only the pixels at or behind depth are filled.
+     */
+    void FillSpan(int32_t y, int32_t startX, int32_t endX, const RGBColor& color, uint16_t depth) noexcept;
+
+    /**
+     *   Whether every pixel of a tile is in front of depth, in which case
+     * nothing drawn at depth would be visible in it.
+     */
+    [[nodiscard]] bool IsTileHidden(int32_t tileX, int32_t tileY, uint16_t depth) const noexcept;
+
+    /**
+     *   Records that [startX, endX) x [startY, endY), which is inside one
+     * tile, was drawn at depth. This only matters if it covers the whole
+     * tile.
+     */
+    void CoverTile(int32_t tileX, int32_t tileY, int32_t startX, int32_t startY, int32_t endX, int32_t endY, uint16_t depth) noexcept;
+
+    /**
+     * Copies the parts of the framebuffer in the dirty rects to pOutFramebuffer.
+     */
+    void CopyDirtyRects(uint8_t* pOutFramebuffer) noexcept;
+
+    /**
+     * Records that the pixels [startX, endX) x [startY, endY) were drawn to.
+     */
+    void MarkDirty(int32_t startX, int32_t startY, int32_t endX, int32_t endY) noexcept;
 private:
     uint16_t m_Width;
     uint16_t m_Height;
     uint8_t* m_Framebuffer;
+    uint16_t* m_DepthBuffer;
+    /**
+     *   The furthest depth in each tile, or something further. Pixels only
+     * ever move forward between clears, so this is raised whenever a draw
+     * covers a whole tile, and draws behind it can skip the tile.
+     */
+    uint16_t* m_TileDepths;
+    int32_t m_TileCountX;
+
+    /**
+     * What changed since the last CopyDirtyFramebuffer.
+     */
+    ScreenRect m_DirtyRects[MaxDirtyRects];
+    uint32_t m_DirtyRectCount;
+
+    bool m_Recording;
+    bool m_HasRecordedClear;
+    RecordedClear m_RecordedClear;
+    ::std::vector<DrawCommand> m_Commands;
+    /**
+     * (Depth << 32) | index into m_Commands, so that equal depths keep their order.
+     */
+    ::std::vector<uint64_t> m_SortKeys;
+    uint32_t m_CulledCount;
+
+    WorkerPool m_Workers;
+    /**
+     * Indexed like m_Commands, only filled in for triangles.
+     */
+    ::std::vector<TriangleSetup> m_TriangleSetups;
+    int32_t m_BinCountX;
+    /**
+     *   The indices into m_Commands drawn in each bin, in order, bin i's
+     * are [m_BinOffsets[i], m_BinOffsets[i + 1]) of m_BinCommands.
+     */
+    ::std::vector<uint32_t> m_BinOffsets;
+    ::std::vector<uint32_t> m_BinCommands;
+
+    /**
+     *   What LockFramebuffer hands out, m_Framebuffer is the back buffer.
+     * This is only allocated once somebody locks.
+     */
+    uint8_t* m_FrontBuffer;
+    bool m_Locked;
 };
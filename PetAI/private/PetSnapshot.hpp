@@ -0,0 +1,71 @@
+#pragma once
+
+#include "PetAI.h"
+#include "BehaviorTree.hpp"
+#include <cstdint>
+
+constexpr PetFileHandle PetSnapshotFileHandle = 1337;
+
+/**
+ *   The header of a snapshot of every pet, written by
+ * PetManager::SaveSnapshot.
+ *
+ *   The snapshot is one contiguous block:
+ *   - This header.
+ *   - PetCount records of RecordSize bytes, each of which is
+ *     - A PetSnapshotRecord.
+ *     - The pet's Blackboard::Data(), BlackboardSize bytes.
+ *     - The pet's column values in key order, ColumnSize bytes.
+ *
+ *   The header and every record carry their own CRC32, taken with the
+ * Crc field set to 0. A record is its PetSnapshotRecord, blackboard and
+ * column values together, so that a checkpoint only has to rewrite the
+ * records that changed (see PetManager::WriteCheckpoint).
+ *
+ *   The blackboards are copied as raw bytes, so a snapshot can only be
+ * restored against the same blackboard layout, LayoutCrc is used to
+ * check that.
+ */
+struct PetSnapshotHeader final
+{
+    static inline constexpr char FileMagic[4] = { 'P', 'e', 't', 'S' };
+    static inline constexpr ::std::uint32_t GoodEndian = 0x12345678;
+    static inline constexpr ::std::uint16_t FileVersion1_0 = 0x0100;
+
+    char Magic[4];
+    ::std::uint32_t Endian;
+    ::std::uint16_t Version;
+    ::std::uint16_t Reserved0;
+    ::std::uint32_t Crc;
+    ::std::uint32_t LayoutCrc;
+    ::std::uint32_t PetCount;
+    ::std::uint32_t RecordSize;
+    ::std::uint32_t BlackboardSize;
+    ::std::uint32_t ColumnSize;
+    ::std::uint32_t Reserved1;
+    ::std::uint64_t TickTime;
+};
+
+struct PetSnapshotRecord final
+{
+    static inline constexpr ::std::uint32_t SleepingFlag = 1;
+
+    /**
+     * The index of the parent in the snapshot, or -1.
+     */
+    ::std::int32_t ParentMale;
+    ::std::int32_t ParentFemale;
+    ::std::uint32_t Gender;
+    ::std::uint32_t Flags;
+    ::std::uint64_t LastTickTime;
+    /**
+     * Only set for sleeping pets.
+     */
+    ::std::uint64_t WakeTime;
+    BehaviorTreeExecutor::Snapshot Executor;
+    ::std::uint32_t Crc;
+    ::std::uint32_t Reserved;
+};
+
+static_assert(sizeof(PetSnapshotHeader) == 48, "The snapshot header is written as is.");
+static_assert(sizeof(PetSnapshotRecord) == 56, "The snapshot records are written as is.");
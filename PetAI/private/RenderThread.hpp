@@ -0,0 +1,178 @@
+#pragma once
+
+#include "Objects.hpp"
+#include "PetAI.h"
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+/**
+ *   Everything drawn in one frame. The tick loop captures a snapshot and
+ * publishes it, after that it is only read, so it can be drawn while the
+ * pets keep ticking.
+ */
+class SceneSnapshot final
+{
+    DELETE_CM(SceneSnapshot);
+public:
+    SceneSnapshot() noexcept
+        : m_HasClear(false)
+        , m_ClearColor { }
+        , m_ClearDepth(0)
+        , m_Commands()
+    { }
+
+    ~SceneSnapshot() noexcept = default;
+
+    /**
+     * Empties the snapshot, keeping its memory for the next frame.
+     */
+    void Clear() noexcept
+    {
+        m_HasClear = false;
+        m_Commands.clear();
+    }
+
+    void SetClear(const RGBColor color, const ::std::uint16_t depth) noexcept
+    {
+        m_HasClear = true;
+        m_ClearColor = color;
+        m_ClearDepth = depth;
+    }
+
+    void Append(const PetDrawCommand& command) noexcept
+    {
+        m_Commands.push_back(command);
+    }
+
+    [[nodiscard]] ::std::uint32_t CommandCount() const noexcept { return static_cast<::std::uint32_t>(m_Commands.size()); }
+
+    /**
+     * Makes this a copy of other, reusing this snapshot's memory.
+     */
+    void CopyFrom(const SceneSnapshot& other) noexcept;
+
+    [[nodiscard]] bool IsSameAs(const SceneSnapshot& other) const noexcept;
+
+    /**
+     *   Draws the snapshot, recording it as a single batch if the renderer
+     * supports that.
+     */
+    PetStatus Draw(PetRendererHandle rendererHandle, const PetRendererFunctions& rendererFunctions) const noexcept;
+private:
+    bool m_HasClear;
+    RGBColor m_ClearColor;
+    ::std::uint16_t m_ClearDepth;
+    ::std::vector<PetDrawCommand> m_Commands;
+};
+
+/**
+ *   Draws and presents the scene on a thread of its own, so that the
+ * tick loop never waits on the renderer or the application's Present.
+ *
+ *   Snapshots go through a triple buffer. The tick loop fills one
+ * snapshot while the render thread draws another, and the third holds
+ * the newest published snapshot. Publishing swaps the tick loop's
+ * snapshot with that one, and the render thread swaps it with its own
+ * when it is ready for another frame, so neither side ever waits, and
+ * frames the render thread was too slow for are skipped.
+ *
+ *   While the thread isn't running, Publish draws and presents right
+ * away, on the thread calling it.
+ */
+class RenderThread final
+{
+    DELETE_CM(RenderThread);
+public:
+    static inline constexpr ::std::uint32_t SnapshotCount = 3;
+public:
+    RenderThread() noexcept;
+
+    ~RenderThread() noexcept;
+
+    /**
+     * Sets what Publish draws to and presents with, this has to be called before Start.
+     */
+    void Init(Present_f* present, PetAppHandle appHandle, PetRendererHandle rendererHandle, const PetRendererFunctions* pRendererFunctions) noexcept;
+
+    PetStatus Start() noexcept;
+
+    /**
+     * Presents the last published snapshot, if it hasn't been yet, then joins the thread.
+     */
+    void Stop() noexcept;
+
+    [[nodiscard]] bool IsRunning() const noexcept { return m_Thread.joinable(); }
+
+    /**
+     * Gets an empty snapshot for the tick loop to capture the next frame into.
+     */
+    [[nodiscard]] SceneSnapshot& BeginSnapshot() noexcept;
+
+    /**
+     * Hands the snapshot from BeginSnapshot to the render thread.
+     */
+    void Publish() noexcept;
+
+    /**
+     * @return The number of frames presented so far.
+     */
+    [[nodiscard]] ::std::uint64_t PresentCount() const noexcept { return m_PresentCount.load(::std::memory_order_acquire); }
+
+    /**
+     * @return The number of presented frames that had to be drawn, the rest matched the frame before.
+     */
+    [[nodiscard]] ::std::uint64_t DrawCount() const noexcept { return m_DrawCount.load(::std::memory_order_acquire); }
+private:
+    /**
+     * m_Ready holds the index of the newest snapshot, and this bit until the render thread takes it.
+     */
+    static inline constexpr ::std::uint32_t FreshBit = 0x4;
+    static inline constexpr ::std::uint32_t IndexMask = 0x3;
+private:
+    void RenderMain() noexcept;
+
+    /**
+     * Draws the snapshot, unless it matches the last one drawn, and presents.
+     */
+    void RenderFrame(const SceneSnapshot& snapshot) noexcept;
+
+    /**
+     * Swaps in the newest snapshot, if there is one the render thread hasn't seen.
+     */
+    [[nodiscard]] bool AcquireSnapshot() noexcept;
+private:
+    ::std::thread m_Thread;
+    SceneSnapshot m_Snapshots[SnapshotCount];
+    /**
+     * A copy of the last snapshot drawn, only touched while rendering.
+     */
+    SceneSnapshot m_Drawn;
+    bool m_HasDrawn;
+
+    Present_f* m_Present;
+    PetAppHandle m_AppHandle;
+    PetRendererHandle m_RendererHandle;
+    const PetRendererFunctions* m_RendererFunctions;
+
+    /**
+     * Only touched by the tick loop.
+     */
+    ::std::uint32_t m_WriteIndex;
+    /**
+     * Only touched by the render thread.
+     */
+    ::std::uint32_t m_ReadIndex;
+    ::std::atomic<::std::uint32_t> m_Ready;
+
+    /**
+     *   Bumped for every publish and for the stop request, this is what
+     * the render thread sleeps on.
+     */
+    ::std::atomic<::std::uint32_t> m_Wakeups;
+    ::std::atomic_bool m_Stopping;
+
+    ::std::atomic<::std::uint64_t> m_PresentCount;
+    ::std::atomic<::std::uint64_t> m_DrawCount;
+};
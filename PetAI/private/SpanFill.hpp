@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Objects.hpp"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ *   Fills runs of packed RGB24 pixels.
+ *
+ *   A pixel is 3 bytes, so a run is filled by repeating a 48 byte (16
+ * pixel) pattern, which is 3 SSE2 registers, or 96 bytes for AVX2. The
+ * widest kernel the CPU supports is picked once at startup, every kernel
+ * writes exactly the same bytes.
+ *
+ *   FillRgbDepth is the same fill behind a 16 bit depth test, a pixel is
+ * written if its depth is <= the depth being drawn, and its depth is
+ * raised to match. The depths are tested 8 at a time with SSE2, and the
+ * pixels that pass are filled in runs.
+ */
+class SpanFill final
+{
+    DELETE_CONSTRUCT(SpanFill);
+    DELETE_DESTRUCT(SpanFill);
+    DELETE_CM(SpanFill);
+public:
+    enum class Kernel : uint32_t
+    {
+        Scalar = 0,
+        SSE2,
+        AVX2
+    };
+
+    using FillRgbFunc = void(*)(uint8_t* dst, size_t pixelCount, uint8_t r, uint8_t g, uint8_t b) noexcept;
+    using FillRgbDepthFunc = void(*)(uint8_t* dst, uint16_t* depthDst, size_t pixelCount, uint16_t depth, uint8_t r, uint8_t g, uint8_t b) noexcept;
+public:
+    static void FillRgb(uint8_t* const dst, const size_t pixelCount, const uint8_t r, const uint8_t g, const uint8_t b) noexcept
+    {
+        s_FillRgb(dst, pixelCount, r, g, b);
+    }
+
+    static void FillRgbDepth(uint8_t* const dst, uint16_t* const depthDst, const size_t pixelCount, const uint16_t depth, const uint8_t r, const uint8_t g, const uint8_t b) noexcept
+    {
+        s_FillRgbDepth(dst, depthDst, pixelCount, depth, r, g, b);
+    }
+
+    /**
+     * @return The kernel FillRgb uses.
+     */
+    [[nodiscard]] static Kernel ActiveKernel() noexcept { return s_ActiveKernel; }
+
+    /**
+     * @return The fill function for kernel, or null if the CPU doesn't support it.
+     */
+    [[nodiscard]] static FillRgbFunc KernelFunc(Kernel kernel) noexcept;
+
+    /**
+     *   The depth tested fill for kernel, or null if the CPU doesn't
+     * support it. There is no AVX2 depth test, AVX2 uses SSE2's.
+     */
+    [[nodiscard]] static FillRgbDepthFunc DepthKernelFunc(Kernel kernel) noexcept;
+private:
+    static Kernel SelectKernel() noexcept;
+private:
+    static Kernel s_ActiveKernel;
+    static FillRgbFunc s_FillRgb;
+    static FillRgbDepthFunc s_FillRgbDepth;
+};
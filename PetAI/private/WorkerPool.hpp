@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Objects.hpp"
+#include "PetAI.h"
+#include "FunctionRef.hpp"
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+/**
+ *   A small fork-join pool used to split a range of work items across
+ * several threads.
+ *
+ *   The range is cut into chunks, and each participant (the worker
+ * threads, plus the thread calling ParallelFor) starts with an equal
+ * share of those chunks. A participant pops chunks from the front of
+ * its own share, and once that runs dry it steals the back half of
+ * another participant's share. ParallelFor does not return until every
+ * chunk has been processed.
+ *
+ *   Participant 0 is always the thread that called ParallelFor, worker
+ * threads are numbered from 1.
+ */
+class WorkerPool final
+{
+    DELETE_CM(WorkerPool);
+public:
+    /**
+     *   Processes the items [begin, end) on participant workerIndex. Bind
+     * a context with TaskFunc::Bind<&Class::Method>(instance).
+     */
+    using TaskFunc = FunctionRef<void(::std::uint32_t workerIndex, ::std::uint32_t begin, ::std::uint32_t end)>;
+
+    static inline constexpr ::std::uint32_t MaxThreadCount = 64;
+public:
+    WorkerPool() noexcept;
+
+    ~WorkerPool() noexcept;
+
+    /**
+     * Starts the pool.
+     *
+     * @param threadCount The total number of threads that will process
+     *   work, including the thread calling ParallelFor. 0 and 1 both
+     *   result in all work being done on the calling thread.
+     * @return A status code.
+     */
+    PetStatus Start(::std::uint32_t threadCount) noexcept;
+
+    /**
+     * Joins all worker threads. This must not be called from inside a
+     * task.
+     */
+    void Stop() noexcept;
+
+    /**
+     * @return The number of participants, including the calling thread.
+     */
+    [[nodiscard]] ::std::uint32_t ThreadCount() const noexcept { return static_cast<::std::uint32_t>(m_Workers.size()) + 1; }
+
+    void ParallelFor(::std::uint32_t itemCount, ::std::uint32_t chunkSize, TaskFunc func) noexcept;
+private:
+    /**
+     *   The chunks still owned by a participant, packed as
+     * (begin << 32) | end so that the owner and thieves can race on a
+     * single word.
+     */
+    struct alignas(64) ChunkRange final
+    {
+        ::std::atomic<::std::uint64_t> Range;
+    };
+private:
+    void WorkerMain(::std::uint32_t workerIndex, ::std::uint32_t startGeneration) noexcept;
+
+    void RunChunks(::std::uint32_t workerIndex) noexcept;
+
+    [[nodiscard]] bool PopChunk(::std::uint32_t workerIndex, ::std::uint32_t* pChunk) noexcept;
+    [[nodiscard]] bool StealChunk(::std::uint32_t workerIndex, ::std::uint32_t* pChunk) noexcept;
+
+    static ::std::uint64_t PackRange(const ::std::uint32_t begin, const ::std::uint32_t end) noexcept
+    {
+        return (static_cast<::std::uint64_t>(begin) << 32) | static_cast<::std::uint64_t>(end);
+    }
+
+    static ::std::uint32_t RangeBegin(const ::std::uint64_t range) noexcept { return static_cast<::std::uint32_t>(range >> 32); }
+    static ::std::uint32_t RangeEnd(const ::std::uint64_t range) noexcept { return static_cast<::std::uint32_t>(range); }
+private:
+    ::std::vector<::std::thread> m_Workers;
+    ChunkRange* m_Ranges;
+
+    /**
+     *   Bumped to publish a new job (or a stop request) to the workers.
+     * Everything below it is written before the bump, and only read by
+     * the workers after they have observed it.
+     */
+    ::std::atomic<::std::uint32_t> m_Generation;
+    ::std::atomic<::std::uint32_t> m_BusyWorkers;
+    ::std::atomic_bool m_Stopping;
+
+    TaskFunc m_Func;
+    ::std::uint32_t m_ItemCount;
+    ::std::uint32_t m_ChunkSize;
+};
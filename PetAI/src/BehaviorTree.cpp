@@ -1,4 +1,5 @@
 #include "BehaviorTree.hpp"
+#include "CompiledBehaviorTree.hpp"
 
 void BehaviorTreeNode::Execute(BehaviorTreeExecutor& executor) const noexcept
 {
@@ -25,6 +26,125 @@ void BehaviorTreeActionNode::Execute(BehaviorTreeExecutor& executor) const noexc
 }
 
 void BehaviorTreeExecutor::Tick(const float deltaTime) noexcept
+{
+    BeginTick(deltaTime);
+
+    if(PendingAction() >= 0)
+    {
+        RunPendingAction();
+    }
+
+    EndTick();
+}
+
+void BehaviorTreeExecutor::BeginTick(const float deltaTime) noexcept
+{
+    m_SuspendTime = 0;
+    m_CurrentDeltaTime = deltaTime;
+}
+
+void BehaviorTreeExecutor::RunPendingAction() noexcept
+{
+    ExecuteCompiled(m_CurrentIndex);
+}
+
+void BehaviorTreeExecutor::EndTick() noexcept
+{
+    if(m_CompiledTree)
+    {
+        AdvanceCompiled();
+    }
+    else
+    {
+        TickPointer();
+    }
+}
+
+BehaviorTreeExecutor::Snapshot BehaviorTreeExecutor::SaveState() const noexcept
+{
+    Snapshot snapshot {};
+
+    if(m_CompiledTree)
+    {
+        snapshot.CurrentNode = m_CurrentIndex;
+    }
+    else
+    {
+        snapshot.CurrentNode = m_Current ? m_Current->StateIndex() : -1;
+    }
+
+    snapshot.State = static_cast<::std::uint32_t>(m_CurrentState);
+    snapshot.DeltaTime = m_CurrentDeltaTime;
+    snapshot.SuspendTime = m_SuspendTime;
+
+    return snapshot;
+}
+
+static const BehaviorTreeNode* FindNode(const BehaviorTreeNode* const node, const ::std::int32_t stateIndex) noexcept
+{
+    if(!node)
+    {
+        return nullptr;
+    }
+
+    if(node->StateIndex() == stateIndex)
+    {
+        return node;
+    }
+
+    for(::std::uint32_t i = 0; i < node->ChildCount(); ++i)
+    {
+        if(const BehaviorTreeNode* const found = FindNode(node->Children()[i], stateIndex))
+        {
+            return found;
+        }
+    }
+
+    return nullptr;
+}
+
+PetStatus BehaviorTreeExecutor::RestoreState(const Snapshot& snapshot) noexcept
+{
+    if(snapshot.State > FinishedNode || snapshot.CurrentNode < -1)
+    {
+        return PetInvalidArg;
+    }
+
+    if(m_CompiledTree)
+    {
+        if(snapshot.CurrentNode >= static_cast<::std::int32_t>(m_CompiledTree->NodeCount()))
+        {
+            return PetInvalidArg;
+        }
+
+        m_CurrentIndex = snapshot.CurrentNode;
+    }
+    else
+    {
+        const BehaviorTreeNode* current = nullptr;
+
+        if(snapshot.CurrentNode >= 0)
+        {
+            InitState();
+            current = FindNode(m_Root, snapshot.CurrentNode);
+
+            if(!current)
+            {
+                return PetInvalidArg;
+            }
+        }
+
+        m_Current = current;
+    }
+
+    m_CurrentState = static_cast<State>(snapshot.State);
+    m_CurrentDeltaTime = snapshot.DeltaTime;
+    m_SuspendTime = snapshot.SuspendTime;
+
+    return PetSuccess;
+}
+
+void BehaviorTreeExecutor::TickPointer() noexcept
 {
     if(!m_Root)
     {
@@ -50,8 +170,6 @@ void BehaviorTreeExecutor::Tick(const float deltaTime) noexcept
         return;
     }
 
-    m_CurrentDeltaTime = deltaTime;
-
     if(m_CurrentState == Running)
     {
         m_Current->Execute(*this);
@@ -67,7 +185,7 @@ void BehaviorTreeExecutor::Tick(const float deltaTime) noexcept
     }
 }
 
-static ::std::int32_t SequenceActionHandler(const BehaviorTreeSequenceNode& node, Blackboard& blackboard, const BlackboardKey sequenceKey) noexcept
+static ::std::int32_t SequenceActionHandler(const ::std::uint32_t childCount, Blackboard& blackboard, const BlackboardKey sequenceKey) noexcept
 {
     BehaviorTreeSequenceNode::SequenceKeyT* currentIndex = blackboard.GetT<BehaviorTreeSequenceNode::SequenceKeyT>(sequenceKey);
 
@@ -75,7 +193,7 @@ static ::std::int32_t SequenceActionHandler(const BehaviorTreeSequenceNode& node
 
     ++(*currentIndex);
 
-    if(static_cast<::std::uint32_t>(*currentIndex) >= node.ChildCount())
+    if(static_cast<::std::uint32_t>(*currentIndex) >= childCount)
     {
         *currentIndex = 0;
     }
@@ -98,7 +216,7 @@ void BehaviorTreeExecutor::Execute(const BehaviorTreeNode& node) noexcept
 
 void BehaviorTreeExecutor::Execute(const BehaviorTreeSequenceNode& node) noexcept
 {
-    const ::std::int32_t nodeIndex = SequenceActionHandler(node, *m_Blackboard, node.SequenceKey());
+    const ::std::int32_t nodeIndex = SequenceActionHandler(node.ChildCount(), *m_Blackboard, node.SequenceKey());
 
     if(nodeIndex < 0 || static_cast<::std::uint32_t>(nodeIndex) >= node.ChildCount())
     {
@@ -151,10 +269,138 @@ void BehaviorTreeExecutor::Execute(const BehaviorTreeActionNode& node) noexcept
         return;
     }
 
-    if(node.Handler()(*m_PetManager, node, *m_Blackboard, m_CurrentDeltaTime))
+    ApplyActionResult(node.Handler()(*m_PetManager, node, *m_Blackboard, m_CurrentDeltaTime));
+}
+
+void BehaviorTreeExecutor::ApplyActionResult(const BehaviorTreeActionResult result) noexcept
+{
+    switch(result.ResultStatus())
     {
+        case BehaviorTreeActionResult::Finished:
+            m_CurrentState = FinishedNode;
+            break;
+        case BehaviorTreeActionResult::Suspended:
+            m_SuspendTime = result.SuspendTime();
+            break;
+        case BehaviorTreeActionResult::Running:
+        default:
+            break;
+    }
+}
+
+void BehaviorTreeExecutor::AdvanceCompiled() noexcept
+{
+    //   The pending action (if any) has already run, all that is left is
+    // to move on to the next action once it has finished.
+    const CompiledBehaviorTree& tree = *m_CompiledTree;
+
+    if(m_CurrentState == Uninitialized)
+    {
+        const CompiledBehaviorTree::Node& root = tree.Root();
+
+        if(!root.Source.Repeat->Continuation()(*m_PetManager, *root.Source.Repeat, *m_Blackboard))
+        {
+            return;
+        }
+
+        m_CurrentIndex = tree.Child(root, 0);
+
         m_CurrentState = FinishedNode;
     }
+
+    if(m_CurrentIndex < 0)
+    {
+        return;
+    }
+
+    if(m_CurrentState == FinishedNode)
+    {
+        ExecuteCompiled(tree.Nodes()[m_CurrentIndex].Parent);
+
+        m_CurrentState = Running;
+    }
+}
+
+void BehaviorTreeExecutor::ExecuteCompiled(::std::int32_t nodeIndex) noexcept
+{
+    const CompiledBehaviorTree& tree = *m_CompiledTree;
+    const CompiledBehaviorTree::Node* const nodes = tree.Nodes();
+
+    //   This follows the same rules as the Execute overloads, but walks
+    // the flattened tree in a loop instead of recursing through the
+    // virtual Execute.
+    while(nodeIndex >= 0)
+    {
+        const CompiledBehaviorTree::Node& node = nodes[nodeIndex];
+
+        switch(node.Type)
+        {
+            case BehaviorTreeNodeType::Sequence:
+            {
+                const ::std::int32_t childIndex = SequenceActionHandler(node.ChildCount, *m_Blackboard, node.Key);
+
+                if(childIndex < 0 || static_cast<::std::uint32_t>(childIndex) >= node.ChildCount)
+                {
+                    nodeIndex = node.Parent;
+                    break;
+                }
+
+                nodeIndex = tree.Child(node, static_cast<::std::uint32_t>(childIndex));
+                break;
+            }
+            case BehaviorTreeNodeType::Selector:
+            {
+                BehaviorTreeSelectorNode::SelectorKeyT* selector = m_Blackboard->GetT<BehaviorTreeSelectorNode::SelectorKeyT>(node.Key);
+                if(*selector)
+                {
+                    *selector = false;
+                    nodeIndex = node.Parent;
+                    break;
+                }
+
+                const ::std::int32_t childIndex = node.Source.Selector->Selector()(*m_PetManager, *node.Source.Selector, *m_Blackboard);
+
+                if(childIndex < 0 || static_cast<::std::uint32_t>(childIndex) >= node.ChildCount)
+                {
+                    nodeIndex = node.Parent;
+                    break;
+                }
+
+                *selector = true;
+
+                nodeIndex = tree.Child(node, static_cast<::std::uint32_t>(childIndex));
+                break;
+            }
+            case BehaviorTreeNodeType::Repeat:
+            {
+                if(!node.Source.Repeat->Continuation()(*m_PetManager, *node.Source.Repeat, *m_Blackboard))
+                {
+                    nodeIndex = node.Parent;
+                    break;
+                }
+
+                nodeIndex = tree.Child(node, 0);
+                break;
+            }
+            case BehaviorTreeNodeType::Action:
+            {
+                if(m_CurrentState == FinishedNode)
+                {
+                    m_CurrentIndex = nodeIndex;
+                    return;
+                }
+
+                if(node.Source.Action)
+                {
+                    ApplyActionResult(node.Source.Action->Handler()(*m_PetManager, *node.Source.Action, *m_Blackboard, m_CurrentDeltaTime));
+                }
+
+                return;
+            }
+            default:
+                return;
+        }
+    }
 }
 
 void BehaviorTreeExecutor::InitState() noexcept
@@ -187,11 +433,16 @@ void BehaviorTreeExecutor::InitState() noexcept
     return count;
 }
 
-::std::int32_t BehaviorTreeExecutor::InitChildren(BehaviorTreeNode* const node, const ::std::int32_t startIndex) const noexcept
+::std::int32_t BehaviorTreeExecutor::InitChildren(BehaviorTreeNode* const node, const ::std::int32_t startIndex) noexcept
 {
     if(!node)
     {
-        return 0;
+        return startIndex;
+    }
+
+    if(node->StateIndex() >= 0)
+    {
+        return startIndex;
     }
 
     ::std::int32_t index = startIndex;
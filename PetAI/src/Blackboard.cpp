@@ -1,5 +1,8 @@
 #include "Blackboard.hpp"
 #include "FNV1a.hpp"
+#include <algorithm>
+#include <cstring>
+#include <new>
 
 bool operator==(const BlackboardKeyName& left, const BlackboardKeyName& right) noexcept
 {
@@ -132,93 +135,595 @@ bool operator<=(const BlackboardKeyName& left, const BlackboardKeyData& right) n
 }
 
 BlackboardKeyManager::BlackboardKeyManager() noexcept
-    : m_NameTree{}
+    : m_Entries(nullptr)
+    , m_EntryCount(0)
+    , m_EntryCapacity(0)
+    , m_Slots(nullptr)
+    , m_SlotCount(0)
+    , m_NameOrder(nullptr)
+    , m_NameOrderValid(false)
     , m_CurrentKeyIndex(0)
     , m_TotalSize(0)
 { }
 
-BlackboardKey BlackboardKeyManager::CalculateKey(const KeyChar* const key, const size_t dataSize) noexcept
+BlackboardKeyManager::~BlackboardKeyManager() noexcept
+{
+    delete[] m_Entries;
+    delete[] m_Slots;
+    delete[] m_NameOrder;
+}
+
+BlackboardKey BlackboardKeyManager::CalculateKey(const KeyChar* const key, const size_t dataSize, const BlackboardKeyStorage storage) noexcept
 {
     const size_t length = StringLength(key);
-    const uint32_t hash = Victoria::FNV1A(key);
+    const uint32_t hash = Victoria::FNV1AIterative(key, length);
 
     const BlackboardKeyName keyName(hash, static_cast<uint32_t>(length), key);
 
-    const BlackboardKeyData* const foundKey = m_NameTree.Find(keyName);
+    const uint32_t slot = FindSlot(keyName);
 
-    if(foundKey)
+    if(slot != EmptySlot && m_Slots[slot] != EmptySlot)
     {
-        return foundKey->Key;
+        BlackboardKeyData& foundKey = m_Entries[m_Slots[slot]];
+
+        if(foundKey.DataSize == 0 && dataSize != 0)
+        {
+            foundKey.DataSize = dataSize;
+            foundKey.Storage = storage;
+            m_TotalSize += dataSize;
+        }
+
+        return foundKey.Key;
     }
 
-    const BlackboardKey retKey(m_CurrentKeyIndex++);
+    const BlackboardKeyData* const newKey = AddEntry(BlackboardKey(m_CurrentKeyIndex), keyName, dataSize, storage);
 
-    m_NameTree.Emplace(retKey, keyName, dataSize);
-    m_TotalSize += dataSize;
+    if(!newKey)
+    {
+        DebugPrintF(u8"[BlackboardKeyManager::CalculateKey]: Failed to register a key.\n");
+        return BlackboardKey(-1);
+    }
+
+    ++m_CurrentKeyIndex;
+
+    return newKey->Key;
+}
+
+void BlackboardKeyManager::StoreKey(BlackboardKey key, const BlackboardKeyName& name, const size_t dataSize, const BlackboardKeyStorage storage) noexcept
+{
+    const uint32_t slot = FindSlot(name);
+
+    if(slot != EmptySlot && m_Slots[slot] != EmptySlot)
+    {
+        BlackboardKeyData& existing = m_Entries[m_Slots[slot]];
+        m_TotalSize -= existing.DataSize;
+        existing = BlackboardKeyData(key, name, dataSize, storage);
+        m_TotalSize += dataSize;
+    }
+    else if(!AddEntry(key, name, dataSize, storage))
+    {
+        DebugPrintF(u8"[BlackboardKeyManager::StoreKey]: Failed to register key %d.\n", key.Key);
+        return;
+    }
+
+    // Keep CalculateKey from handing out a key that was loaded.
+    if(key.Key >= m_CurrentKeyIndex)
+    {
+        m_CurrentKeyIndex = key.Key + 1;
+    }
+}
+
+const BlackboardKeyData* BlackboardKeyManager::Find(const BlackboardKeyName& name) const noexcept
+{
+    const uint32_t slot = FindSlot(name);
+
+    if(slot == EmptySlot || m_Slots[slot] == EmptySlot)
+    {
+        return nullptr;
+    }
+
+    return &m_Entries[m_Slots[slot]];
+}
+
+const uint32_t* BlackboardKeyManager::NameOrder() const noexcept
+{
+    if(!m_NameOrderValid && m_NameOrder)
+    {
+        for(uint32_t i = 0; i < m_EntryCount; ++i)
+        {
+            m_NameOrder[i] = i;
+        }
+
+        ::std::sort(m_NameOrder, m_NameOrder + m_EntryCount, [this](const uint32_t left, const uint32_t right)
+        {
+            return StringCompare(m_Entries[left].Name.String, m_Entries[right].Name.String) < 0;
+        });
+
+        m_NameOrderValid = true;
+    }
+
+    return m_NameOrder;
+}
+
+uint32_t BlackboardKeyManager::FindSlot(const BlackboardKeyName& name) const noexcept
+{
+    if(!m_Slots)
+    {
+        return EmptySlot;
+    }
+
+    const uint32_t mask = m_SlotCount - 1;
+
+    // Linear probing, the table is never full so this always finds an empty slot.
+    for(uint32_t slot = name.Hash & mask; ; slot = (slot + 1) & mask)
+    {
+        const uint32_t entryIndex = m_Slots[slot];
+
+        if(entryIndex == EmptySlot)
+        {
+            return slot;
+        }
+
+        const BlackboardKeyName& entryName = m_Entries[entryIndex].Name;
+
+        if(entryName.Hash == name.Hash && entryName.Length == name.Length && StringCompare(entryName.String, name.String) == 0)
+        {
+            return slot;
+        }
+    }
+}
+
+PetStatus BlackboardKeyManager::Reserve(const uint32_t entryCount) noexcept
+{
+    if(entryCount > m_EntryCapacity)
+    {
+        uint32_t newCapacity = m_EntryCapacity > 0 ? m_EntryCapacity : InitialSlotCount / 2;
+
+        while(newCapacity < entryCount)
+        {
+            newCapacity *= 2;
+        }
+
+        BlackboardKeyData* const newEntries = new(::std::nothrow) BlackboardKeyData[newCapacity];
+        uint32_t* const newNameOrder = new(::std::nothrow) uint32_t[newCapacity];
+
+        if(!newEntries || !newNameOrder)
+        {
+            delete[] newEntries;
+            delete[] newNameOrder;
+            return PetOutOfMemory;
+        }
+
+        for(uint32_t i = 0; i < m_EntryCount; ++i)
+        {
+            newEntries[i] = m_Entries[i];
+        }
+
+        delete[] m_Entries;
+        delete[] m_NameOrder;
+
+        m_Entries = newEntries;
+        m_NameOrder = newNameOrder;
+        m_NameOrderValid = false;
+        m_EntryCapacity = newCapacity;
+    }
+
+    // Keep the load factor at or below 1/2, so that probe sequences stay short.
+    if(static_cast<uint64_t>(entryCount) * 2 <= m_SlotCount)
+    {
+        return PetSuccess;
+    }
+
+    uint32_t newSlotCount = m_SlotCount > 0 ? m_SlotCount : InitialSlotCount;
+
+    while(static_cast<uint64_t>(entryCount) * 2 > newSlotCount)
+    {
+        newSlotCount *= 2;
+    }
+
+    uint32_t* const newSlots = new(::std::nothrow) uint32_t[newSlotCount];
+
+    if(!newSlots)
+    {
+        return PetOutOfMemory;
+    }
+
+    for(uint32_t i = 0; i < newSlotCount; ++i)
+    {
+        newSlots[i] = EmptySlot;
+    }
+
+    delete[] m_Slots;
+    m_Slots = newSlots;
+    m_SlotCount = newSlotCount;
 
-    return retKey;
+    const uint32_t mask = m_SlotCount - 1;
+
+    for(uint32_t i = 0; i < m_EntryCount; ++i)
+    {
+        uint32_t slot = m_Entries[i].Name.Hash & mask;
+
+        while(m_Slots[slot] != EmptySlot)
+        {
+            slot = (slot + 1) & mask;
+        }
+
+        m_Slots[slot] = i;
+    }
+
+    return PetSuccess;
 }
 
-void BlackboardKeyManager::StoreKey(BlackboardKey key, const BlackboardKeyName& name, const size_t dataSize) noexcept
+BlackboardKeyData* BlackboardKeyManager::AddEntry(const BlackboardKey key, const BlackboardKeyName& name, const size_t dataSize, const BlackboardKeyStorage storage) noexcept
 {
-    m_NameTree.Emplace(key, name, dataSize);
+    if(IsStatusError(Reserve(m_EntryCount + 1)))
+    {
+        return nullptr;
+    }
+
+    const uint32_t slot = FindSlot(name);
+    const uint32_t entryIndex = m_EntryCount++;
+
+    m_Slots[slot] = entryIndex;
+    m_Entries[entryIndex] = BlackboardKeyData(key, name, dataSize, storage);
+    m_NameOrderValid = false;
     m_TotalSize += dataSize;
+
+    return &m_Entries[entryIndex];
 }
 
-Blackboard::Blackboard(const BlackboardKeyManager& keyManager) noexcept
-    : m_KeyManager(&keyManager)
-    , m_BlackboardData(Alloc(keyManager.TotalSize()))
-    , m_BlackboardSize(keyManager.TotalSize())
+BlackboardColumns::BlackboardColumns() noexcept
+    : m_Columns(nullptr)
     , m_KeyCount(0)
-    , m_KeyOffsets(nullptr)
-    , m_CurrentOffset(0)
+    , m_SlotCount(0)
+    , m_SlotCapacity(0)
+    , m_FreeSlots(nullptr)
+    , m_FreeSlotCount(0)
+{ }
+
+BlackboardColumns::~BlackboardColumns() noexcept
 {
-    ZeroMem(m_BlackboardData, m_BlackboardSize);
+    Reset();
+}
 
-    keyManager.NameTree().Iterate(this, &Blackboard::CountKeyCallback);
+void BlackboardColumns::Reset() noexcept
+{
+    for(int32_t i = 0; i < m_KeyCount; ++i)
+    {
+        Free(m_Columns[i].Data);
+    }
 
-    m_KeyOffsets = new size_t[m_KeyCount];
+    delete[] m_Columns;
+    delete[] m_FreeSlots;
 
-    keyManager.NameTree().Iterate<Blackboard, decltype(&Blackboard::AddOffsetsCallback), IteratorMethod::LowestToHighest>(this, &Blackboard::AddOffsetsCallback);
+    m_Columns = nullptr;
+    m_KeyCount = 0;
+    m_SlotCount = 0;
+    m_SlotCapacity = 0;
+    m_FreeSlots = nullptr;
+    m_FreeSlotCount = 0;
 }
 
-Blackboard::~Blackboard() noexcept
+PetStatus BlackboardColumns::Init(const BlackboardKeyManager& keyManager) noexcept
 {
-    Free(m_KeyOffsets);
-    Free(m_BlackboardData);
+    Reset();
+
+    // Always allocate at least one entry, so that IsInitialized holds for a key manager without keys.
+    const int32_t keyCount = keyManager.KeyCount() > 0 ? keyManager.KeyCount() : 1;
+
+    m_Columns = new(::std::nothrow) ColumnArray[keyCount];
+
+    if(!m_Columns)
+    {
+        return PetOutOfMemory;
+    }
+
+    ZeroMem(m_Columns, sizeof(ColumnArray) * static_cast<size_t>(keyCount));
+    m_KeyCount = keyCount;
+
+    for(uint32_t i = 0; i < keyManager.EntryCount(); ++i)
+    {
+        AddColumn(keyManager.Entries()[i]);
+    }
+
+    return PetSuccess;
 }
 
-void Blackboard::CountKeyCallback(const BlackboardKeyManager::TreeT::Node* node) noexcept
+void BlackboardColumns::AddColumn(const BlackboardKeyData& keyData) noexcept
 {
-    ++m_KeyCount;
+    if(keyData.Storage != BlackboardKeyStorage::Column)
+    {
+        return;
+    }
+
+    const int32_t key = keyData.Key.Key;
+
+    if(key < 0 || key >= m_KeyCount)
+    {
+        return;
+    }
+
+    m_Columns[key].ElementSize = keyData.DataSize;
 }
 
-void Blackboard::AddOffsetsCallback(const BlackboardKeyManager::TreeT::Node* node) noexcept
+PetStatus BlackboardColumns::AllocSlot(uint32_t* const pSlot) noexcept
 {
-    if(!node)
+    if(!pSlot)
+    {
+        return PetInvalidArg;
+    }
+
+    if(m_FreeSlotCount > 0)
+    {
+        const uint32_t slot = m_FreeSlots[--m_FreeSlotCount];
+
+        for(int32_t i = 0; i < m_KeyCount; ++i)
+        {
+            const ColumnArray& column = m_Columns[i];
+
+            if(column.ElementSize > 0)
+            {
+                ZeroMem(static_cast<unsigned char*>(column.Data) + static_cast<size_t>(slot) * column.ElementSize, column.ElementSize);
+            }
+        }
+
+        *pSlot = slot;
+        return PetSuccess;
+    }
+
+    if(m_SlotCount == m_SlotCapacity)
+    {
+        const PetStatus status = Grow();
+
+        if(IsStatusError(status))
+        {
+            return status;
+        }
+    }
+
+    *pSlot = m_SlotCount++;
+
+    return PetSuccess;
+}
+
+void BlackboardColumns::FreeSlot(const uint32_t slot) noexcept
+{
+    if(slot >= m_SlotCount || m_FreeSlotCount >= m_SlotCount)
     {
         return;
     }
 
-    m_KeyOffsets[node->Value.Key.Key] = m_CurrentOffset;
-    m_CurrentOffset += node->Value.DataSize;
+    m_FreeSlots[m_FreeSlotCount++] = slot;
+}
+
+PetStatus BlackboardColumns::Grow() noexcept
+{
+    const uint32_t newCapacity = m_SlotCapacity > 0 ? m_SlotCapacity * 2 : 64;
+
+    uint32_t* const newFreeSlots = new(::std::nothrow) uint32_t[newCapacity];
+
+    if(!newFreeSlots)
+    {
+        return PetOutOfMemory;
+    }
+
+    if(m_FreeSlots)
+    {
+        ::std::memcpy(newFreeSlots, m_FreeSlots, sizeof(uint32_t) * m_FreeSlotCount);
+    }
+
+    delete[] m_FreeSlots;
+    m_FreeSlots = newFreeSlots;
+
+    for(int32_t i = 0; i < m_KeyCount; ++i)
+    {
+        ColumnArray& column = m_Columns[i];
+
+        if(column.ElementSize == 0)
+        {
+            continue;
+        }
+
+        const size_t oldSize = column.ElementSize * m_SlotCapacity;
+        const size_t newSize = column.ElementSize * newCapacity;
+
+        void* const newData = Alloc(newSize);
+
+        if(!newData)
+        {
+            // The columns that were already grown are fine to keep, the capacity just doesn't change.
+            return PetOutOfMemory;
+        }
+
+        ZeroMem(newData, newSize);
+
+        if(column.Data)
+        {
+            ::std::memcpy(newData, column.Data, oldSize);
+            Free(column.Data);
+        }
+
+        column.Data = newData;
+    }
+
+    m_SlotCapacity = newCapacity;
+
+    return PetSuccess;
+}
+
+BlackboardLayout::BlackboardLayout() noexcept
+    : m_KeyOffsets(nullptr)
+    , m_KeyDirtyMasks(nullptr)
+    , m_DirtyLineShift(MinDirtyLineShift)
+    , m_KeyCount(0)
+    , m_DataSize(0)
+    , m_ReservedSize(0)
+    , m_Columns(nullptr)
+{ }
+
+BlackboardLayout::~BlackboardLayout() noexcept
+{
+    Reset();
+}
+
+void BlackboardLayout::Reset() noexcept
+{
+    delete[] m_KeyOffsets;
+    delete[] m_KeyDirtyMasks;
+
+    m_KeyOffsets = nullptr;
+    m_KeyDirtyMasks = nullptr;
+    m_DirtyLineShift = MinDirtyLineShift;
+    m_KeyCount = 0;
+    m_DataSize = 0;
+    m_ReservedSize = 0;
+    m_Columns = nullptr;
+}
+
+PetStatus BlackboardLayout::Init(const BlackboardKeyManager& keyManager, BlackboardColumns* const columns, const size_t reservedSize) noexcept
+{
+    Reset();
+
+    // Always allocate at least one entry, so that IsInitialized holds for a key manager without keys.
+    const int32_t keyCount = keyManager.KeyCount() > 0 ? keyManager.KeyCount() : 1;
+
+    m_KeyOffsets = new(::std::nothrow) size_t[keyCount];
+    m_KeyDirtyMasks = new(::std::nothrow) uint64_t[keyCount];
+
+    if(!m_KeyOffsets || !m_KeyDirtyMasks)
+    {
+        Reset();
+        return PetOutOfMemory;
+    }
+
+    for(int32_t i = 0; i < keyCount; ++i)
+    {
+        m_KeyOffsets[i] = InvalidOffset;
+        m_KeyDirtyMasks[i] = 0;
+    }
+
+    m_KeyCount = keyCount;
+    m_DataSize = reservedSize;
+    m_ReservedSize = reservedSize;
+    m_Columns = columns && columns->IsInitialized() ? columns : nullptr;
+
+    const uint32_t* const nameOrder = keyManager.NameOrder();
+
+    for(uint32_t i = 0; i < keyManager.EntryCount(); ++i)
+    {
+        AddOffset(keyManager.Entries()[nameOrder[i]]);
+    }
+
+    // Grow the lines until 64 of them cover the whole blackboard.
+    while((static_cast<size_t>(64) << m_DirtyLineShift) < m_DataSize)
+    {
+        ++m_DirtyLineShift;
+    }
+
+    for(uint32_t i = 0; i < keyManager.EntryCount(); ++i)
+    {
+        const BlackboardKeyData& keyData = keyManager.Entries()[i];
+        const size_t offset = Offset(keyData.Key);
+
+        if(offset < m_DataSize)
+        {
+            m_KeyDirtyMasks[keyData.Key.Key] = DirtyMask(offset, keyData.DataSize);
+        }
+    }
+
+    return PetSuccess;
+}
+
+void BlackboardLayout::AddOffset(const BlackboardKeyData& keyData) noexcept
+{
+    if(keyData.Key.Key < 0 || keyData.Key.Key >= m_KeyCount)
+    {
+        return;
+    }
+
+    if(m_Columns && m_Columns->IsColumn(keyData.Key))
+    {
+        m_KeyOffsets[keyData.Key.Key] = ColumnOffset;
+        return;
+    }
+
+    m_KeyOffsets[keyData.Key.Key] = m_DataSize;
+    m_DataSize += keyData.DataSize;
+}
+
+Blackboard::Blackboard(const BlackboardLayout& layout, const uint32_t columnSlot) noexcept
+    : m_Layout(&layout)
+    , m_BlackboardData(Alloc(layout.DataSize()))
+    , m_ColumnSlot(columnSlot)
+    , m_OwnsData(true)
+    , m_ColumnsDirty(false)
+    , m_DirtyLines(0)
+{
+    if(m_BlackboardData)
+    {
+        ZeroMem(m_BlackboardData, layout.DataSize());
+    }
+}
+
+Blackboard::Blackboard(const BlackboardLayout& layout, const uint32_t columnSlot, void* const storage) noexcept
+    : m_Layout(&layout)
+    , m_BlackboardData(storage)
+    , m_ColumnSlot(columnSlot)
+    , m_OwnsData(false)
+    , m_ColumnsDirty(false)
+    , m_DirtyLines(0)
+{
+    if(m_BlackboardData)
+    {
+        ZeroMem(m_BlackboardData, layout.DataSize());
+    }
+}
+
+Blackboard::~Blackboard() noexcept
+{
+    if(m_OwnsData)
+    {
+        Free(m_BlackboardData);
+    }
 }
 
 void* Blackboard::Get(const BlackboardKey key) noexcept
 {
-    if(key.Key >= m_KeyCount)
+    const size_t offset = m_Layout->Offset(key);
+
+    if(offset == BlackboardLayout::ColumnOffset)
+    {
+        m_ColumnsDirty = true;
+        return m_Layout->Columns()->Get(key, m_ColumnSlot);
+    }
+
+    if(!m_BlackboardData || offset >= m_Layout->DataSize())
     {
         return nullptr;
     }
 
-    const size_t offset = m_KeyOffsets[key.Key];
+    m_DirtyLines |= m_Layout->DirtyMask(key);
+
+    unsigned char* byteStream = static_cast<unsigned char*>(m_BlackboardData);
+
+    return &byteStream[offset];
+}
 
-    if(offset >= m_BlackboardSize)
+const void* Blackboard::Get(const BlackboardKey key) const noexcept
+{
+    const size_t offset = m_Layout->Offset(key);
+
+    if(offset == BlackboardLayout::ColumnOffset)
+    {
+        return m_Layout->Columns()->Get(key, m_ColumnSlot);
+    }
+
+    if(!m_BlackboardData || offset >= m_Layout->DataSize())
     {
         return nullptr;
     }
 
-    unsigned char* byteStream = static_cast<unsigned char*>(m_BlackboardData);
+    const unsigned char* byteStream = static_cast<const unsigned char*>(m_BlackboardData);
 
     return &byteStream[offset];
 }
@@ -0,0 +1,168 @@
+#include "CheckpointWriter.hpp"
+#include <SysLib.h>
+#include <cstring>
+
+void CheckpointBatch::Append(const ::std::size_t fileOffset, const void* const data, const ::std::size_t size) noexcept
+{
+    if(size == 0)
+    {
+        return;
+    }
+
+    const ::std::size_t dataOffset = m_Data.size();
+
+    m_Data.resize(dataOffset + size);
+    (void) ::std::memcpy(m_Data.data() + dataOffset, data, size);
+
+    if(!m_Ranges.empty())
+    {
+        Range& last = m_Ranges.back();
+
+        if(last.FileOffset + last.Size == fileOffset && last.DataOffset + last.Size == dataOffset)
+        {
+            last.Size += size;
+            return;
+        }
+    }
+
+    m_Ranges.push_back({ fileOffset, dataOffset, size });
+}
+
+PetStatus CheckpointBatch::Write(SavePetState_f* const savePetState, const PetAppHandle appHandle, const PetFileHandle file) const noexcept
+{
+    for(const Range& range : m_Ranges)
+    {
+        const PetStatus status = savePetState(appHandle, file, range.FileOffset, m_Data.data() + range.DataOffset, range.Size);
+
+        if(!IsStatusSuccess(status))
+        {
+            return status;
+        }
+    }
+
+    return PetSuccess;
+}
+
+CheckpointWriter::CheckpointWriter() noexcept
+    : m_Thread()
+    , m_Batches()
+    , m_Results()
+    , m_SavePetState(nullptr)
+    , m_AppHandle { nullptr }
+    , m_File(0)
+    , m_Submitted(0)
+    , m_Completed(0)
+    , m_Wakeups(0)
+    , m_Stopping(false)
+    , m_Reported(0)
+{ }
+
+CheckpointWriter::~CheckpointWriter() noexcept
+{
+    Stop();
+}
+
+PetStatus CheckpointWriter::Start(SavePetState_f* const savePetState, const PetAppHandle appHandle, const PetFileHandle file) noexcept
+{
+    Stop();
+
+    if(!savePetState)
+    {
+        return PetInvalidArg;
+    }
+
+    m_SavePetState = savePetState;
+    m_AppHandle = appHandle;
+    m_File = file;
+    m_Stopping.store(false, ::std::memory_order_relaxed);
+
+    m_Thread = ::std::thread(&CheckpointWriter::WriterMain, this);
+
+    return PetSuccess;
+}
+
+void CheckpointWriter::Stop() noexcept
+{
+    if(!m_Thread.joinable())
+    {
+        return;
+    }
+
+    m_Stopping.store(true, ::std::memory_order_release);
+    m_Wakeups.fetch_add(1, ::std::memory_order_release);
+    m_Wakeups.notify_one();
+
+    m_Thread.join();
+}
+
+CheckpointBatch* CheckpointWriter::AcquireBatch() noexcept
+{
+    const ::std::uint32_t submitted = m_Submitted.load(::std::memory_order_relaxed);
+
+    // A batch is free once its result was popped.
+    if(submitted - m_Reported >= BatchCount)
+    {
+        return nullptr;
+    }
+
+    CheckpointBatch& batch = m_Batches[submitted % BatchCount];
+    batch.Clear();
+    return &batch;
+}
+
+void CheckpointWriter::Submit() noexcept
+{
+    m_Submitted.fetch_add(1, ::std::memory_order_release);
+    m_Wakeups.fetch_add(1, ::std::memory_order_release);
+    m_Wakeups.notify_one();
+}
+
+bool CheckpointWriter::PopResult(Result* const pResult) noexcept
+{
+    if(m_Reported == m_Completed.load(::std::memory_order_acquire))
+    {
+        return false;
+    }
+
+    *pResult = m_Results[m_Reported % BatchCount];
+    ++m_Reported;
+    return true;
+}
+
+void CheckpointWriter::WriterMain() noexcept
+{
+    ::std::uint32_t completed = m_Completed.load(::std::memory_order_relaxed);
+
+    while(true)
+    {
+        //   Read the wakeup count first, a submit or stop that lands after
+        // the checks below changes it, and the wait returns straight away.
+        const ::std::uint32_t wakeups = m_Wakeups.load(::std::memory_order_acquire);
+
+        if(m_Submitted.load(::std::memory_order_acquire) == completed)
+        {
+            // Everything submitted before the stop request has been written.
+            if(m_Stopping.load(::std::memory_order_acquire))
+            {
+                return;
+            }
+
+            m_Wakeups.wait(wakeups, ::std::memory_order_acquire);
+            continue;
+        }
+
+        const ::std::uint32_t index = completed % BatchCount;
+        const CheckpointBatch& batch = m_Batches[index];
+
+        m_Results[index].Status = batch.Write(m_SavePetState, m_AppHandle, m_File);
+        m_Results[index].BytesWritten = batch.ByteCount();
+
+        if(!IsStatusSuccess(m_Results[index].Status))
+        {
+            DebugPrintF(u8"[CheckpointWriter::WriterMain]: SavePetState returned status 0x%08X.\n", m_Results[index].Status);
+        }
+
+        ++completed;
+        m_Completed.store(completed, ::std::memory_order_release);
+    }
+}
@@ -0,0 +1,165 @@
+#include "CompiledBehaviorTree.hpp"
+#include <SysLib.h>
+#include <new>
+
+static void ResetStateIndices(BehaviorTreeNode* const node) noexcept
+{
+    if(!node || node->StateIndex() < 0)
+    {
+        return;
+    }
+
+    node->StateIndex() = -1;
+
+    for(::std::uint32_t i = 0; i < node->ChildCount(); ++i)
+    {
+        ResetStateIndices(node->Children()[i]);
+    }
+}
+
+static ::std::uint32_t CountChildLinks(const BehaviorTreeNode* const node, bool* const visited) noexcept
+{
+    if(!node || visited[node->StateIndex()])
+    {
+        return 0;
+    }
+
+    visited[node->StateIndex()] = true;
+
+    ::std::uint32_t count = node->ChildCount();
+
+    for(::std::uint32_t i = 0; i < node->ChildCount(); ++i)
+    {
+        count += CountChildLinks(node->Children()[i], visited);
+    }
+
+    return count;
+}
+
+CompiledBehaviorTree::~CompiledBehaviorTree() noexcept
+{
+    Reset();
+}
+
+void CompiledBehaviorTree::Reset() noexcept
+{
+    delete[] m_Nodes;
+    delete[] m_ChildIndices;
+
+    m_Nodes = nullptr;
+    m_NodeCount = 0;
+    m_ChildIndices = nullptr;
+    m_ChildIndexCount = 0;
+}
+
+PetStatus CompiledBehaviorTree::Compile(BehaviorTreeRepeatNode* const root) noexcept
+{
+    Reset();
+
+    if(!root)
+    {
+        return PetInvalidArg;
+    }
+
+    //   Renumber the tree, so that the indices are guaranteed to be the
+    // de-duplicated pre-order that the array is laid out in.
+    ResetStateIndices(root);
+    const ::std::int32_t nodeCount = BehaviorTreeExecutor::InitChildren(root, 0);
+
+    bool* const visited = new(::std::nothrow) bool[nodeCount];
+
+    if(!visited)
+    {
+        return PetOutOfMemory;
+    }
+
+    ZeroMem(visited, sizeof(bool) * static_cast<size_t>(nodeCount));
+    const ::std::uint32_t childIndexCount = CountChildLinks(root, visited);
+    delete[] visited;
+
+    m_Nodes = new(::std::nothrow) Node[nodeCount];
+    // Always allocate at least one child index, so that a tree made of a lone root still compiles.
+    m_ChildIndices = new(::std::nothrow) ::std::int32_t[childIndexCount > 0 ? childIndexCount : 1];
+
+    if(!m_Nodes || !m_ChildIndices)
+    {
+        Reset();
+        return PetOutOfMemory;
+    }
+
+    ZeroMem(m_Nodes, sizeof(Node) * static_cast<size_t>(nodeCount));
+
+    m_NodeCount = static_cast<::std::uint32_t>(nodeCount);
+    m_ChildIndexCount = childIndexCount;
+
+    ::std::uint32_t childOffset = 0;
+    CompileNode(root, &childOffset);
+
+    return PetSuccess;
+}
+
+void CompiledBehaviorTree::CompileNode(const BehaviorTreeNode* const node, ::std::uint32_t* const pChildOffset) noexcept
+{
+    if(!node)
+    {
+        return;
+    }
+
+    Node& compiled = m_Nodes[node->StateIndex()];
+
+    // Shared subtrees are only compiled the first time they are reached.
+    if(compiled.Compiled)
+    {
+        return;
+    }
+
+    compiled.Compiled = true;
+    compiled.Parent = node->Parent() ? node->Parent()->StateIndex() : -1;
+    compiled.ChildOffset = *pChildOffset;
+    compiled.ChildCount = node->ChildCount();
+    compiled.Key = BlackboardKey(-1);
+
+    if(const BehaviorTreeSequenceNode* const sequence = node->AsSequence())
+    {
+        compiled.Type = BehaviorTreeNodeType::Sequence;
+        compiled.Key = sequence->SequenceKey();
+        compiled.Source.Sequence = sequence;
+    }
+    else if(const BehaviorTreeSelectorNode* const selector = node->AsSelector())
+    {
+        compiled.Type = BehaviorTreeNodeType::Selector;
+        compiled.Key = selector->SelectorKey();
+        compiled.Source.Selector = selector;
+    }
+    else if(const BehaviorTreeRepeatNode* const repeat = node->AsRepeat())
+    {
+        compiled.Type = BehaviorTreeNodeType::Repeat;
+        compiled.Source.Repeat = repeat;
+    }
+    else if(const BehaviorTreeActionNode* const action = node->AsAction())
+    {
+        compiled.Type = BehaviorTreeNodeType::Action;
+        compiled.Source.Action = action;
+    }
+    else
+    {
+        DebugPrintF(u8"[CompiledBehaviorTree::CompileNode]: Node %d has an unknown type, treating it as an empty action.\n", node->StateIndex());
+        compiled.Type = BehaviorTreeNodeType::Action;
+        compiled.ChildCount = 0;
+        compiled.Source.Action = nullptr;
+        return;
+    }
+
+    *pChildOffset += compiled.ChildCount;
+
+    for(::std::uint32_t i = 0; i < compiled.ChildCount; ++i)
+    {
+        const BehaviorTreeNode* const child = node->Children()[i];
+        m_ChildIndices[compiled.ChildOffset + i] = child ? child->StateIndex() : -1;
+    }
+
+    for(::std::uint32_t i = 0; i < compiled.ChildCount; ++i)
+    {
+        CompileNode(node->Children()[i], pChildOffset);
+    }
+}
@@ -1,8 +1,11 @@
 #include "FileLoader.hpp"
+#include "PetManager.hpp"
+#include "FNV1a.hpp"
 #include <cstring>
 #include <algorithm>
 #include <iterator>
 #include <limits>
+#include <new>
 
 template<typename T>
 void FileUtils::FlipEndian(T& val) noexcept
@@ -28,12 +31,9 @@ FileBlockHandle FileBlock::Acquire(uint8_t*& receivingBlock) noexcept
 
 FileReader::~FileReader() noexcept
 {
-    if(m_DataBlock)
-    {
-        delete[] m_DataBlock;
-        m_DataBlock = nullptr;
-        m_DataBlockSize = 0;
-    }
+    delete[] m_DataBlock;
+    m_DataBlock = nullptr;
+    m_DataBlockSize = 0;
 }
 
 PetStatus FileReader::OpenFile(
@@ -80,9 +80,8 @@ PetStatus FileReader::OpenFile(
 PetStatus FileReader::Init() noexcept
 {
     m_FileLength = 0;
-    m_FileOffset = InvalidFileOffset;
 
-    PetStatus status = m_PetManager->AppFunctions().LoadPetState(m_PetManager->AppHandle(), BlackboardKeyFileHandle, 0, nullptr, &m_FileLength);
+    const PetStatus status = m_PetManager->AppFunctions().LoadPetState(m_PetManager->AppHandle(), m_FileHandle, 0, nullptr, &m_FileLength);
 
     if(!IsStatusSuccess(status))
     {
@@ -96,10 +95,20 @@ PetStatus FileReader::Init() noexcept
 
     // If the size of the file is smaller than the data block size, just allocate enough for the file.
     m_TargetBlockSize = ::std::min(m_FileLength, m_TargetBlockSize);
+    m_FileOffset = InvalidFileOffset;
+
+    // There is nothing to read in an empty file.
+    if(m_TargetBlockSize == 0)
+    {
+        return PetSuccess;
+    }
 
-    m_DataBlockSize = m_TargetBlockSize;
+    m_DataBlock = new(::std::nothrow) uint8_t[m_TargetBlockSize];
 
-    m_DataBlock = new uint8_t[m_DataBlockSize];
+    if(!m_DataBlock)
+    {
+        return PetOutOfMemory;
+    }
 
     return PetSuccess;
 }
@@ -121,88 +130,71 @@ PetStatus FileReader::ReadBytes(const size_t offset, void* const data, size_t* c
         return PetInvalidArg;
     }
 
-    PetStatus status = PetSuccess;
+    const size_t size = *pSize;
+    size_t readSize = 0;
 
-    // Do we need to read in a new block?
-    if(m_FileOffset == InvalidFileOffset || offset < m_FileOffset || offset > m_FileOffset + m_DataBlockSize)
+    while(readSize < size)
     {
-        m_DataBlockSize = m_TargetBlockSize;
-        status = m_PetManager->AppFunctions().LoadPetState(m_PetManager->AppHandle(), BlackboardKeyFileHandle, offset, m_DataBlock, &m_DataBlockSize);
+        const size_t position = offset + readSize;
+        const size_t blockOffset = position - position % m_TargetBlockSize;
+
+        const PetStatus status = LoadBlock(blockOffset);
 
         if(!IsStatusSuccess(status))
         {
-            if(status == PetInvalidArg)
-            {
-                return PetFail;
-            }
-
+            *pSize = readSize;
             return status;
         }
 
-        m_FileOffset = offset;
-    }
+        const size_t offsetInBlock = position - blockOffset;
 
-    size_t blockOffset = offset - m_FileOffset;
+        // The file got shorter since it was opened.
+        if(offsetInBlock >= m_DataBlockSize)
+        {
+            break;
+        }
 
-    // If the size is smaller than our block, then we can just trivially copy it.
-    if(blockOffset + *pSize < m_DataBlockSize)
-    {
-        (void) ::std::memcpy(data, m_DataBlock + blockOffset, *pSize);
+        const size_t copySize = ::std::min(size - readSize, m_DataBlockSize - offsetInBlock);
 
-        return PetSuccess;
+        (void) ::std::memcpy(static_cast<uint8_t*>(data) + readSize, m_DataBlock + offsetInBlock, copySize);
+        readSize += copySize;
     }
 
-    size_t sizeRemaining = *pSize;
-    size_t dataOffset = 0;
-    size_t readSize = m_DataBlockSize - blockOffset;
-    //   This is used to indicate that we can no longer read more of the
-    // file.
-    //   We will carry around to the next loop iteration, and exit after we
-    // copy from the data block;
-    bool exitNext = false;
+    *pSize = readSize;
 
-    while(sizeRemaining > 0)
-    {
-        (void) ::std::memcpy(static_cast<uint8_t*>(data) + dataOffset, m_DataBlock + blockOffset, readSize);
+    return PetSuccess;
+}
 
-        sizeRemaining -= readSize;
-        dataOffset += readSize;
+PetStatus FileReader::LoadBlock(const size_t fileOffset) noexcept
+{
+    if(fileOffset == m_FileOffset)
+    {
+        return PetSuccess;
+    }
 
-        if(exitNext)
-        {
-            *pSize -= sizeRemaining;
-        }
+    // Nothing is loaded if this fails part way.
+    m_FileOffset = InvalidFileOffset;
+    m_DataBlockSize = ::std::min(m_TargetBlockSize, m_FileLength - fileOffset);
 
-        m_FileOffset += m_DataBlockSize;
+    const PetStatus status = m_PetManager->AppFunctions().LoadPetState(m_PetManager->AppHandle(), m_FileHandle, fileOffset, m_DataBlock, &m_DataBlockSize);
 
-        m_DataBlockSize = m_TargetBlockSize;
-        status = m_PetManager->AppFunctions().LoadPetState(m_PetManager->AppHandle(), BlackboardKeyFileHandle, m_FileOffset, m_DataBlock, &m_DataBlockSize);
+    if(!IsStatusSuccess(status))
+    {
+        m_DataBlockSize = 0;
 
-        if(!IsStatusSuccess(status))
+        if(status == PetInvalidArg)
         {
-            if(status == PetInvalidArg)
-            {
-                return PetFail;
-            }
-
-            return status;
+            return PetFail;
         }
 
-        blockOffset = 0;
-        readSize = m_DataBlockSize;
-
-        if(m_DataBlockSize < m_TargetBlockSize)
-        {
-            exitNext = true;
-        }
+        return status;
     }
 
+    m_FileOffset = fileOffset;
+
     return PetSuccess;
 }
 
-static FileBlock BlackboardKeyBlock;
-static FileBlock BlackboardKeyStringBlock;
-
 #pragma pack(push, 1)
 struct BlackboardKeyIndice final
 {
@@ -214,124 +206,265 @@ struct BlackboardKeyIndice final
 
 BlackboardKeyLoader::~BlackboardKeyLoader() noexcept
 {
-    if(m_DataBlock)
+    Unload();
+}
+
+void BlackboardKeyLoader::Unload() noexcept
+{
+    if(m_OwnedData)
     {
-        delete[] m_DataBlock;
-        m_DataBlock = nullptr;
-        m_DataBlockSize = 0;
+        delete[] m_OwnedData;
     }
+    else if(m_FileData)
+    {
+        const PetStatus status = m_PetManager->AppFunctions().UnmapPetState(m_PetManager->AppHandle(), BlackboardKeyFileHandle, m_FileData, m_FileLength);
+
+        if(!IsStatusSuccess(status))
+        {
+            DebugPrintF(u8"[BlackboardKeyLoader::Unload]: UnmapPetState returned status 0x%08X.\n", status);
+        }
+    }
+
+    m_FileData = nullptr;
+    m_FileLength = 0;
+    m_OwnedData = nullptr;
 }
 
 PetStatus BlackboardKeyLoader::Load(BlackboardKeyManager& keyManager, PetManager& petManager) noexcept
 {
-    if(!petManager.AppFunctions().LoadPetState)
+    Unload();
+
+    m_PetManager = &petManager;
+
+    PetStatus status = MapFile(petManager);
+
+    if(status == PetNotImplemented)
     {
-        return PetSuccess;
+        status = ReadFile(petManager);
     }
 
-    FileBlockHandle block = BlackboardKeyBlock.Acquire(m_DataBlock);
+    if(!IsStatusSuccess(status))
+    {
+        return status;
+    }
+
+    // There is no key file.
+    if(!m_FileData)
+    {
+        return PetSuccess;
+    }
 
-    if(!block)
+    if(m_FileLength < sizeof(BlackboardKeyFileBaseHeader))
     {
+        Unload();
         return PetFail;
     }
 
-    m_FileLength = 0;
-    m_FileOffset = 0;
+    (void) ::std::memcpy(&m_BaseHeader, m_FileData, sizeof(m_BaseHeader));
 
-    PetStatus status = petManager.AppFunctions().LoadPetState(petManager.AppHandle(), BlackboardKeyFileHandle, 0, nullptr, &m_FileLength);
+    if(m_BaseHeader.Magic[0] != FileMagic[0] ||
+       m_BaseHeader.Magic[1] != FileMagic[1] ||
+       m_BaseHeader.Magic[2] != FileMagic[2] ||
+       m_BaseHeader.Magic[3] != FileMagic[3])
+    {
+        Unload();
+        return PetFail;
+    }
 
-    if(!IsStatusSuccess(status))
+    m_FlipEndian = false;
+
+    if(m_BaseHeader.Endian != GoodEndian)
     {
-        if(status == PetInvalidArg)
+        if(m_BaseHeader.Endian != WrongEndian)
         {
+            Unload();
             return PetFail;
         }
 
-        return status;
+        m_FlipEndian = true;
+        FlipEndian(m_BaseHeader);
     }
 
-    // If the size of the file is smaller than the data block size, just allocate enough for the file.
-    const size_t newDataBlockSize = ::std::min(m_FileLength, m_TargetBlockSize);
+    status = PetFail;
 
-    // If the new block size is smaller than our existing block, don't bother making it bigger.
-    if(newDataBlockSize > m_DataBlockSize)
+    if(m_BaseHeader.Version == FileVersion1_0 || m_BaseHeader.MinVersion == FileVersion1_0)
     {
-        delete[] m_DataBlock;
+        status = LoadV1_0(keyManager);
+    }
+
+    if(!IsStatusSuccess(status))
+    {
+        Unload();
+    }
 
-        m_DataBlock = new uint8_t[m_DataBlockSize];
-        m_DataBlockSize = newDataBlockSize;
+    return status;
+}
+
+PetStatus BlackboardKeyLoader::MapFile(PetManager& petManager) noexcept
+{
+    if(!petManager.AppFunctions().MapPetState || !petManager.AppFunctions().UnmapPetState)
+    {
+        return PetNotImplemented;
     }
 
-    size_t length = m_DataBlockSize;
+    const void* data = nullptr;
+    size_t length = 0;
 
-    status = petManager.AppFunctions().LoadPetState(petManager.AppHandle(), BlackboardKeyFileHandle, m_FileOffset, m_DataBlock, &length);
+    const PetStatus status = petManager.AppFunctions().MapPetState(petManager.AppHandle(), BlackboardKeyFileHandle, &data, &length);
 
     if(!IsStatusSuccess(status))
     {
-        if(status == PetInvalidArg)
+        return status;
+    }
+
+    if(!data || length == 0)
+    {
+        if(data)
         {
-            return PetFail;
+            (void) petManager.AppFunctions().UnmapPetState(petManager.AppHandle(), BlackboardKeyFileHandle, data, length);
         }
 
-        return status;
+        return PetSuccess;
     }
 
-    m_FileOffset += length;
+    m_FileData = static_cast<const uint8_t*>(data);
+    m_FileLength = length;
 
-    if(length < sizeof(BlackboardKeyFileBaseHeader))
+    return PetSuccess;
+}
+
+PetStatus BlackboardKeyLoader::ReadFile(PetManager& petManager) noexcept
+{
+    if(!petManager.AppFunctions().LoadPetState)
     {
-        return PetFail;
+        return PetSuccess;
     }
 
-    BlackboardKeyFileBaseHeader* const baseHeader = reinterpret_cast<BlackboardKeyFileBaseHeader*>(m_DataBlock);
+    size_t length = 0;
 
-    m_DataBlockOffset += sizeof(BlackboardKeyFileBaseHeader);
+    PetStatus status = petManager.AppFunctions().LoadPetState(petManager.AppHandle(), BlackboardKeyFileHandle, 0, nullptr, &length);
 
-    if(baseHeader->Magic[0] != FileMagic[0] ||
-       baseHeader->Magic[1] != FileMagic[1] ||
-       baseHeader->Magic[2] != FileMagic[2] ||
-       baseHeader->Magic[3] != FileMagic[3])
+    if(!IsStatusSuccess(status))
     {
-        return PetFail;
+        return status == PetInvalidArg ? PetFail : status;
     }
 
-    if(baseHeader->Endian != GoodEndian)
+    if(length == 0)
     {
-        if(baseHeader->Endian != WrongEndian)
-        {
-            return PetFail;
-        }
-
-        FlipEndian(*baseHeader);
+        return PetSuccess;
     }
 
-    m_BaseHeader = *baseHeader;
+    uint8_t* const data = new(::std::nothrow) uint8_t[length];
 
-    switch(baseHeader->Version)
+    if(!data)
     {
-        case FileVersion1_0: return LoadV1_0(keyManager, petManager);
-        default: break;
+        return PetOutOfMemory;
     }
 
-    switch(baseHeader->MinVersion)
+    size_t readLength = length;
+
+    status = petManager.AppFunctions().LoadPetState(petManager.AppHandle(), BlackboardKeyFileHandle, 0, data, &readLength);
+
+    if(!IsStatusSuccess(status))
     {
-        case FileVersion1_0: return LoadV1_0(keyManager, petManager);
-        default: break;
+        delete[] data;
+        return status == PetInvalidArg ? PetFail : status;
     }
 
-    return PetFail;
+    m_OwnedData = data;
+    m_FileData = data;
+    m_FileLength = readLength < length ? readLength : length;
+
+    return PetSuccess;
 }
 
-PetStatus BlackboardKeyLoader::LoadV1_0(BlackboardKeyManager& keyManager, PetManager& petManager) noexcept
+PetStatus BlackboardKeyLoader::LoadV1_0(BlackboardKeyManager& keyManager) noexcept
 {
-    size_t currentKeyOffset = m_BaseHeader.KeyIndicesOffset;
+    using KeyChar = BlackboardKeyName::KeyChar;
+
+    static_assert(sizeof(KeyChar) == 1, "The key names are stored as single byte characters.");
 
-    if(currentKeyOffset >= m_FileLength)
+    const size_t keyCount = m_BaseHeader.KeyCount;
+    const size_t indicesOffset = m_BaseHeader.KeyIndicesOffset;
+    const size_t stringBlobOffset = m_BaseHeader.StringBlobOffset;
+
+    if(indicesOffset > m_FileLength || keyCount > (m_FileLength - indicesOffset) / sizeof(BlackboardKeyIndice))
     {
         return PetFail;
     }
 
+    if(stringBlobOffset > m_FileLength)
+    {
+        return PetFail;
+    }
+
+    //   Keys are handled a batch at a time, so that the names can be
+    // hashed side by side. Every key is checked before any of them are
+    // stored, a bad file shouldn't leave half of its keys behind.
+    constexpr uint32_t BatchSize = Victoria::FNV1ABatchWidth * 4;
+
+    BlackboardKeyIndice indices[BatchSize];
+    const KeyChar* names[BatchSize];
+    uint32_t lengths[BatchSize];
+    uint32_t hashes[BatchSize];
+
+    for(const bool store : { false, true })
+    {
+        for(size_t base = 0; base < keyCount; base += BatchSize)
+        {
+            const uint32_t count = static_cast<uint32_t>(keyCount - base < BatchSize ? keyCount - base : BatchSize);
+
+            (void) ::std::memcpy(indices, m_FileData + indicesOffset + base * sizeof(BlackboardKeyIndice), count * sizeof(BlackboardKeyIndice));
+
+            for(uint32_t i = 0; i < count; ++i)
+            {
+                BlackboardKeyIndice& indice = indices[i];
+
+                if(m_FlipEndian)
+                {
+                    FileUtils::FlipEndian(indice.Key);
+                    FileUtils::FlipEndian(indice.Hash);
+                    FileUtils::FlipEndian(indice.NameOffset);
+                }
+
+                if(indice.Key < 0 || indice.NameOffset >= m_FileLength - stringBlobOffset)
+                {
+                    return PetFail;
+                }
+
+                const uint8_t* const name = m_FileData + stringBlobOffset + indice.NameOffset;
+                const void* const terminator = ::std::memchr(name, 0, m_FileLength - (stringBlobOffset + indice.NameOffset));
+
+                if(!terminator)
+                {
+                    return PetFail;
+                }
+
+                names[i] = reinterpret_cast<const KeyChar*>(name);
+                lengths[i] = static_cast<uint32_t>(static_cast<const uint8_t*>(terminator) - name);
+            }
+
+            if(!store)
+            {
+                continue;
+            }
+
+            Victoria::FNV1ABatch(names, lengths, count, hashes);
+
+            for(uint32_t i = 0; i < count; ++i)
+            {
+                if(indices[i].Hash != hashes[i])
+                {
+                    DebugPrintF(u8"[BlackboardKeyLoader::LoadV1_0]: Key %d has a stale hash, using the hash of its name.\n", indices[i].Key);
+                }
+
+                //   The file doesn't store the size of the keys, that is
+                // filled in when the code registers the key.
+                keyManager.StoreKey(BlackboardKey(indices[i].Key), BlackboardKeyName(hashes[i], lengths[i], names[i]), 0);
+            }
+        }
+    }
+
     return PetSuccess;
 }
 
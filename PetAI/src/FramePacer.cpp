@@ -0,0 +1,88 @@
+#include "FramePacer.hpp"
+
+FramePacer::FramePacer() noexcept
+    : m_PresentInterval(1000 / DefaultPresentRate)
+    , m_NextPresentTime(0)
+    , m_FrameStartTime(0)
+    , m_Stats { }
+{ }
+
+void FramePacer::SetTargetPresentRate(::std::uint32_t presentRate) noexcept
+{
+    if(presentRate == 0)
+    {
+        presentRate = DefaultPresentRate;
+    }
+
+    m_PresentInterval = 1000 / static_cast<TimeMs_t>(presentRate);
+
+    if(m_PresentInterval <= 0)
+    {
+        m_PresentInterval = 1;
+    }
+}
+
+void FramePacer::Start(const TimeMs_t now) noexcept
+{
+    m_NextPresentTime = now;
+    m_FrameStartTime = now;
+    m_Stats = { };
+}
+
+void FramePacer::BeginFrame(const TimeMs_t now) noexcept
+{
+    m_FrameStartTime = now;
+}
+
+void FramePacer::MarkPresented(const TimeMs_t now) noexcept
+{
+    m_NextPresentTime += m_PresentInterval;
+
+    // If we fell behind, don't try to catch up with a burst of presents.
+    if(m_NextPresentTime <= now)
+    {
+        m_NextPresentTime = now + m_PresentInterval;
+    }
+}
+
+TimeMs_t FramePacer::NextDeadline(const TimeMs_t now, const bool hasActivePets, const TimeMs_t wakeDelay) const noexcept
+{
+    TimeMs_t deadline = now + MaxSleepTime;
+
+    if(m_NextPresentTime < deadline)
+    {
+        deadline = m_NextPresentTime;
+    }
+
+    //   This is measured from the start of the frame, so busy frames sleep
+    // less instead of stretching the tick interval.
+    if(hasActivePets && m_FrameStartTime + ActiveTickInterval < deadline)
+    {
+        deadline = m_FrameStartTime + ActiveTickInterval;
+    }
+
+    if(wakeDelay < MaxSleepTime && now + wakeDelay < deadline)
+    {
+        deadline = now + wakeDelay;
+    }
+
+    return deadline;
+}
+
+void FramePacer::EndFrame(const TimeMs_t busyEndTime, const TimeMs_t endTime, const bool wokeEarly) noexcept
+{
+    // The clock is not monotonic, don't let a jump backwards show up as negative time.
+    const TimeMs_t busyTime = busyEndTime > m_FrameStartTime ? busyEndTime - m_FrameStartTime : 0;
+    const TimeMs_t idleTime = endTime > busyEndTime ? endTime - busyEndTime : 0;
+
+    ++m_Stats.FrameCount;
+    m_Stats.LastBusyTime = busyTime;
+    m_Stats.LastIdleTime = idleTime;
+    m_Stats.TotalBusyTime += busyTime;
+    m_Stats.TotalIdleTime += idleTime;
+
+    if(wokeEarly)
+    {
+        ++m_Stats.EarlyWakeupCount;
+    }
+}
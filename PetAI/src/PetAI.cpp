@@ -2,6 +2,7 @@
 #include "PetManager.hpp"
 #include "PetBehaviors.hpp"
 #include "BehaviorTree.hpp"
+#include "PetSnapshot.hpp"
 #include <SysLib.h>
 #include <new>
 
@@ -9,11 +10,20 @@
 
 PetManager g_PetManager;
 
+/**
+ * How often the pets are written out while running.
+ */
+static constexpr TimeMs_t SnapshotInterval = 5000;
+
 static PetStatus NotifyExit(const PetAIHandle petAIHandle);
 static PetStatus GetPetState(const PetAIHandle petAIHandle, const PetHandle petHandle, void** const pState, uint32_t* const pSize);
 static PetStatus CreatePet(const PetAIHandle petAIHandle, const CreatePetAIData* const pCreatePetData, PetHandle* const pPetHandle);
 static PetStatus CreateDefaultRenderer(PetAIHandle petAIHandle, const CreateDefaultPetRenderer* pCreateDefaultRenderer);
 static PetStatus DestroyDefaultRenderer(PetAIHandle petAIHandle, PetRendererHandle rendererHandle);
+static PetStatus GetFrameStats(PetAIHandle petAIHandle, PetFrameStats* pFrameStats);
+static PetStatus DestroyPet(PetAIHandle petAIHandle, PetHandle petHandle);
+
+static TimeMs_t TimeUntilNextWake() noexcept;
 
 extern "C" PetStatus TAU_UTILS_LIB InitPetAI(const PetFunctions* const pFunctions)
 {
@@ -51,6 +61,22 @@ extern "C" PetStatus TAU_UTILS_LIB InitPetAI(const PetFunctions* const pFunction
     g_PetManager.AppFunctions().DestroyRenderer = pFunctions->DestroyRenderer;
     g_PetManager.AppFunctions().Present = pFunctions->Present;
 
+    if(pFunctions->Version >= PET_AI_VERSION_1_1)
+    {
+        g_PetManager.AppFunctions().TickThreadCount = pFunctions->TickThreadCount;
+    }
+
+    if(pFunctions->Version >= PET_AI_VERSION_1_2)
+    {
+        g_PetManager.AppFunctions().TargetPresentRate = pFunctions->TargetPresentRate;
+    }
+
+    if(pFunctions->Version >= PET_AI_VERSION_1_4 && pFunctions->MapPetState && pFunctions->UnmapPetState)
+    {
+        g_PetManager.AppFunctions().MapPetState = pFunctions->MapPetState;
+        g_PetManager.AppFunctions().UnmapPetState = pFunctions->UnmapPetState;
+    }
+
     g_PetManager.AppHandle().Ptr = nullptr;
     g_PetManager.PetCallbackHandle() = &g_PetManager;
 
@@ -62,8 +88,8 @@ extern "C" void TAU_UTILS_LIB CleanupPetAI()
     DestroySys();
 }
 
-// ReSharper disable once CppFunctionIsNotImplemented
-static PetStatus LoadState(const uint8_t** const ppBuffer) noexcept;
+static PetStatus LoadState(uint8_t** const ppBuffer, size_t* const pSize) noexcept;
+static PetStatus SaveState() noexcept;
 
 extern "C" PetStatus TAU_UTILS_LIB RunPetAI()
 {
@@ -79,6 +105,8 @@ extern "C" PetStatus TAU_UTILS_LIB RunPetAI()
     callbacks.CreatePet = CreatePet;
     callbacks.CreateDefaultRenderer = CreateDefaultRenderer;
     callbacks.DestroyDefaultRenderer = DestroyDefaultRenderer;
+    callbacks.GetFrameStats = GetFrameStats;
+    callbacks.DestroyPet = DestroyPet;
 
     PetStatus status = g_PetManager.AppFunctions().CreatePetApp(&g_PetManager.AppHandle(), &callbacks);
 
@@ -95,33 +123,87 @@ extern "C" PetStatus TAU_UTILS_LIB RunPetAI()
         DebugPrintF(u8"[RunPetAI]: g_PetManager.CreateRenderer returned status 0x%08X.\n", status);
     }
 
-    const uint8_t* stateBuffer;
-    status = LoadState(&stateBuffer);
+    status = g_PetManager.LoadBlackboardKeys();
 
     if(!IsStatusSuccess(status))
     {
-        stateBuffer = nullptr;
+        DebugPrintF(u8"[RunPetAI]: g_PetManager.LoadBlackboardKeys returned status 0x%08X, using the built in keys.\n", status);
+    }
+
+    InitBlackboardKeys(g_PetManager.BlackboardKeyManager());
+
+    status = g_PetManager.CompileBehaviorTree(&g_RootNode);
+
+    if(!IsStatusSuccess(status))
+    {
+        DebugPrintF(u8"[RunPetAI]: g_PetManager.CompileBehaviorTree returned status 0x%08X, using the uncompiled tree.\n", status);
+    }
+
+    uint8_t* stateBuffer = nullptr;
+    size_t stateSize = 0;
+    status = LoadState(&stateBuffer, &stateSize);
+
+    if(IsStatusSuccess(status) && stateBuffer)
+    {
+        status = g_PetManager.RestoreSnapshot(stateBuffer, stateSize);
+
+        if(!IsStatusSuccess(status))
+        {
+            DebugPrintF(u8"[RunPetAI]: g_PetManager.RestoreSnapshot returned status 0x%08X, starting over.\n", status);
+        }
     }
 
     delete[] stateBuffer;
 
-    InitBlackboardKeys(g_PetManager.BlackboardKeyManager());
+    if(g_PetManager.Pets().empty())
+    {
+        CreatePetData initialPetData {};
+        initialPetData.ParentMale.Ptr = nullptr;
+        initialPetData.ParentFemale.Ptr = nullptr;
 
-    CreatePetData initialPetData {};
-    initialPetData.ParentMale.Ptr = nullptr;
-    initialPetData.ParentFemale.Ptr = nullptr;
+        status = g_PetManager.AppFunctions().CreatePet(g_PetManager.AppHandle(), &initialPetData);
 
-    status = g_PetManager.AppFunctions().CreatePet(g_PetManager.AppHandle(), &initialPetData);
+        if(!IsStatusSuccess(status))
+        {
+            DebugPrintF(u8"[RunPetAI]: pFunctions->CreatePet returned status 0x%08X.\n", status);
+            return status;
+        }
+    }
+
+    status = g_PetManager.StartTickWorkers();
 
     if(!IsStatusSuccess(status))
     {
-        DebugPrintF(u8"[RunPetAI]: pFunctions->CreatePet returned status 0x%08X.\n", status);
-        return status;
+        DebugPrintF(u8"[RunPetAI]: g_PetManager.StartTickWorkers returned status 0x%08X, ticking on a single thread.\n", status);
+    }
+
+    if(g_PetManager.AppFunctions().Version >= PET_AI_VERSION_1_5)
+    {
+        status = g_PetManager.StartCheckpointWriter();
+
+        if(IsStatusError(status) && status != PetNotImplemented)
+        {
+            DebugPrintF(u8"[RunPetAI]: g_PetManager.StartCheckpointWriter returned status 0x%08X, saving on the tick thread.\n", status);
+        }
     }
 
-    int32_t iter = 0;
+    if(g_PetManager.AppFunctions().Version >= PET_AI_VERSION_1_6)
+    {
+        status = g_PetManager.StartRenderThread();
+
+        if(IsStatusError(status) && status != PetNotImplemented)
+        {
+            DebugPrintF(u8"[RunPetAI]: g_PetManager.StartRenderThread returned status 0x%08X, presenting on the tick thread.\n", status);
+        }
+    }
+
+    FramePacer& framePacer = g_PetManager.FramePacer();
+    framePacer.SetTargetPresentRate(g_PetManager.AppFunctions().TargetPresentRate);
 
     TimeMs_t lastTime = GetCurrentTimeMs();
+    TimeMs_t lastSnapshotTime = lastTime;
+
+    framePacer.Start(lastTime);
 
     while(!g_PetManager.ShouldExit())
     {
@@ -129,6 +211,8 @@ extern "C" PetStatus TAU_UTILS_LIB RunPetAI()
 
         const float deltaTime = static_cast<float>(currentTime - lastTime) / 1000.0f;
 
+        framePacer.BeginFrame(currentTime);
+
         if(g_PetManager.AppFunctions().Update)
         {
             g_PetManager.AppFunctions().Update(g_PetManager.AppHandle(), deltaTime);
@@ -139,27 +223,52 @@ extern "C" PetStatus TAU_UTILS_LIB RunPetAI()
             break;
         }
 
-        for(PetEntity* pet : g_PetManager.Pets())
+        g_PetManager.TickPets(deltaTime);
+
+        g_PetManager.PollCheckpoints();
+
+        // A checkpoint that couldn't be queued yet is retried next frame.
+        if(currentTime - lastSnapshotTime >= SnapshotInterval && SaveState() != PetNoMoreItems)
         {
-            pet->BehaviorTreeExecutor().Tick(deltaTime);
+            lastSnapshotTime = currentTime;
         }
 
-        ++iter;
-
-        if(iter % 200 == 0)
+        if(framePacer.ShouldPresent(GetCurrentTimeMs()))
         {
-            g_PetManager.AppFunctions().Present(g_PetManager.AppHandle(), g_PetManager.RendererHandle(), &g_PetManager.RendererFunctions());
+            // With the render thread running this only publishes the scene.
+            g_PetManager.PresentFrame();
+            framePacer.MarkPresented(GetCurrentTimeMs());
         }
 
-        if(g_PetManager.AppFunctions().Sleep)
+        const TimeMs_t busyEndTime = GetCurrentTimeMs();
+        const TimeMs_t deadline = framePacer.NextDeadline(busyEndTime, !g_PetManager.ActivePets().empty(), TimeUntilNextWake());
+
+        bool wokeEarly = false;
+
+        if(deadline > busyEndTime && g_PetManager.AppFunctions().Sleep)
         {
-            TimeMs_t sleepTime = 5;
-            g_PetManager.AppFunctions().Sleep(g_PetManager.AppHandle(), &sleepTime);
+            TimeMs_t sleepTime = deadline - busyEndTime;
+            status = g_PetManager.AppFunctions().Sleep(g_PetManager.AppHandle(), &sleepTime);
+            wokeEarly = status == PetEarlyWakeup;
+
+            if(IsStatusError(status))
+            {
+                DebugPrintF(u8"[RunPetAI]: pFunctions->Sleep returned status 0x%08X.\n", status);
+            }
         }
 
+        framePacer.EndFrame(busyEndTime, GetCurrentTimeMs(), wokeEarly);
+
         lastTime = currentTime;
     }
 
+    g_PetManager.StopTickWorkers();
+    g_PetManager.StopRenderThread();
+    // With the writer stopped the last checkpoint is written right away.
+    g_PetManager.StopCheckpointWriter();
+    (void) SaveState();
+    g_PetManager.UnloadBlackboardKeys();
+
     status = g_PetManager.AppFunctions().DestroyPetApp(g_PetManager.AppHandle());
 
     if(!IsStatusSuccess(status))
@@ -171,9 +280,28 @@ extern "C" PetStatus TAU_UTILS_LIB RunPetAI()
     return PetSuccess;
 }
 
-static PetStatus LoadState(const uint8_t** const ppBuffer) noexcept
+static TimeMs_t TimeUntilNextWake() noexcept
+{
+    const ::std::uint64_t nextWakeTime = g_PetManager.NextWakeTime();
+
+    if(nextWakeTime == UINT64_MAX)
+    {
+        return FramePacer::NoWakeup;
+    }
+
+    if(nextWakeTime <= g_PetManager.TickTime())
+    {
+        return 0;
+    }
+
+    // The tick time is in microseconds, round up so we don't wake up just before the pet does.
+    return static_cast<TimeMs_t>((nextWakeTime - g_PetManager.TickTime() + 999) / 1000);
+}
+
+static PetStatus LoadState(uint8_t** const ppBuffer, size_t* const pSize) noexcept
 {
-    constexpr PetFileHandle dummyFileHandle = 1337;
+    *ppBuffer = nullptr;
+    *pSize = 0;
 
     if(!g_PetManager.AppFunctions().LoadPetState)
     {
@@ -181,7 +309,7 @@ static PetStatus LoadState(const uint8_t** const ppBuffer) noexcept
     }
 
     size_t stateSize;
-    PetStatus status = g_PetManager.AppFunctions().LoadPetState(g_PetManager.AppHandle(), dummyFileHandle, 0, nullptr, &stateSize);
+    PetStatus status = g_PetManager.AppFunctions().LoadPetState(g_PetManager.AppHandle(), PetSnapshotFileHandle, 0, nullptr, &stateSize);
 
     if(!IsStatusSuccess(status))
     {
@@ -196,8 +324,13 @@ static PetStatus LoadState(const uint8_t** const ppBuffer) noexcept
 
     uint8_t* buffer = new(::std::nothrow) uint8_t[stateSize];
 
-    size_t stateSizeRead;
-    status = g_PetManager.AppFunctions().LoadPetState(g_PetManager.AppHandle(), dummyFileHandle, 0, buffer, &stateSizeRead);
+    if(!buffer)
+    {
+        return PetOutOfMemory;
+    }
+
+    size_t stateSizeRead = stateSize;
+    status = g_PetManager.AppFunctions().LoadPetState(g_PetManager.AppHandle(), PetSnapshotFileHandle, 0, buffer, &stateSizeRead);
 
     if(!IsStatusSuccess(status))
     {
@@ -213,10 +346,23 @@ static PetStatus LoadState(const uint8_t** const ppBuffer) noexcept
     }
 
     *ppBuffer = buffer;
+    *pSize = stateSize;
 
     return PetSuccess;
 }
 
+static PetStatus SaveState() noexcept
+{
+    const PetStatus status = g_PetManager.QueueCheckpoint();
+
+    if(IsStatusError(status) && status != PetNotImplemented)
+    {
+        DebugPrintF(u8"[SaveState]: g_PetManager.QueueCheckpoint returned status 0x%08X.\n", status);
+    }
+
+    return status;
+}
+
 static PetStatus NotifyExit(const PetAIHandle petAIHandle)
 {
     if(!petAIHandle.Ptr)
@@ -266,3 +412,23 @@ static PetStatus DestroyDefaultRenderer(const PetAIHandle petAIHandle, const Pet
 
     return PetManager::FromHandle(petAIHandle)->DestroyDefaultRenderer(rendererHandle);
 }
+
+static PetStatus GetFrameStats(const PetAIHandle petAIHandle, PetFrameStats* const pFrameStats)
+{
+    if(!petAIHandle.Ptr)
+    {
+        return PetInvalidArg;
+    }
+
+    return PetManager::FromHandle(petAIHandle)->GetFrameStats(pFrameStats);
+}
+
+static PetStatus DestroyPet(const PetAIHandle petAIHandle, const PetHandle petHandle)
+{
+    if(!petAIHandle.Ptr)
+    {
+        return PetInvalidArg;
+    }
+
+    return PetManager::FromHandle(petAIHandle)->DestroyPet(petHandle);
+}
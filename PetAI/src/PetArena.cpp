@@ -0,0 +1,131 @@
+#include "PetArena.hpp"
+#include <SysLib.h>
+
+PetArena::PetArena() noexcept
+    : m_FreeLists { }
+    , m_Slabs(nullptr)
+    , m_SlabCount(0)
+{ }
+
+PetArena::~PetArena() noexcept
+{
+    Reset();
+}
+
+::std::uint32_t PetArena::SizeClass(const ::std::size_t size) noexcept
+{
+    ::std::uint32_t sizeClass = 0;
+    ::std::size_t blockSize = MinBlockSize;
+
+    while(blockSize < size && sizeClass < SizeClassCount)
+    {
+        blockSize <<= 1;
+        ++sizeClass;
+    }
+
+    return sizeClass;
+}
+
+::std::size_t PetArena::BlockSize(const ::std::size_t size) noexcept
+{
+    const ::std::uint32_t sizeClass = SizeClass(size);
+
+    if(sizeClass >= SizeClassCount)
+    {
+        return size;
+    }
+
+    return MinBlockSize << sizeClass;
+}
+
+void* PetArena::Allocate(const ::std::size_t size) noexcept
+{
+    const ::std::uint32_t sizeClass = SizeClass(size);
+
+    if(sizeClass >= SizeClassCount)
+    {
+        return Alloc(size);
+    }
+
+    if(!m_FreeLists[sizeClass] && !AllocateSlab(sizeClass))
+    {
+        return nullptr;
+    }
+
+    FreeBlock* const block = m_FreeLists[sizeClass];
+    m_FreeLists[sizeClass] = block->Next;
+
+    return block;
+}
+
+void PetArena::Deallocate(void* const block, const ::std::size_t size) noexcept
+{
+    if(!block)
+    {
+        return;
+    }
+
+    const ::std::uint32_t sizeClass = SizeClass(size);
+
+    if(sizeClass >= SizeClassCount)
+    {
+        Free(block);
+        return;
+    }
+
+    FreeBlock* const freeBlock = static_cast<FreeBlock*>(block);
+    freeBlock->Next = m_FreeLists[sizeClass];
+    m_FreeLists[sizeClass] = freeBlock;
+}
+
+void PetArena::Reset() noexcept
+{
+    Slab* slab = m_Slabs;
+
+    while(slab)
+    {
+        Slab* const next = slab->Next;
+        Free(slab);
+        slab = next;
+    }
+
+    m_Slabs = nullptr;
+    m_SlabCount = 0;
+
+    for(FreeBlock*& freeList : m_FreeLists)
+    {
+        freeList = nullptr;
+    }
+}
+
+bool PetArena::AllocateSlab(const ::std::uint32_t sizeClass) noexcept
+{
+    const ::std::size_t blockSize = MinBlockSize << sizeClass;
+
+    //   Alloc only guarantees the alignment of malloc, so over-allocate to
+    // be able to align the first block.
+    void* const memory = Alloc(sizeof(Slab) + blockSize * SlabBlockCount + BlockAlignment);
+
+    if(!memory)
+    {
+        return false;
+    }
+
+    Slab* const slab = static_cast<Slab*>(memory);
+    slab->Next = m_Slabs;
+    m_Slabs = slab;
+    ++m_SlabCount;
+
+    const ::std::uintptr_t firstBlock = (reinterpret_cast<::std::uintptr_t>(memory) + sizeof(Slab) + BlockAlignment - 1) & ~static_cast<::std::uintptr_t>(BlockAlignment - 1);
+    unsigned char* const blocks = reinterpret_cast<unsigned char*>(firstBlock);
+
+    // Push the blocks in reverse, so that they are handed out in address order.
+    for(::std::size_t i = SlabBlockCount; i > 0; --i)
+    {
+        FreeBlock* const block = reinterpret_cast<FreeBlock*>(blocks + (i - 1) * blockSize);
+        block->Next = m_FreeLists[sizeClass];
+        m_FreeLists[sizeClass] = block;
+    }
+
+    return true;
+}
@@ -1,14 +1,16 @@
 // ReSharper disable CppParameterMayBeConstPtrOrRef
+#include "PetBehaviors.hpp"
 #include "BehaviorTree.hpp"
 #include "PetManager.hpp"
 #include "Blackboard.hpp"
 #include "SysLib.h"
 #include <array>
 
-static bool Bark(PetManager& petManager, const BehaviorTreeActionNode& node, Blackboard& blackboard, float deltaTime) noexcept;
-static bool Eat(PetManager& petManager, const BehaviorTreeActionNode& node, Blackboard& blackboard, float deltaTime) noexcept;
+static BehaviorTreeActionResult Bark(PetManager& petManager, const BehaviorTreeActionNode& node, Blackboard& blackboard, float deltaTime) noexcept;
+static BehaviorTreeActionResult Eat(PetManager& petManager, const BehaviorTreeActionNode& node, Blackboard& blackboard, float deltaTime) noexcept;
 static ::std::int32_t SelectRandomAction(PetManager& petManager, const BehaviorTreeSelectorNode& node, Blackboard& blackboard) noexcept;
-static bool Sleep3s(PetManager& petManager, const BehaviorTreeActionNode& node, Blackboard& blackboard, float deltaTime) noexcept;
+static BehaviorTreeActionResult Sleep3s(PetManager& petManager, const BehaviorTreeActionNode& node, Blackboard& blackboard, float deltaTime) noexcept;
+static void Sleep3sBatch(PetManager& petManager, const BehaviorTreeActionNode& node, const BehaviorTreeActionBatch& batch) noexcept;
 
 static ::std::int32_t SelectLifeStageTree(PetManager& petManager, const BehaviorTreeSelectorNode& node, Blackboard& blackboard) noexcept;
 static bool ContinueTree(PetManager& petManager, const BehaviorTreeRepeatNode& node, Blackboard& blackboard) noexcept;
@@ -25,49 +27,37 @@ static const BlackboardKeyName::KeyChar* s_ActionSelectorKeyName = CSTR("ActionS
 static BlackboardKey s_LifeStageSelectorKey;
 static const BlackboardKeyName::KeyChar* s_LifeStageSelectorKeyName = CSTR("LifeStage.SelectorKey");
 
-static BlackboardKey s_LifeStageKey;
-static const BlackboardKeyName::KeyChar* s_LifeStageKeyName = CSTR("LifeStage");
+using LifeStageKey = PetBlackboardSchema::Key<"LifeStage">;
 
-static BehaviorTreeActionNode s_BarkAction(Bark);
-static BehaviorTreeActionNode s_EatAction(Eat);
-static BehaviorTreeActionNode s_SleepAction(Sleep3s);
+static BehaviorTreeActionNode s_BarkAction(BehaviorTreeActionNode::ActionHandler::Bind<Bark>());
+static BehaviorTreeActionNode s_EatAction(BehaviorTreeActionNode::ActionHandler::Bind<Eat>());
+static BehaviorTreeActionNode s_SleepAction(BehaviorTreeActionNode::ActionHandler::Bind<Sleep3s>(), BehaviorTreeActionNode::BatchActionHandler::Bind<Sleep3sBatch>());
 
 static ::std::array<BehaviorTreeNode*, 2> s_RandomActionSelectionArray({ &s_BarkAction, &s_EatAction });
-static BehaviorTreeSelectorNode s_RandomActionSelector(s_RandomActionSelectionArray.size(), s_RandomActionSelectionArray.data(), SelectRandomAction, s_ActionSelectorKey);
+static BehaviorTreeSelectorNode s_RandomActionSelector(s_RandomActionSelectionArray.size(), s_RandomActionSelectionArray.data(), BehaviorTreeSelectorNode::SelectorFunc::Bind<SelectRandomAction>(), s_ActionSelectorKey);
 
 static ::std::array<BehaviorTreeNode*, 2> s_BarkSequenceArray({ &s_RandomActionSelector, &s_SleepAction });
 static BehaviorTreeSequenceNode s_BarkSequence(s_BarkSequenceArray.size(), s_BarkSequenceArray.data(), s_BarkSequenceKey);
 
 static ::std::array<BehaviorTreeNode*, 5> s_LifeStageTrees({ &s_BarkSequence, &s_BarkSequence, &s_BarkSequence, &s_BarkSequence, &s_BarkSequence });
-static BehaviorTreeSelectorNode s_LifeStageSelector(s_LifeStageTrees.size(), s_LifeStageTrees.data(), SelectLifeStageTree, s_LifeStageSelectorKey);
+static BehaviorTreeSelectorNode s_LifeStageSelector(s_LifeStageTrees.size(), s_LifeStageTrees.data(), BehaviorTreeSelectorNode::SelectorFunc::Bind<SelectLifeStageTree>(), s_LifeStageSelectorKey);
 
-BehaviorTreeRepeatNode g_RootNode(&s_LifeStageSelector, ContinueTree);
-
-enum class LifeStage : uint8_t
-{
-    Infant = 0,
-    Childhood,
-    Adolescent,
-    Adult,
-    Elder,
-    MaxValue = Elder
-};
+BehaviorTreeRepeatNode g_RootNode(&s_LifeStageSelector, BehaviorTreeRepeatNode::ContinuationFunc::Bind<ContinueTree>());
 
 void InitBlackboardKeys(BlackboardKeyManager& keyManager) noexcept
 {
-    s_SleepTimeKey = keyManager.CalculateKey(s_SleepTimeKeyName, sizeof(int32_t));
-    s_BarkSequenceKey = keyManager.CalculateKey(s_BarkSequenceKeyName, sizeof(BehaviorTreeSequenceNode::SequenceKeyT));
+    // These are touched by nearly every pet on every tick, so they are kept in columns.
+    s_SleepTimeKey = keyManager.CalculateKey(s_SleepTimeKeyName, sizeof(int32_t), BlackboardKeyStorage::Column);
+    s_BarkSequenceKey = keyManager.CalculateKey(s_BarkSequenceKeyName, sizeof(BehaviorTreeSequenceNode::SequenceKeyT), BlackboardKeyStorage::Column);
     s_BarkSequence.SequenceKey() = s_BarkSequenceKey;
     s_ActionSelectorKey = keyManager.CalculateKey(s_ActionSelectorKeyName, sizeof(BehaviorTreeSelectorNode::SelectorKeyT));
     s_RandomActionSelector.SelectorKey() = s_ActionSelectorKey;
 
     s_LifeStageSelectorKey = keyManager.CalculateKey(s_LifeStageSelectorKeyName, sizeof(BehaviorTreeSelectorNode::SelectorKeyT));
     s_LifeStageSelector.SelectorKey() = s_LifeStageSelectorKey;
-
-    s_LifeStageKey = keyManager.CalculateKey(s_LifeStageKeyName, sizeof(LifeStage));
 }
 
-static bool Bark(PetManager& petManager, const BehaviorTreeActionNode& node, Blackboard& blackboard, const float deltaTime) noexcept
+static BehaviorTreeActionResult Bark(PetManager& petManager, const BehaviorTreeActionNode& node, Blackboard& blackboard, const float deltaTime) noexcept
 {
     (void) petManager;
     (void) node;
@@ -76,10 +66,10 @@ static bool Bark(PetManager& petManager, const BehaviorTreeActionNode& node, Bla
 
     DebugPrintF(u8"Bork bork!\n");
 
-    return true;
+    return BehaviorTreeActionResult::Finish();
 }
 
-static bool Eat(PetManager& petManager, const BehaviorTreeActionNode& node, Blackboard& blackboard, const float deltaTime) noexcept
+static BehaviorTreeActionResult Eat(PetManager& petManager, const BehaviorTreeActionNode& node, Blackboard& blackboard, const float deltaTime) noexcept
 {
     (void) petManager;
     (void) node;
@@ -88,7 +78,7 @@ static bool Eat(PetManager& petManager, const BehaviorTreeActionNode& node, Blac
 
     DebugPrintF(u8"Nom nom!\n");
 
-    return true;
+    return BehaviorTreeActionResult::Finish();
 }
 
 static ::std::int32_t SelectRandomAction(PetManager& petManager, const BehaviorTreeSelectorNode& node, Blackboard& blackboard) noexcept
@@ -107,7 +97,7 @@ static ::std::int32_t SelectRandomAction(PetManager& petManager, const BehaviorT
     return 1;
 }
 
-static bool Sleep3s(PetManager& petManager, const BehaviorTreeActionNode& node, Blackboard& blackboard, const float deltaTime) noexcept
+static BehaviorTreeActionResult Sleep3s(PetManager& petManager, const BehaviorTreeActionNode& node, Blackboard& blackboard, const float deltaTime) noexcept
 {
     (void) petManager;
     (void) node;
@@ -116,7 +106,7 @@ static bool Sleep3s(PetManager& petManager, const BehaviorTreeActionNode& node,
 
     if(!pTimeRemaining)
     {
-        return true;
+        return BehaviorTreeActionResult::Finish();
     }
 
     if(*pTimeRemaining == 0)
@@ -129,10 +119,49 @@ static bool Sleep3s(PetManager& petManager, const BehaviorTreeActionNode& node,
     if(*pTimeRemaining <= 0)
     {
         *pTimeRemaining = 0;
-        return true;
+        return BehaviorTreeActionResult::Finish();
+    }
+
+    //   Nothing happens until the timer runs out, the remaining time is
+    // still counted down here so the timer survives a save and works
+    // without a scheduler.
+    return BehaviorTreeActionResult::SuspendFor(static_cast<::std::uint32_t>(*pTimeRemaining));
+}
+
+static void Sleep3sBatch(PetManager& petManager, const BehaviorTreeActionNode& node, const BehaviorTreeActionBatch& batch) noexcept
+{
+    ::std::int32_t* const timeColumn = petManager.BlackboardColumns().Column<::std::int32_t>(s_SleepTimeKey);
+
+    if(!timeColumn)
+    {
+        for(::std::uint32_t i = 0; i < batch.Count; ++i)
+        {
+            batch.Results[i] = Sleep3s(petManager, node, *batch.Blackboards[i], batch.DeltaTimes[i]);
+        }
+
+        return;
+    }
+
+    //   The same as Sleep3s, but written without branches so that the
+    // timer update can be vectorized across the batch.
+    for(::std::uint32_t i = 0; i < batch.Count; ++i)
+    {
+        ::std::int32_t timeRemaining = timeColumn[batch.ColumnSlots[i]];
+        timeRemaining = timeRemaining == 0 ? 3000 : timeRemaining;
+        timeRemaining -= static_cast<::std::int32_t>(batch.DeltaTimes[i] * 1000.0f);
+        timeRemaining = timeRemaining > 0 ? timeRemaining : 0;
+        timeColumn[batch.ColumnSlots[i]] = timeRemaining;
     }
 
-    return false;
+    //   The column is written directly, so the write barrier is on us,
+    // otherwise the next checkpoint skips these pets.
+    for(::std::uint32_t i = 0; i < batch.Count; ++i)
+    {
+        batch.Blackboards[i]->MarkDirty(s_SleepTimeKey);
+
+        const ::std::int32_t timeRemaining = timeColumn[batch.ColumnSlots[i]];
+        batch.Results[i] = timeRemaining == 0 ? BehaviorTreeActionResult::Finish() : BehaviorTreeActionResult::SuspendFor(static_cast<::std::uint32_t>(timeRemaining));
+    }
 }
 
 static ::std::int32_t SelectLifeStageTree(PetManager& petManager, const BehaviorTreeSelectorNode& node, Blackboard& blackboard) noexcept
@@ -146,24 +175,23 @@ static ::std::int32_t SelectLifeStageTree(PetManager& petManager, const Behavior
         return 0;
     }
 
-    LifeStage* const pLifeStage = blackboard.GetT<LifeStage>(s_LifeStageKey);
+    // This runs on every pass through the tree, so only read the stage unless it has to be reset.
+    const LifeStage lifeStage = *static_cast<const Blackboard&>(blackboard).Get<LifeStageKey>();
 
     // If this is a valid stage simply convert to an int and return that as the index,
     // otherwise reset to LifeStage::Infant.
-    switch(*pLifeStage)
+    switch(lifeStage)
     {
         case LifeStage::Infant:
         case LifeStage::Childhood:
         case LifeStage::Adolescent:
         case LifeStage::Adult:
         case LifeStage::Elder:
-            break;
+            return static_cast<::std::int32_t>(lifeStage);
         default:  // NOLINT(clang-diagnostic-covered-switch-default)
-            *pLifeStage = LifeStage::Infant;
-            break;
+            *blackboard.Get<LifeStageKey>() = LifeStage::Infant;
+            return static_cast<::std::int32_t>(LifeStage::Infant);
     }
-
-    return static_cast<::std::int32_t>(*pLifeStage);
 }
 
 static bool ContinueTree(PetManager& petManager, const BehaviorTreeRepeatNode& node, Blackboard& blackboard) noexcept
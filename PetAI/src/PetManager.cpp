@@ -1,6 +1,10 @@
 #include "PetManager.hpp"
 #include "PetEntity.hpp"
 #include "PetBehaviors.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstring>
 #include <new>
 
 #include "PetRenderer.hpp"
@@ -9,14 +13,53 @@ PetManager::PetManager() noexcept
     : m_AppFunctions()
     , m_AppHandle { nullptr }
     , m_PetCallbackHandle(nullptr)
+    , m_BlackboardKeyLoader()
     , m_BlackboardKeyManager()
+    , m_BlackboardColumns()
+    , m_BlackboardLayout()
+    , m_PetArena()
+    , m_PetBlockSize(0)
+    , m_BlackboardStorageOffset(0)
+    , m_BehaviorTree()
     , m_RendererHandle { nullptr }
     , m_RendererFunctions()
+    , m_ScreenWidth(0)
+    , m_ScreenHeight(0)
+    , m_RenderThread()
     , m_ShouldExit(false)
     , m_HasRenderer(false)
     , m_Pets()
+    , m_ActivePets()
+    , m_SleepingPets()
+    , m_TickTime(0)
+    , m_PendingActionPets()
+    , m_PendingActionOffsets()
+    , m_TickWorkers()
+    , m_IsTicking(false)
+    , m_SnapshotBuffer(nullptr)
+    , m_SnapshotCapacity(0)
+    , m_SnapshotSize(0)
+    , m_SnapshotRecordSize(0)
+    , m_SnapshotIndices()
+    , m_SnapshotRecords()
+    , m_CheckpointWritten(false)
+    , m_CheckpointBatch()
+    , m_CheckpointWriter()
+    , m_FramePacer()
 { }
 
+PetManager::~PetManager() noexcept
+{
+    for(PetEntity* const pet : m_Pets)
+    {
+        pet->~PetEntity();
+    }
+
+    m_Pets.clear();
+
+    delete[] m_SnapshotBuffer;
+}
+
 PetStatus PetManager::NotifyExit() noexcept
 {
     m_ShouldExit = true;
@@ -48,6 +91,18 @@ PetStatus PetManager::GetPetState(const PetHandle petHandle, void** const pState
     return PetSuccess;
 }
 
+PetStatus PetManager::GetFrameStats(PetFrameStats* const pFrameStats) const noexcept
+{
+    if(!pFrameStats)
+    {
+        return PetInvalidArg;
+    }
+
+    *pFrameStats = m_FramePacer.Stats();
+
+    return PetSuccess;
+}
+
 PetStatus PetManager::CreatePet(const CreatePetAIData* const pCreatePetData, PetHandle* const pPetHandle) noexcept
 {
     if(!pCreatePetData)
@@ -55,18 +110,25 @@ PetStatus PetManager::CreatePet(const CreatePetAIData* const pCreatePetData, Pet
         return PetInvalidArg;
     }
 
-    PetEntity* pet = new(::std::nothrow) PetEntity(
-        pCreatePetData->State, 
-        pCreatePetData->StateSize, 
-        m_BlackboardKeyManager,
-        &g_RootNode,
-        this
-    );
+    if(m_IsTicking)
+    {
+        DebugPrintF(u8"[PetManager::CreatePet]: Pets cannot be created while the pets are being ticked.\n");
+        return PetFail;
+    }
+
+    PetEntity* pet;
+    const PetStatus status = ConstructPet(pCreatePetData->State, pCreatePetData->StateSize, &pet);
+
+    if(IsStatusError(status))
+    {
+        return status;
+    }
+
     pet->ParentMale() = PetEntity::FromHandle(pCreatePetData->ParentMale);
     pet->ParentFemale() = PetEntity::FromHandle(pCreatePetData->ParentFemale);
     pet->Gender() = pCreatePetData->Gender;
 
-    m_Pets.push_back(pet);
+    m_ActivePets.push_back(pet);
 
     if(pPetHandle)
     {
@@ -76,6 +138,758 @@ PetStatus PetManager::CreatePet(const CreatePetAIData* const pCreatePetData, Pet
     return PetSuccess;
 }
 
+PetStatus PetManager::DestroyPet(const PetHandle petHandle) noexcept
+{
+    if(!petHandle.Ptr)
+    {
+        return PetInvalidArg;
+    }
+
+    if(m_IsTicking)
+    {
+        DebugPrintF(u8"[PetManager::DestroyPet]: Pets cannot be destroyed while the pets are being ticked.\n");
+        return PetFail;
+    }
+
+    PetEntity* const pet = PetEntity::FromHandle(petHandle);
+
+    if(!RemovePet(m_Pets, pet))
+    {
+        return PetInvalidArg;
+    }
+
+    if(!RemovePet(m_ActivePets, pet))
+    {
+        for(::std::size_t i = 0; i < m_SleepingPets.size(); ++i)
+        {
+            if(m_SleepingPets[i].Pet == pet)
+            {
+                m_SleepingPets[i] = m_SleepingPets.back();
+                m_SleepingPets.pop_back();
+                ::std::make_heap(m_SleepingPets.begin(), m_SleepingPets.end(), WakesLater);
+                break;
+            }
+        }
+    }
+
+    for(PetEntity* const other : m_Pets)
+    {
+        if(other->ParentMale() == pet)
+        {
+            other->ParentMale() = nullptr;
+        }
+
+        if(other->ParentFemale() == pet)
+        {
+            other->ParentFemale() = nullptr;
+        }
+    }
+
+    m_BlackboardColumns.FreeSlot(pet->Blackboard().ColumnSlot());
+
+    pet->~PetEntity();
+    m_PetArena.Deallocate(pet, m_PetBlockSize);
+
+    m_CheckpointWritten = false;
+
+    return PetSuccess;
+}
+
+PetStatus PetManager::InitPetStorage() noexcept
+{
+    if(!m_BlackboardColumns.IsInitialized())
+    {
+        const PetStatus status = m_BlackboardColumns.Init(m_BlackboardKeyManager);
+
+        if(IsStatusError(status))
+        {
+            DebugPrintF(u8"[PetManager::InitPetStorage]: m_BlackboardColumns.Init returned status 0x%08X.\n", status);
+            return status;
+        }
+    }
+
+    if(!m_BlackboardLayout.IsInitialized())
+    {
+        const PetStatus status = m_BlackboardLayout.Init(m_BlackboardKeyManager, &m_BlackboardColumns, PetBlackboardSchema::Size);
+
+        if(IsStatusError(status))
+        {
+            DebugPrintF(u8"[PetManager::InitPetStorage]: m_BlackboardLayout.Init returned status 0x%08X.\n", status);
+            return status;
+        }
+    }
+
+    m_BlackboardStorageOffset = (sizeof(PetEntity) + alignof(::std::max_align_t) - 1) & ~(alignof(::std::max_align_t) - 1);
+    m_PetBlockSize = m_BlackboardStorageOffset + m_BlackboardLayout.DataSize();
+
+    return PetSuccess;
+}
+
+PetStatus PetManager::ConstructPet(void* const state, const ::std::uint32_t stateSize, PetEntity** const ppPet) noexcept
+{
+    if(m_PetBlockSize == 0)
+    {
+        const PetStatus status = InitPetStorage();
+
+        if(IsStatusError(status))
+        {
+            DebugPrintF(u8"[PetManager::ConstructPet]: InitPetStorage returned status 0x%08X.\n", status);
+            return status;
+        }
+    }
+
+    void* const block = m_PetArena.Allocate(m_PetBlockSize);
+
+    if(!block)
+    {
+        return PetOutOfMemory;
+    }
+
+    ::std::uint32_t columnSlot;
+    const PetStatus slotStatus = m_BlackboardColumns.AllocSlot(&columnSlot);
+
+    if(IsStatusError(slotStatus))
+    {
+        DebugPrintF(u8"[PetManager::ConstructPet]: m_BlackboardColumns.AllocSlot returned status 0x%08X.\n", slotStatus);
+        m_PetArena.Deallocate(block, m_PetBlockSize);
+        return slotStatus;
+    }
+
+    PetEntity* const pet = new(block) PetEntity(
+        state, 
+        stateSize, 
+        m_BlackboardLayout,
+        columnSlot,
+        static_cast<unsigned char*>(block) + m_BlackboardStorageOffset,
+        &g_RootNode,
+        m_BehaviorTree.IsCompiled() ? &m_BehaviorTree : nullptr,
+        this
+    );
+    pet->LastTickTime() = m_TickTime;
+
+    m_Pets.push_back(pet);
+    m_CheckpointWritten = false;
+
+    *ppPet = pet;
+
+    return PetSuccess;
+}
+
+void PetManager::DestroyAllPets() noexcept
+{
+    for(PetEntity* const pet : m_Pets)
+    {
+        m_BlackboardColumns.FreeSlot(pet->Blackboard().ColumnSlot());
+
+        pet->~PetEntity();
+        m_PetArena.Deallocate(pet, m_PetBlockSize);
+    }
+
+    m_Pets.clear();
+    m_ActivePets.clear();
+    m_SleepingPets.clear();
+    m_CheckpointWritten = false;
+}
+
+PetStatus PetManager::SaveSnapshot(const void** const ppData, size_t* const pSize) noexcept
+{
+    if(!ppData || !pSize)
+    {
+        return PetInvalidArg;
+    }
+
+    if(m_IsTicking)
+    {
+        DebugPrintF(u8"[PetManager::SaveSnapshot]: A snapshot cannot be taken while the pets are being ticked.\n");
+        return PetFail;
+    }
+
+    const ::std::size_t blackboardSize = m_BlackboardLayout.IsInitialized() ? m_BlackboardLayout.DataSize() : 0;
+    const ::std::size_t columnSize = SnapshotColumnSize();
+    // Keep every record 8 byte aligned.
+    const ::std::size_t recordSize = (sizeof(PetSnapshotRecord) + blackboardSize + columnSize + 7) & ~static_cast<::std::size_t>(7);
+    const ::std::size_t snapshotSize = sizeof(PetSnapshotHeader) + recordSize * m_Pets.size();
+
+    // Whatever was written before no longer matches the buffer.
+    m_CheckpointWritten = false;
+
+    if(snapshotSize > m_SnapshotCapacity)
+    {
+        delete[] m_SnapshotBuffer;
+
+        m_SnapshotBuffer = new(::std::nothrow) ::std::uint8_t[snapshotSize];
+        m_SnapshotCapacity = m_SnapshotBuffer ? snapshotSize : 0;
+
+        if(!m_SnapshotBuffer)
+        {
+            m_SnapshotSize = 0;
+            return PetOutOfMemory;
+        }
+    }
+
+    m_SnapshotSize = snapshotSize;
+    m_SnapshotRecordSize = recordSize;
+
+    BuildSnapshotRecords();
+
+    for(::std::uint32_t i = 0; i < m_Pets.size(); ++i)
+    {
+        PetEntity* const pet = m_Pets[i];
+        ::std::uint8_t* const record = m_SnapshotBuffer + sizeof(PetSnapshotHeader) + recordSize * i;
+
+        (void) ::std::memcpy(record, &m_SnapshotRecords[i], sizeof(PetSnapshotRecord));
+        (void) ::std::memcpy(record + sizeof(PetSnapshotRecord), pet->Blackboard().Data(), blackboardSize);
+
+        ::std::uint8_t* const columnEnd = CopyColumnsToSnapshot(*pet, record + sizeof(PetSnapshotRecord) + blackboardSize);
+
+        ZeroMem(columnEnd, static_cast<size_t>(record + recordSize - columnEnd));
+
+        SealSnapshotRecord(record);
+        pet->Blackboard().ClearDirty();
+    }
+
+    PetSnapshotHeader header {};
+    (void) ::std::memcpy(header.Magic, PetSnapshotHeader::FileMagic, sizeof(header.Magic));
+    header.Endian = PetSnapshotHeader::GoodEndian;
+    header.Version = PetSnapshotHeader::FileVersion1_0;
+    header.LayoutCrc = SnapshotLayoutCrc();
+    header.PetCount = static_cast<::std::uint32_t>(m_Pets.size());
+    header.RecordSize = static_cast<::std::uint32_t>(recordSize);
+    header.BlackboardSize = static_cast<::std::uint32_t>(blackboardSize);
+    header.ColumnSize = static_cast<::std::uint32_t>(columnSize);
+    header.TickTime = m_TickTime;
+    header.Crc = UpdateCRC32(0, &header, sizeof(header));
+
+    (void) ::std::memcpy(m_SnapshotBuffer, &header, sizeof(header));
+
+    *ppData = m_SnapshotBuffer;
+    *pSize = snapshotSize;
+
+    return PetSuccess;
+}
+
+PetStatus PetManager::WriteCheckpoint() noexcept
+{
+    if(!m_AppFunctions.SavePetState)
+    {
+        return PetNotImplemented;
+    }
+
+    PetStatus status = CaptureCheckpoint(m_CheckpointBatch);
+
+    if(IsStatusError(status))
+    {
+        return status;
+    }
+
+    status = m_CheckpointBatch.Write(m_AppFunctions.SavePetState, m_AppHandle, PetSnapshotFileHandle);
+
+    if(!IsStatusSuccess(status))
+    {
+        DebugPrintF(u8"[PetManager::WriteCheckpoint]: SavePetState returned status 0x%08X.\n", status);
+
+        // The file is now partially written, start over with a full snapshot.
+        m_CheckpointWritten = false;
+    }
+
+    return status;
+}
+
+PetStatus PetManager::StartCheckpointWriter() noexcept
+{
+    if(!m_AppFunctions.SavePetState)
+    {
+        return PetNotImplemented;
+    }
+
+    return m_CheckpointWriter.Start(m_AppFunctions.SavePetState, m_AppHandle, PetSnapshotFileHandle);
+}
+
+void PetManager::StopCheckpointWriter() noexcept
+{
+    m_CheckpointWriter.Stop();
+    PollCheckpoints();
+}
+
+PetStatus PetManager::QueueCheckpoint() noexcept
+{
+    if(!m_CheckpointWriter.IsRunning())
+    {
+        return WriteCheckpoint();
+    }
+
+    CheckpointBatch* const batch = m_CheckpointWriter.AcquireBatch();
+
+    //   The writer is still busy, the dirty lines are kept until the
+    // next checkpoint gets through.
+    if(!batch)
+    {
+        return PetNoMoreItems;
+    }
+
+    const PetStatus status = CaptureCheckpoint(*batch);
+
+    if(IsStatusError(status))
+    {
+        return status;
+    }
+
+    m_CheckpointWriter.Submit();
+
+    return PetSuccess;
+}
+
+void PetManager::PollCheckpoints() noexcept
+{
+    CheckpointWriter::Result result;
+
+    while(m_CheckpointWriter.PopResult(&result))
+    {
+        if(!IsStatusSuccess(result.Status))
+        {
+            // Batches are only deltas of what was supposed to be on disk.
+            m_CheckpointWritten = false;
+        }
+
+        if(m_AppFunctions.PetEvent && m_AppFunctions.Version >= PET_AI_VERSION_1_5)
+        {
+            PetEventSaveComplete saveComplete {};
+            saveComplete.File = PetSnapshotFileHandle;
+            saveComplete.Status = result.Status;
+            saveComplete.BytesWritten = result.BytesWritten;
+
+            PetEventData eventData {};
+            eventData.PetHandle.Ptr = nullptr;
+            eventData.EventName = "SaveComplete";
+            eventData.EventType = SaveComplete;
+            eventData.Event.SaveComplete = &saveComplete;
+
+            (void) m_AppFunctions.PetEvent(m_AppHandle, &eventData);
+        }
+    }
+}
+
+PetStatus PetManager::CaptureCheckpoint(CheckpointBatch& batch) noexcept
+{
+    if(m_IsTicking)
+    {
+        DebugPrintF(u8"[PetManager::CaptureCheckpoint]: A checkpoint cannot be taken while the pets are being ticked.\n");
+        return PetFail;
+    }
+
+    batch.Clear();
+
+    const ::std::size_t blackboardSize = m_BlackboardLayout.IsInitialized() ? m_BlackboardLayout.DataSize() : 0;
+
+    if(!m_CheckpointWritten || m_SnapshotSize != sizeof(PetSnapshotHeader) + m_SnapshotRecordSize * m_Pets.size())
+    {
+        const void* snapshot;
+        size_t snapshotSize;
+        const PetStatus status = SaveSnapshot(&snapshot, &snapshotSize);
+
+        if(IsStatusError(status))
+        {
+            return status;
+        }
+
+        batch.Append(0, snapshot, snapshotSize);
+        m_CheckpointWritten = true;
+        return PetSuccess;
+    }
+
+    BuildSnapshotRecords();
+
+    const ::std::size_t lineSize = m_BlackboardLayout.DirtyLineSize();
+
+    for(::std::uint32_t i = 0; i < m_Pets.size(); ++i)
+    {
+        PetEntity* const pet = m_Pets[i];
+        ::Blackboard& blackboard = pet->Blackboard();
+        const ::std::size_t recordOffset = sizeof(PetSnapshotHeader) + m_SnapshotRecordSize * i;
+        ::std::uint8_t* const record = m_SnapshotBuffer + recordOffset;
+        ::std::uint8_t* const data = record + sizeof(PetSnapshotRecord);
+
+        const bool recordChanged = ::std::memcmp(record, &m_SnapshotRecords[i], offsetof(PetSnapshotRecord, Crc)) != 0;
+        const bool columnsDirty = blackboard.ColumnsDirty();
+        ::std::uint64_t dirtyLines = 0;
+
+        //   A dirty line was written, but the tree often puts back the value
+        // it had, a selector key is set and cleared on every pass. Only the
+        // lines that differ from the file are copied and written.
+        for(::std::uint64_t lines = blackboard.DirtyLines(); lines; lines &= lines - 1)
+        {
+            const ::std::size_t lineOffset = static_cast<::std::size_t>(::std::countr_zero(lines)) * lineSize;
+            const ::std::size_t length = lineOffset + lineSize < blackboardSize ? lineSize : blackboardSize - lineOffset;
+            const ::std::uint8_t* const line = static_cast<const ::std::uint8_t*>(blackboard.Data()) + lineOffset;
+
+            if(::std::memcmp(data + lineOffset, line, length) != 0)
+            {
+                (void) ::std::memcpy(data + lineOffset, line, length);
+                dirtyLines |= lines & (~lines + 1);
+            }
+        }
+
+        if(!recordChanged && !dirtyLines && !columnsDirty)
+        {
+            blackboard.ClearDirty();
+            continue;
+        }
+
+        (void) ::std::memcpy(record, &m_SnapshotRecords[i], sizeof(PetSnapshotRecord));
+
+        if(columnsDirty)
+        {
+            (void) CopyColumnsToSnapshot(*pet, data + blackboardSize);
+        }
+
+        SealSnapshotRecord(record);
+        blackboard.ClearDirty();
+
+        // The record header holds the CRC, so it is written every time.
+        batch.Append(recordOffset, record, sizeof(PetSnapshotRecord));
+
+        // Write each run of consecutive dirty lines at once.
+        for(::std::uint64_t lines = dirtyLines; lines;)
+        {
+            const ::std::uint32_t firstLine = static_cast<::std::uint32_t>(::std::countr_zero(lines));
+            const ::std::uint32_t lineCount = static_cast<::std::uint32_t>(::std::countr_one(lines >> firstLine));
+            const ::std::size_t lineOffset = static_cast<::std::size_t>(firstLine) * lineSize;
+            const ::std::size_t runEnd = lineOffset + static_cast<::std::size_t>(lineCount) * lineSize;
+
+            batch.Append(recordOffset + sizeof(PetSnapshotRecord) + lineOffset, data + lineOffset, (runEnd < blackboardSize ? runEnd : blackboardSize) - lineOffset);
+
+            lines = firstLine + lineCount >= 64 ? 0 : lines & ~((static_cast<::std::uint64_t>(1) << (firstLine + lineCount)) - 1);
+        }
+
+        if(columnsDirty)
+        {
+            batch.Append(recordOffset + sizeof(PetSnapshotRecord) + blackboardSize, data + blackboardSize, SnapshotColumnSize());
+        }
+    }
+
+    PetSnapshotHeader header;
+    (void) ::std::memcpy(&header, m_SnapshotBuffer, sizeof(header));
+    header.TickTime = m_TickTime;
+    header.Crc = 0;
+    header.Crc = UpdateCRC32(0, &header, sizeof(header));
+    (void) ::std::memcpy(m_SnapshotBuffer, &header, sizeof(header));
+
+    batch.Append(0, m_SnapshotBuffer, sizeof(header));
+
+    return PetSuccess;
+}
+
+void PetManager::BuildSnapshotRecords() noexcept
+{
+    m_SnapshotIndices.resize(m_Pets.size());
+    m_SnapshotRecords.resize(m_Pets.size());
+
+    for(::std::uint32_t i = 0; i < m_Pets.size(); ++i)
+    {
+        m_SnapshotIndices[i] = { m_Pets[i], i };
+    }
+
+    ::std::sort(m_SnapshotIndices.begin(), m_SnapshotIndices.end(), [](const SnapshotIndex& left, const SnapshotIndex& right) { return left.Pet < right.Pet; });
+
+    for(::std::uint32_t i = 0; i < m_Pets.size(); ++i)
+    {
+        PetEntity* const pet = m_Pets[i];
+
+        PetSnapshotRecord& petRecord = m_SnapshotRecords[i];
+        petRecord = { };
+        petRecord.ParentMale = FindSnapshotIndex(pet->ParentMale());
+        petRecord.ParentFemale = FindSnapshotIndex(pet->ParentFemale());
+        petRecord.Gender = static_cast<::std::uint32_t>(pet->Gender());
+        petRecord.LastTickTime = pet->LastTickTime();
+        petRecord.Executor = pet->BehaviorTreeExecutor().SaveState();
+    }
+
+    for(const SleepingPet& sleepingPet : m_SleepingPets)
+    {
+        PetSnapshotRecord& petRecord = m_SnapshotRecords[static_cast<::std::size_t>(FindSnapshotIndex(sleepingPet.Pet))];
+        petRecord.Flags = PetSnapshotRecord::SleepingFlag;
+        petRecord.WakeTime = sleepingPet.WakeTime;
+    }
+}
+
+::std::uint8_t* PetManager::CopyColumnsToSnapshot(PetEntity& pet, ::std::uint8_t* column) noexcept
+{
+    for(::std::int32_t key = 0; key < m_BlackboardColumns.KeyCount(); ++key)
+    {
+        const ::std::size_t elementSize = m_BlackboardColumns.ElementSize(BlackboardKey(key));
+
+        if(elementSize > 0)
+        {
+            (void) ::std::memcpy(column, m_BlackboardColumns.Get(BlackboardKey(key), pet.Blackboard().ColumnSlot()), elementSize);
+            column += elementSize;
+        }
+    }
+
+    return column;
+}
+
+void PetManager::SealSnapshotRecord(::std::uint8_t* const record) const noexcept
+{
+    ::std::uint32_t crc = 0;
+    (void) ::std::memcpy(record + offsetof(PetSnapshotRecord, Crc), &crc, sizeof(crc));
+
+    crc = UpdateCRC32(0, record, m_SnapshotRecordSize);
+    (void) ::std::memcpy(record + offsetof(PetSnapshotRecord, Crc), &crc, sizeof(crc));
+}
+
+PetStatus PetManager::RestoreSnapshot(const void* const data, const size_t size) noexcept
+{
+    if(!data || size < sizeof(PetSnapshotHeader))
+    {
+        return PetInvalidArg;
+    }
+
+    if(m_IsTicking)
+    {
+        DebugPrintF(u8"[PetManager::RestoreSnapshot]: A snapshot cannot be restored while the pets are being ticked.\n");
+        return PetFail;
+    }
+
+    const ::std::uint8_t* const bytes = static_cast<const ::std::uint8_t*>(data);
+
+    PetSnapshotHeader header;
+    (void) ::std::memcpy(&header, bytes, sizeof(header));
+
+    if(::std::memcmp(header.Magic, PetSnapshotHeader::FileMagic, sizeof(header.Magic)) != 0 ||
+       header.Endian != PetSnapshotHeader::GoodEndian ||
+       header.Version != PetSnapshotHeader::FileVersion1_0)
+    {
+        DebugPrintF(u8"[PetManager::RestoreSnapshot]: The data is not a snapshot.\n");
+        return PetFail;
+    }
+
+    const ::std::uint32_t headerCrc = header.Crc;
+    header.Crc = 0;
+
+    if(headerCrc != UpdateCRC32(0, &header, sizeof(header)))
+    {
+        DebugPrintF(u8"[PetManager::RestoreSnapshot]: The snapshot header failed its CRC check.\n");
+        return PetFail;
+    }
+
+    // The file can be longer than the snapshot, if it once held more pets.
+    if(static_cast<::std::uint64_t>(header.RecordSize) * header.PetCount > size - sizeof(PetSnapshotHeader))
+    {
+        DebugPrintF(u8"[PetManager::RestoreSnapshot]: The snapshot is truncated.\n");
+        return PetFail;
+    }
+
+    if(m_PetBlockSize == 0)
+    {
+        const PetStatus status = InitPetStorage();
+
+        if(IsStatusError(status))
+        {
+            DebugPrintF(u8"[PetManager::RestoreSnapshot]: InitPetStorage returned status 0x%08X.\n", status);
+            return status;
+        }
+    }
+
+    const ::std::size_t blackboardSize = m_BlackboardLayout.DataSize();
+    const ::std::size_t columnSize = SnapshotColumnSize();
+
+    if(header.PetCount > 0 && (
+       header.LayoutCrc != SnapshotLayoutCrc() ||
+       header.BlackboardSize != blackboardSize ||
+       header.ColumnSize != columnSize ||
+       header.RecordSize < sizeof(PetSnapshotRecord) + blackboardSize + columnSize))
+    {
+        DebugPrintF(u8"[PetManager::RestoreSnapshot]: The snapshot was written with a different blackboard layout.\n");
+        return PetFail;
+    }
+
+    PetSnapshotRecord petRecord;
+
+    //   A record that fails its checks only loses that one pet, the rest
+    // of the snapshot is still good. This holds the index in m_Pets that
+    // each record is restored to, or -1 if the record is skipped.
+    ::std::vector<::std::int32_t> restoredIndices(header.PetCount, -1);
+    ::std::int32_t restoredCount = 0;
+
+    for(::std::uint32_t i = 0; i < header.PetCount; ++i)
+    {
+        const ::std::uint8_t* const record = bytes + sizeof(PetSnapshotHeader) + static_cast<::std::size_t>(header.RecordSize) * i;
+        (void) ::std::memcpy(&petRecord, record, sizeof(petRecord));
+
+        const ::std::uint32_t zeroCrc = 0;
+        ::std::uint32_t crc = UpdateCRC32(0, record, offsetof(PetSnapshotRecord, Crc));
+        crc = UpdateCRC32(crc, &zeroCrc, sizeof(zeroCrc));
+        crc = UpdateCRC32(crc, record + offsetof(PetSnapshotRecord, Crc) + sizeof(zeroCrc), header.RecordSize - offsetof(PetSnapshotRecord, Crc) - sizeof(zeroCrc));
+
+        if(crc != petRecord.Crc)
+        {
+            DebugPrintF(u8"[PetManager::RestoreSnapshot]: Pet %u failed its CRC check, skipping it.\n", i);
+            continue;
+        }
+
+        if(petRecord.ParentMale < -1 || petRecord.ParentMale >= static_cast<::std::int64_t>(header.PetCount) ||
+           petRecord.ParentFemale < -1 || petRecord.ParentFemale >= static_cast<::std::int64_t>(header.PetCount))
+        {
+            DebugPrintF(u8"[PetManager::RestoreSnapshot]: Pet %u has an invalid parent, skipping it.\n", i);
+            continue;
+        }
+
+        if(petRecord.Gender > static_cast<::std::uint32_t>(PetGenderFemale))
+        {
+            DebugPrintF(u8"[PetManager::RestoreSnapshot]: Pet %u has an invalid gender, skipping it.\n", i);
+            continue;
+        }
+
+        restoredIndices[i] = restoredCount++;
+    }
+
+    DestroyAllPets();
+
+    m_TickTime = header.TickTime;
+    m_Pets.reserve(static_cast<::std::size_t>(restoredCount));
+
+    for(::std::uint32_t i = 0; i < header.PetCount; ++i)
+    {
+        if(restoredIndices[i] < 0)
+        {
+            continue;
+        }
+
+        const ::std::uint8_t* const record = bytes + sizeof(PetSnapshotHeader) + static_cast<::std::size_t>(header.RecordSize) * i;
+        (void) ::std::memcpy(&petRecord, record, sizeof(petRecord));
+
+        PetEntity* pet;
+        const PetStatus status = ConstructPet(nullptr, 0, &pet);
+
+        if(IsStatusError(status))
+        {
+            DebugPrintF(u8"[PetManager::RestoreSnapshot]: ConstructPet returned status 0x%08X.\n", status);
+            DestroyAllPets();
+            return status;
+        }
+
+        (void) ::std::memcpy(pet->Blackboard().Data(), record + sizeof(petRecord), blackboardSize);
+
+        const ::std::uint8_t* column = record + sizeof(petRecord) + blackboardSize;
+
+        for(::std::int32_t key = 0; key < m_BlackboardColumns.KeyCount(); ++key)
+        {
+            const ::std::size_t elementSize = m_BlackboardColumns.ElementSize(BlackboardKey(key));
+
+            if(elementSize > 0)
+            {
+                (void) ::std::memcpy(m_BlackboardColumns.Get(BlackboardKey(key), pet->Blackboard().ColumnSlot()), column, elementSize);
+                column += elementSize;
+            }
+        }
+
+        pet->Gender() = static_cast<PetGender>(petRecord.Gender);
+        pet->LastTickTime() = petRecord.LastTickTime;
+
+        const PetStatus executorStatus = pet->BehaviorTreeExecutor().RestoreState(petRecord.Executor);
+
+        if(IsStatusError(executorStatus))
+        {
+            DebugPrintF(u8"[PetManager::RestoreSnapshot]: Pet %u is at a node that is not in the tree, restarting its tree.\n", i);
+        }
+
+        if(petRecord.Flags & PetSnapshotRecord::SleepingFlag)
+        {
+            m_SleepingPets.push_back({ petRecord.WakeTime, pet });
+        }
+        else
+        {
+            m_ActivePets.push_back(pet);
+        }
+    }
+
+    // A parent that was skipped is forgotten, just like a destroyed parent.
+    const auto findRestored = [&](const ::std::int64_t index) -> PetEntity*
+    {
+        return index >= 0 && restoredIndices[index] >= 0 ? m_Pets[restoredIndices[index]] : nullptr;
+    };
+
+    for(::std::uint32_t i = 0; i < header.PetCount; ++i)
+    {
+        if(restoredIndices[i] < 0)
+        {
+            continue;
+        }
+
+        (void) ::std::memcpy(&petRecord, bytes + sizeof(PetSnapshotHeader) + static_cast<::std::size_t>(header.RecordSize) * i, sizeof(petRecord));
+
+        PetEntity* const pet = m_Pets[restoredIndices[i]];
+        pet->ParentMale() = findRestored(petRecord.ParentMale);
+        pet->ParentFemale() = findRestored(petRecord.ParentFemale);
+    }
+
+    ::std::make_heap(m_SleepingPets.begin(), m_SleepingPets.end(), WakesLater);
+
+    m_CheckpointWritten = false;
+
+    return PetSuccess;
+}
+
+::std::size_t PetManager::SnapshotColumnSize() const noexcept
+{
+    ::std::size_t columnSize = 0;
+
+    for(::std::int32_t key = 0; key < m_BlackboardColumns.KeyCount(); ++key)
+    {
+        columnSize += m_BlackboardColumns.ElementSize(BlackboardKey(key));
+    }
+
+    return columnSize;
+}
+
+::std::uint32_t PetManager::SnapshotLayoutCrc() const noexcept
+{
+    ::std::uint32_t crc = 0;
+
+    for(::std::int32_t key = 0; key < m_BlackboardLayout.KeyCount(); ++key)
+    {
+        const ::std::uint64_t offset = m_BlackboardLayout.Offset(BlackboardKey(key));
+        const ::std::uint64_t elementSize = m_BlackboardColumns.ElementSize(BlackboardKey(key));
+
+        crc = UpdateCRC32(crc, &offset, sizeof(offset));
+        crc = UpdateCRC32(crc, &elementSize, sizeof(elementSize));
+    }
+
+    return crc;
+}
+
+::std::int32_t PetManager::FindSnapshotIndex(const PetEntity* const pet) const noexcept
+{
+    if(!pet)
+    {
+        return -1;
+    }
+
+    const auto found = ::std::lower_bound(m_SnapshotIndices.begin(), m_SnapshotIndices.end(), pet, [](const SnapshotIndex& index, const PetEntity* const value) { return index.Pet < value; });
+
+    if(found == m_SnapshotIndices.end() || found->Pet != pet)
+    {
+        return -1;
+    }
+
+    return static_cast<::std::int32_t>(found->Index);
+}
+
+bool PetManager::RemovePet(PetArray& pets, const PetEntity* const pet) noexcept
+{
+    for(::std::size_t i = 0; i < pets.size(); ++i)
+    {
+        if(pets[i] == pet)
+        {
+            pets[i] = pets.back();
+            pets.pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
+
 PetStatus PetManager::CreateDefaultRenderer(const CreateDefaultPetRenderer* pCreateDefaultRenderer) const noexcept
 {
     if(!pCreateDefaultRenderer)
@@ -96,6 +910,16 @@ PetStatus PetManager::DestroyDefaultRenderer(const PetRendererHandle rendererHan
     return DefaultPetRenderer::DestroyDefaultRenderer(rendererHandle);
 }
 
+PetStatus PetManager::LoadBlackboardKeys() noexcept
+{
+    return m_BlackboardKeyLoader.Load(m_BlackboardKeyManager, *this);
+}
+
+void PetManager::UnloadBlackboardKeys() noexcept
+{
+    m_BlackboardKeyLoader.Unload();
+}
+
 PetStatus PetManager::CreateRenderer() noexcept
 {
     if(!m_AppFunctions.CreateRenderer)
@@ -144,43 +968,288 @@ PetStatus PetManager::CreateRenderer() noexcept
     }
 
     m_HasRenderer = true;
+    m_ScreenWidth = width;
+    m_ScreenHeight = height;
+
+    m_RenderThread.Init(m_AppFunctions.Present, m_AppHandle, m_RendererHandle, &m_RendererFunctions);
 
-    if(m_RendererFunctions.ClearScreen)
+    return PetSuccess;
+}
+
+PetStatus PetManager::StartRenderThread() noexcept
+{
+    if(!m_HasRenderer || !m_AppFunctions.Present)
     {
-        m_RendererFunctions.ClearScreen(m_RendererHandle, 200, 200, 200, 0);
+        return PetNotImplemented;
     }
 
-    if(m_RendererFunctions.DrawRectangle)
+    return m_RenderThread.Start();
+}
+
+void PetManager::StopRenderThread() noexcept
+{
+    m_RenderThread.Stop();
+}
+
+void PetManager::PresentFrame() noexcept
+{
+    if(!m_AppFunctions.Present)
+    {
+        return;
+    }
+
+    // Without a renderer there is nothing to draw, the application presents on its own.
+    if(!m_HasRenderer)
+    {
+        (void) m_AppFunctions.Present(m_AppHandle, m_RendererHandle, &m_RendererFunctions);
+        return;
+    }
+
+    SceneSnapshot& snapshot = m_RenderThread.BeginSnapshot();
+    CaptureScene(snapshot);
+    m_RenderThread.Publish();
+}
+
+void PetManager::CaptureScene(SceneSnapshot& snapshot) const noexcept
+{
+    const uint16_t width = m_ScreenWidth;
+    const uint16_t height = m_ScreenHeight;
+
+    snapshot.SetClear({ 200, 200, 200 }, 0);
+
+    PetDrawCommand command {};
+    command.Type = PetDrawCommandRectangle;
+
+    DrawRectData& rectData = command.Data.Rectangle;
+    rectData.Points[0].X = 0;
+    rectData.Points[0].Y = 0;
+    rectData.Points[1].X = width / 4;
+    rectData.Points[1].Y = height / 2;
+    rectData.Depth = 0xFFFF;
+    rectData.Color.R = 0x00;
+    rectData.Color.G = 0xFF;
+    rectData.Color.B = 0xFF;
+
+    snapshot.Append(command);
+
+    command = {};
+    command.Type = PetDrawCommandTriangle;
+
+    DrawTriangleData& triangleData = command.Data.Triangle;
+    triangleData.Points[0].X = width / 4;
+    triangleData.Points[0].Y = 0;
+    triangleData.Points[1].X = 0;
+    triangleData.Points[1].Y = height - 1;
+    triangleData.Points[2].X = width - 1;
+    triangleData.Points[2].Y = height - 4;
+    triangleData.Depth = 0xFFFF;
+    triangleData.Color.R = 0xFF;
+    triangleData.Color.G = 0x00;
+    triangleData.Color.B = 0xFF;
+
+    snapshot.Append(command);
+}
+
+PetStatus PetManager::CompileBehaviorTree(BehaviorTreeRepeatNode* const root) noexcept
+{
+    const PetStatus status = m_BehaviorTree.Compile(root);
+
+    if(IsStatusError(status))
     {
-        DrawRectData drawData {};
-        drawData.Points[0].X = 0;
-        drawData.Points[0].Y = 0;
-        drawData.Points[1].X = width / 4;
-        drawData.Points[1].Y = height / 2;
-        drawData.Depth = 0xFFFF;
-        drawData.Color.R = 0x00;
-        drawData.Color.G = 0xFF;
-        drawData.Color.B = 0xFF;
+        DebugPrintF(u8"[PetManager::CompileBehaviorTree]: m_BehaviorTree.Compile returned status 0x%08X.\n", status);
+    }
+
+    return status;
+}
+
+PetStatus PetManager::StartTickWorkers() noexcept
+{
+    const PetStatus status = m_TickWorkers.Start(m_AppFunctions.TickThreadCount);
 
-        m_RendererFunctions.DrawRectangle(m_RendererHandle, &drawData);
+    if(IsStatusError(status))
+    {
+        DebugPrintF(u8"[PetManager::StartTickWorkers]: m_TickWorkers.Start returned status 0x%08X.\n", status);
     }
 
-    if(m_RendererFunctions.DrawTriangle)
+    return status;
+}
+
+void PetManager::StopTickWorkers() noexcept
+{
+    m_TickWorkers.Stop();
+}
+
+void PetManager::TickPets(const float deltaTime) noexcept
+{
+    if(deltaTime > 0.0f)
     {
-        DrawTriangleData drawData {};
-        drawData.Points[0].X = width / 4;
-        drawData.Points[0].Y = 0;
-        drawData.Points[1].X = 0;
-        drawData.Points[1].Y = height - 1;
-        drawData.Points[2].X = width - 1;
-        drawData.Points[2].Y = height - 4;
-        drawData.Depth = 0xFFFF;
-        drawData.Color.R = 0xFF;
-        drawData.Color.G = 0x00;
-        drawData.Color.B = 0xFF;
+        m_TickTime += static_cast<::std::uint64_t>(static_cast<double>(deltaTime) * 1000000.0);
+    }
+
+    WakePets();
+    SortPendingActions();
+
+    m_IsTicking = true;
+
+    m_TickWorkers.ParallelFor(static_cast<::std::uint32_t>(m_PendingActionPets.size()), TickBatchSize, WorkerPool::TaskFunc::Bind<&PetManager::TickActionRange>(this));
+    m_TickWorkers.ParallelFor(static_cast<::std::uint32_t>(m_ActivePets.size()), TickBatchSize, WorkerPool::TaskFunc::Bind<&PetManager::EndTickRange>(this));
+
+    m_IsTicking = false;
+
+    SuspendPets();
+}
 
-        m_RendererFunctions.DrawTriangle(m_RendererHandle, &drawData);
+void PetManager::WakePets() noexcept
+{
+    while(!m_SleepingPets.empty() && m_SleepingPets.front().WakeTime <= m_TickTime)
+    {
+        ::std::pop_heap(m_SleepingPets.begin(), m_SleepingPets.end(), WakesLater);
+        m_ActivePets.push_back(m_SleepingPets.back().Pet);
+        m_SleepingPets.pop_back();
     }
+}
 
-    return PetSuccess;
+void PetManager::SortPendingActions() noexcept
+{
+    //   A counting sort on the compiled index of each pet's pending action,
+    // so that every pet waiting on the same action ends up next to each
+    // other.
+    const ::std::uint32_t nodeCount = m_BehaviorTree.NodeCount();
+
+    m_PendingActionOffsets.assign(static_cast<::std::size_t>(nodeCount) + 1, 0);
+
+    ::std::uint32_t pendingCount = 0;
+
+    for(PetEntity* const pet : m_ActivePets)
+    {
+        ::BehaviorTreeExecutor& executor = pet->BehaviorTreeExecutor();
+
+        // A pet that just woke up gets all the time it slept through.
+        const float deltaTime = static_cast<float>(static_cast<double>(m_TickTime - pet->LastTickTime()) / 1000000.0);
+        pet->LastTickTime() = m_TickTime;
+
+        executor.BeginTick(deltaTime);
+
+        const ::std::int32_t actionIndex = executor.PendingAction();
+
+        if(actionIndex >= 0 && static_cast<::std::uint32_t>(actionIndex) < nodeCount)
+        {
+            ++m_PendingActionOffsets[static_cast<::std::size_t>(actionIndex) + 1];
+            ++pendingCount;
+        }
+    }
+
+    for(::std::uint32_t i = 1; i <= nodeCount; ++i)
+    {
+        m_PendingActionOffsets[i] += m_PendingActionOffsets[i - 1];
+    }
+
+    m_PendingActionPets.resize(pendingCount);
+
+    for(PetEntity* const pet : m_ActivePets)
+    {
+        const ::std::int32_t actionIndex = pet->BehaviorTreeExecutor().PendingAction();
+
+        if(actionIndex >= 0 && static_cast<::std::uint32_t>(actionIndex) < nodeCount)
+        {
+            m_PendingActionPets[m_PendingActionOffsets[static_cast<::std::size_t>(actionIndex)]++] = pet;
+        }
+    }
+}
+
+void PetManager::SuspendPets() noexcept
+{
+    //   This runs after the parallel tick, so the executors are only ever
+    // read from here and the heap never has to be locked.
+    ::std::size_t activeCount = 0;
+
+    for(PetEntity* const pet : m_ActivePets)
+    {
+        const ::std::uint32_t suspendTime = pet->BehaviorTreeExecutor().SuspendTime();
+
+        if(suspendTime == 0)
+        {
+            m_ActivePets[activeCount++] = pet;
+            continue;
+        }
+
+        m_SleepingPets.push_back({ m_TickTime + static_cast<::std::uint64_t>(suspendTime) * 1000, pet });
+        ::std::push_heap(m_SleepingPets.begin(), m_SleepingPets.end(), WakesLater);
+    }
+
+    m_ActivePets.resize(activeCount);
+}
+
+void PetManager::TickActionRange(const ::std::uint32_t workerIndex, const ::std::uint32_t begin, const ::std::uint32_t end) noexcept
+{
+    (void) workerIndex;
+
+    ::std::uint32_t runBegin = begin;
+
+    while(runBegin < end)
+    {
+        const ::std::int32_t actionIndex = m_PendingActionPets[runBegin]->BehaviorTreeExecutor().PendingAction();
+
+        // Find every pet waiting on the same action, up to a full batch.
+        ::std::uint32_t runEnd = runBegin + 1;
+
+        while(runEnd < end && runEnd - runBegin < TickBatchSize && m_PendingActionPets[runEnd]->BehaviorTreeExecutor().PendingAction() == actionIndex)
+        {
+            ++runEnd;
+        }
+
+        RunActionBatch(m_BehaviorTree.Nodes()[actionIndex].Source.Action, &m_PendingActionPets[runBegin], runEnd - runBegin);
+
+        runBegin = runEnd;
+    }
+}
+
+void PetManager::RunActionBatch(const BehaviorTreeActionNode* const action, PetEntity* const* const pets, const ::std::uint32_t count) noexcept
+{
+    if(!action || !action->BatchHandler())
+    {
+        for(::std::uint32_t i = 0; i < count; ++i)
+        {
+            pets[i]->BehaviorTreeExecutor().RunPendingAction();
+        }
+
+        return;
+    }
+
+    ::Blackboard* blackboards[TickBatchSize];
+    ::std::uint32_t columnSlots[TickBatchSize];
+    float deltaTimes[TickBatchSize];
+    BehaviorTreeActionResult results[TickBatchSize];
+
+    for(::std::uint32_t i = 0; i < count; ++i)
+    {
+        const ::BehaviorTreeExecutor& executor = pets[i]->BehaviorTreeExecutor();
+        blackboards[i] = executor.Blackboard();
+        columnSlots[i] = blackboards[i]->ColumnSlot();
+        deltaTimes[i] = executor.DeltaTime();
+    }
+
+    BehaviorTreeActionBatch batch { };
+    batch.Count = count;
+    batch.Blackboards = blackboards;
+    batch.ColumnSlots = columnSlots;
+    batch.DeltaTimes = deltaTimes;
+    batch.Results = results;
+
+    action->BatchHandler()(*this, *action, batch);
+
+    for(::std::uint32_t i = 0; i < count; ++i)
+    {
+        pets[i]->BehaviorTreeExecutor().ApplyActionResult(results[i]);
+    }
+}
+
+void PetManager::EndTickRange(const ::std::uint32_t workerIndex, const ::std::uint32_t begin, const ::std::uint32_t end) noexcept
+{
+    (void) workerIndex;
+
+    for(::std::uint32_t i = begin; i < end; ++i)
+    {
+        m_ActivePets[i]->BehaviorTreeExecutor().EndTick();
+    }
 }
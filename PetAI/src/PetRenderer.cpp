@@ -1,14 +1,23 @@
 #include "PetRenderer.hpp"
+#include "SpanFill.hpp"
+#include <SysLib.h>
 
-#include <cassert>
+#include <algorithm>
 #include <cstring>
 #include <new>
+#include <utility>
 
 static PetStatus GetScreenSize(const PetRendererHandle rendererHandle, uint16_t* const pWidth, uint16_t* const pHeight);
 static PetStatus ClearScreen(const PetRendererHandle rendererHandle, const uint8_t r, const uint8_t g, const uint8_t b, const uint16_t depth);
 static PetStatus DrawRectangle(const PetRendererHandle rendererHandle, const DrawRectData* const pDrawData);
 static PetStatus DrawTriangle(const PetRendererHandle rendererHandle, const DrawTriangleData* const pDrawData);
 static PetStatus CopyFramebuffer(const PetRendererHandle rendererHandle, uint8_t* const pOutFramebuffer, const size_t size);
+static PetStatus CopyDirtyFramebuffer(const PetRendererHandle rendererHandle, uint8_t* const pOutFramebuffer, const size_t size, ScreenRect* const pOutRects, uint32_t* const pRectCount);
+static PetStatus BeginDrawCommands(const PetRendererHandle rendererHandle);
+static PetStatus SubmitDrawCommands(const PetRendererHandle rendererHandle, const PetDrawCommand* const pCommands, const uint32_t commandCount);
+static PetStatus EndDrawCommands(const PetRendererHandle rendererHandle);
+static PetStatus LockFramebuffer(const PetRendererHandle rendererHandle, PetFramebufferLock* const pLock);
+static PetStatus UnlockFramebuffer(const PetRendererHandle rendererHandle);
 
 PetStatus DefaultPetRenderer::GetScreenSize(uint16_t* pWidth, uint16_t* pHeight) const noexcept
 {
@@ -30,15 +39,19 @@ PetStatus DefaultPetRenderer::GetScreenSize(uint16_t* pWidth, uint16_t* pHeight)
 
 PetStatus DefaultPetRenderer::ClearScreen(const uint8_t r, const uint8_t g, const uint8_t b, const uint16_t depth) noexcept
 {
-    const size_t framebufferSize = FramebufferSize();
-
-    for(size_t i = 0; i < framebufferSize; i += 3)
+    //   Tiled mode holds draws back the same way recording does, they are
+    // just drawn in call order.
+    if(m_Recording || IsTiled())
     {
-        m_Framebuffer[i + 0] = r;
-        m_Framebuffer[i + 1] = g;
-        m_Framebuffer[i + 2] = b;
+        // Nothing recorded so far would be visible.
+        m_Commands.clear();
+        m_HasRecordedClear = true;
+        m_RecordedClear = { { r, g, b }, depth };
+        return PetSuccess;
     }
 
+    RasterizeClear({ r, g, b }, depth);
+
     return PetSuccess;
 }
 
@@ -49,291 +62,977 @@ PetStatus DefaultPetRenderer::DrawRectangle(const DrawRectData* pDrawData) noexc
         return PetInvalidArg;
     }
 
-    const uint16_t startY = pDrawData->Points[0].Y < pDrawData->Points[1].Y ? pDrawData->Points[0].Y : pDrawData->Points[1].Y;
-    const uint16_t endY   = pDrawData->Points[0].Y < pDrawData->Points[1].Y ? pDrawData->Points[1].Y : pDrawData->Points[0].Y;
-    const uint16_t startX = pDrawData->Points[0].X < pDrawData->Points[1].X ? pDrawData->Points[0].X : pDrawData->Points[1].X;
-    const uint16_t endX   = pDrawData->Points[0].X < pDrawData->Points[1].X ? pDrawData->Points[1].X : pDrawData->Points[0].X;
+    if(m_Recording || IsTiled())
+    {
+        PetDrawCommand command { };
+        command.Type = PetDrawCommandRectangle;
+        command.Data.Rectangle = *pDrawData;
+        return RecordCommand(command);
+    }
+
+    RasterizeRectangle(*pDrawData);
+
+    return PetSuccess;
+}
+
+void DefaultPetRenderer::RasterizeClear(const RGBColor color, const uint16_t depth) noexcept
+{
+    ClearArea(color, depth, 0, 0, m_Width, m_Height);
+
+    m_DirtyRectCount = 0;
+    MarkDirty(0, 0, m_Width, m_Height);
+}
+
+void DefaultPetRenderer::RasterizeRectangle(const DrawRectData& drawData) noexcept
+{
+    const uint16_t startY = drawData.Points[0].Y < drawData.Points[1].Y ? drawData.Points[0].Y : drawData.Points[1].Y;
+    const uint16_t endY   = drawData.Points[0].Y < drawData.Points[1].Y ? drawData.Points[1].Y : drawData.Points[0].Y;
+    const uint16_t startX = drawData.Points[0].X < drawData.Points[1].X ? drawData.Points[0].X : drawData.Points[1].X;
+    const uint16_t endX   = drawData.Points[0].X < drawData.Points[1].X ? drawData.Points[1].X : drawData.Points[0].X;
+
+    MarkDirty(startX, startY, endX, endY);
+    RasterizeRectangleArea(drawData, 0, 0, m_Width, m_Height);
+}
+
+void DefaultPetRenderer::ClearArea(const RGBColor color, const uint16_t depth, const int32_t startX, const int32_t startY, const int32_t endX, const int32_t endY) noexcept
+{
+    const size_t rowPixels = static_cast<size_t>(endX - startX);
 
-    for(uint16_t y = startY; y < endY; ++y)
+    // Full rows are contiguous.
+    if(startX == 0 && endX == m_Width)
     {
-        for(uint16_t x = startX; x < endX; ++x)
+        const size_t pixel = static_cast<size_t>(startY) * static_cast<size_t>(m_Width);
+        const size_t pixelCount = static_cast<size_t>(endY - startY) * rowPixels;
+
+        SpanFill::FillRgb(m_Framebuffer + pixel * 3, pixelCount, color.R, color.G, color.B);
+
+        if(m_DepthBuffer)
         {
-            const size_t i = (static_cast<size_t>(m_Width) * static_cast<size_t>(y) + static_cast<size_t>(x)) * 3;
-            m_Framebuffer[i + 0] = pDrawData->Color.R;
-            m_Framebuffer[i + 1] = pDrawData->Color.G;
-            m_Framebuffer[i + 2] = pDrawData->Color.B;
+            ::std::fill_n(m_DepthBuffer + pixel, pixelCount, depth);
         }
     }
+    else
+    {
+        for(int32_t y = startY; y < endY; ++y)
+        {
+            const size_t pixel = static_cast<size_t>(y) * static_cast<size_t>(m_Width) + static_cast<size_t>(startX);
 
-    return PetSuccess;
-}
+            SpanFill::FillRgb(m_Framebuffer + pixel * 3, rowPixels, color.R, color.G, color.B);
 
-/**
- *   This function orders the points first based on their y-coordinate,
- * and then their x-coordinate. This sorts from the lowest point to the
- * highest point, in terms of its y value, rather than perceptual point
- * on the screen.
- *
- *   The return value is 3 nibbles, in Big Endian order, of the order
- * of points, so 0x012 has point 0 as the lowest point, point 1 in the
- * middle, and point 2 as the highest. 0x201 would have point 2 as the
- * lowest, point 0 in the middle, and point 1 as the highest.
- *
- *   This can probably be simplified, but for now these test cases
- * clearly explain each possible arrangement of points.
- *
- * @param points The 3 points to order.
- * @return 3 nibbles from MSB-LSB order of points.
- */
-static uint16_t PickPoint(const ScreenPoint points[3]) noexcept
-{
-    if(points[0].Y < points[1].Y) // y_0 < y_1
-    {
-        if(points[0].Y < points[2].Y) // y_0 < y_1 && y_0 < y_2
-        {
-            if(points[1].Y < points[2].Y) // y_0 < y_1 < y_2
+            if(m_DepthBuffer)
             {
-                return 0x012;
-            }
-            else if(points[2].Y < points[1].Y) // y_0 < y_2 < y_1
-            {
-                return 0x021;
-            }
-            else // y_0 < y_1 == y_2
-            {
-                if(points[1].X < points[2].X) // y_0 < y_1 == y_2 && x_1 < x_2
-                {
-                    return 0x012;
-                }
-                else // y_0 < y_1 == y_2 && x_2 <= x_1
-                {
-                    return 0x021;
-                }
+                ::std::fill_n(m_DepthBuffer + pixel, rowPixels, depth);
             }
         }
-        else if(points[2].Y < points[0].Y) // y_2 < y_0 < y_1
+    }
+
+    if(!m_DepthBuffer)
+    {
+        return;
+    }
+
+    const int32_t endTileX = (endX + TileSize - 1) / TileSize;
+    const int32_t endTileY = (endY + TileSize - 1) / TileSize;
+
+    for(int32_t tileY = startY / TileSize; tileY < endTileY; ++tileY)
+    {
+        ::std::fill(m_TileDepths + tileY * m_TileCountX + startX / TileSize, m_TileDepths + tileY * m_TileCountX + endTileX, depth);
+    }
+}
+
+void DefaultPetRenderer::RasterizeRectangleArea(const DrawRectData& drawData, int32_t startX, int32_t startY, int32_t endX, int32_t endY) noexcept
+{
+    startX = ::std::max<int32_t>(startX, ::std::min(drawData.Points[0].X, drawData.Points[1].X));
+    startY = ::std::max<int32_t>(startY, ::std::min(drawData.Points[0].Y, drawData.Points[1].Y));
+    endX = ::std::min<int32_t>(endX, ::std::max(drawData.Points[0].X, drawData.Points[1].X));
+    endY = ::std::min<int32_t>(endY, ::std::max(drawData.Points[0].Y, drawData.Points[1].Y));
+
+    if(startX >= endX || startY >= endY)
+    {
+        return;
+    }
+
+    if(!m_DepthBuffer)
+    {
+        for(int32_t y = startY; y < endY; ++y)
         {
-            return 0x201;
+            FillSpan(y, startX, endX, drawData.Color, drawData.Depth);
         }
-        else // y_2 == y_0 < y_1
+
+        return;
+    }
+
+    //   Go a tile at a time, so that the parts of the rectangle that are
+    // hidden are skipped without looking at their pixels.
+    for(int32_t tileY = startY / TileSize; tileY <= (endY - 1) / TileSize; ++tileY)
+    {
+        const int32_t tileStartY = ::std::max(tileY * TileSize, startY);
+        const int32_t tileEndY = ::std::min(tileY * TileSize + TileSize, endY);
+
+        for(int32_t tileX = startX / TileSize; tileX <= (endX - 1) / TileSize; ++tileX)
         {
-            if(points[0].X < points[2].X) // y_2 == y_0 < y_1 && x_0 < x_2
+            if(IsTileHidden(tileX, tileY, drawData.Depth))
             {
-                return 0x021;
+                continue;
             }
-            else // y_2 == y_0 < y_1 && x_2 <= x_0
+
+            const int32_t tileStartX = ::std::max(tileX * TileSize, startX);
+            const int32_t tileEndX = ::std::min(tileX * TileSize + TileSize, endX);
+
+            for(int32_t y = tileStartY; y < tileEndY; ++y)
             {
-                return 0x201;
+                FillSpan(y, tileStartX, tileEndX, drawData.Color, drawData.Depth);
             }
+
+            CoverTile(tileX, tileY, tileStartX, tileStartY, tileEndX, tileEndY, drawData.Depth);
         }
     }
-    else if(points[1].Y < points[0].Y) // y_1 < y_0
+}
+
+bool DefaultPetRenderer::SetupTriangle(const DrawTriangleData& drawData, TriangleSetup* const pSetup) const noexcept
+{
+    int64_t x[3];
+    int64_t y[3];
+
+    for(uint32_t i = 0; i < 3; ++i)
+    {
+        x[i] = static_cast<int64_t>(drawData.Points[i].X) << SubPixelBits;
+        y[i] = static_cast<int64_t>(drawData.Points[i].Y) << SubPixelBits;
+    }
+
+    const int64_t area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+
+    // Degenerate triangles don't cover any pixel centers.
+    if(area == 0)
+    {
+        return false;
+    }
+
+    // Wind every triangle the same way, so that the inside is where all edges are positive.
+    if(area < 0)
     {
-        if(points[1].Y < points[2].Y) // y_1 < y_0 && y_1 < y_2
+        ::std::swap(x[1], x[2]);
+        ::std::swap(y[1], y[2]);
+    }
+
+    int64_t minX = x[0];
+    int64_t minY = y[0];
+    int64_t maxX = x[0];
+    int64_t maxY = y[0];
+
+    for(uint32_t i = 0; i < 3; ++i)
+    {
+        const uint32_t next = i == 2 ? 0 : i + 1;
+        const int64_t dx = x[next] - x[i];
+        const int64_t dy = y[next] - y[i];
+
+        TriangleEdge& edge = pSetup->Edges[i];
+        edge.StepX = -dy << SubPixelBits;
+        edge.StepY = dx << SubPixelBits;
+
+        //   The edge function at the center of pixel (0, 0). Pixel centers
+        // that land exactly on an edge only belong to the triangle if the
+        // edge is a top or a left edge, so that triangles sharing an edge
+        // don't both draw it.
+        const bool isTopLeft = (dy == 0 && dx > 0) || dy < 0;
+        edge.Origin = dx * (SubPixelHalf - y[i]) - dy * (SubPixelHalf - x[i]) - (isTopLeft ? 0 : 1);
+
+        minX = ::std::min(minX, x[i]);
+        minY = ::std::min(minY, y[i]);
+        maxX = ::std::max(maxX, x[i]);
+        maxY = ::std::max(maxY, y[i]);
+    }
+
+    // The pixels whose centers can be inside, clipped to the screen.
+    pSetup->MinX = static_cast<int32_t>(::std::max<int64_t>(minX >> SubPixelBits, 0));
+    pSetup->MinY = static_cast<int32_t>(::std::max<int64_t>(minY >> SubPixelBits, 0));
+    pSetup->MaxX = static_cast<int32_t>(::std::min<int64_t>(maxX >> SubPixelBits, m_Width));
+    pSetup->MaxY = static_cast<int32_t>(::std::min<int64_t>(maxY >> SubPixelBits, m_Height));
+    pSetup->Color = drawData.Color;
+    pSetup->Depth = drawData.Depth;
+
+    return pSetup->MinX < pSetup->MaxX && pSetup->MinY < pSetup->MaxY;
+}
+
+void DefaultPetRenderer::RasterizeTriangleTile(const TriangleSetup& setup, const int32_t tileX, const int32_t tileY) noexcept
+{
+    const int32_t startX = ::std::max(tileX * TileSize, setup.MinX);
+    const int32_t startY = ::std::max(tileY * TileSize, setup.MinY);
+    const int32_t endX = ::std::min(tileX * TileSize + TileSize, setup.MaxX);
+    const int32_t endY = ::std::min(tileY * TileSize + TileSize, setup.MaxY);
+
+    if(startX >= endX || startY >= endY)
+    {
+        return;
+    }
+
+    if(IsTileHidden(tileX, tileY, setup.Depth))
+    {
+        return;
+    }
+
+    //   The edge functions are linear, so checking the corner pixels tells
+    // us whether the tile is completely outside an edge, or completely
+    // inside all three.
+    bool acceptTile = true;
+
+    for(const TriangleEdge& edge : setup.Edges)
+    {
+        const int64_t e00 = edge.At(startX, startY);
+        const int64_t e10 = edge.At(endX - 1, startY);
+        const int64_t e01 = edge.At(startX, endY - 1);
+        const int64_t e11 = edge.At(endX - 1, endY - 1);
+
+        if(e00 < 0 && e10 < 0 && e01 < 0 && e11 < 0)
         {
-            if(points[0].Y < points[2].Y) // y_1 < y_0 < y_2
-            {
-                return 0x102;
-            }
-            else if(points[2].Y < points[0].Y) // y_1 < y_2 < y_0
-            {
-                return 0x120;
-            }
-            else // y_1 < y_0 == y_2
-            {
-                if(points[0].X < points[2].X) // y_1 < y_0 == y_2 && x_0 < x_2
-                {
-                    return 0x102;
-                }
-                else // y_1 < y_0 == y_2 && x_2 <= x_0
-                {
-                    return 0x120;
-                }
-            }
+            return;
         }
-        else if(points[2].Y < points[1].Y) // y_2 < y_1 < y_0
+
+        acceptTile &= e00 >= 0 && e10 >= 0 && e01 >= 0 && e11 >= 0;
+    }
+
+    if(acceptTile)
+    {
+        for(int32_t y = startY; y < endY; ++y)
         {
-            return 0x021;
+            FillSpan(y, startX, endX, setup.Color, setup.Depth);
         }
-        else // y_2 == y_1 < y_0
+
+        CoverTile(tileX, tileY, startX, startY, endX, endY, setup.Depth);
+        return;
+    }
+
+    for(int32_t y = startY; y < endY; ++y)
+    {
+        int64_t e0 = setup.Edges[0].At(startX, y);
+        int64_t e1 = setup.Edges[1].At(startX, y);
+        int64_t e2 = setup.Edges[2].At(startX, y);
+
+        int32_t spanStart = endX;
+        int32_t spanEnd = endX;
+
+        // A row of a triangle is a single span, find where it starts and ends.
+        for(int32_t x = startX; x < endX; ++x)
         {
-            if(points[2].X < points[1].X) // y_2 == y_1 < y_0 && x_2 < x_1
+            const bool inside = (e0 | e1 | e2) >= 0;
+
+            if(inside && spanStart == endX)
             {
-                return 0x210;
+                spanStart = x;
             }
-            else // y_2 == y_1 < y_0 && x_1 <= x_2
+            else if(!inside && spanStart != endX)
             {
-                return 0x120;
+                spanEnd = x;
+                break;
             }
+
+            e0 += setup.Edges[0].StepX;
+            e1 += setup.Edges[1].StepX;
+            e2 += setup.Edges[2].StepX;
+        }
+
+        FillSpan(y, spanStart, spanEnd, setup.Color, setup.Depth);
+    }
+}
+
+PetStatus DefaultPetRenderer::DrawTriangle(const DrawTriangleData* pDrawData) noexcept
+{
+    if(!pDrawData)
+    {
+        return PetInvalidArg;
+    }
+
+    if(m_Recording || IsTiled())
+    {
+        PetDrawCommand command { };
+        command.Type = PetDrawCommandTriangle;
+        command.Data.Triangle = *pDrawData;
+        return RecordCommand(command);
+    }
+
+    RasterizeTriangle(*pDrawData);
+
+    return PetSuccess;
+}
+
+void DefaultPetRenderer::RasterizeTriangle(const DrawTriangleData& drawData) noexcept
+{
+    TriangleSetup setup;
+
+    if(!SetupTriangle(drawData, &setup))
+    {
+        return;
+    }
+
+    MarkDirty(setup.MinX, setup.MinY, setup.MaxX, setup.MaxY);
+    RasterizeTriangleArea(setup, 0, 0, m_Width, m_Height);
+}
+
+void DefaultPetRenderer::RasterizeTriangleArea(const TriangleSetup& setup, int32_t startX, int32_t startY, int32_t endX, int32_t endY) noexcept
+{
+    startX = ::std::max(startX, setup.MinX);
+    startY = ::std::max(startY, setup.MinY);
+    endX = ::std::min(endX, setup.MaxX);
+    endY = ::std::min(endY, setup.MaxY);
+
+    if(startX >= endX || startY >= endY)
+    {
+        return;
+    }
+
+    // Tiles don't share any pixels, so they could be rasterized in any order.
+    for(int32_t tileY = startY / TileSize; tileY <= (endY - 1) / TileSize; ++tileY)
+    {
+        for(int32_t tileX = startX / TileSize; tileX <= (endX - 1) / TileSize; ++tileX)
+        {
+            RasterizeTriangleTile(setup, tileX, tileY);
         }
     }
-    else // y_0 == y_1
+}
+
+PetStatus DefaultPetRenderer::BeginDrawCommands() noexcept
+{
+    if(m_Recording)
+    {
+        return PetFail;
+    }
+
+    FlushPending();
+
+    m_Recording = true;
+    m_HasRecordedClear = false;
+    m_Commands.clear();
+
+    return PetSuccess;
+}
+
+PetStatus DefaultPetRenderer::SubmitDrawCommands(const PetDrawCommand* const pCommands, const uint32_t commandCount) noexcept
+{
+    if(!pCommands && commandCount != 0)
+    {
+        return PetInvalidArg;
+    }
+
+    // The batch is sorted on its own, so anything held back goes first.
+    FlushPending();
+
+    m_Commands.reserve(m_Commands.size() + commandCount);
+
+    for(uint32_t i = 0; i < commandCount; ++i)
     {
-        if(points[0].Y < points[2].Y) // y_0 == y_1 < y_2
+        const PetStatus status = RecordCommand(pCommands[i]);
+
+        if(!IsStatusSuccess(status))
         {
-            if(points[0].X < points[1].X) // y_0 == y_1 < y_2 && x_0 < x_1
+            // Don't leave half of the batch recorded.
+            m_Commands.resize(m_Commands.size() - i);
+            return status;
+        }
+    }
+
+    if(!m_Recording)
+    {
+        FlushCommands(true);
+    }
+
+    return PetSuccess;
+}
+
+PetStatus DefaultPetRenderer::EndDrawCommands() noexcept
+{
+    if(!m_Recording)
+    {
+        return PetFail;
+    }
+
+    m_Recording = false;
+    FlushCommands(true);
+
+    return PetSuccess;
+}
+
+PetStatus DefaultPetRenderer::RecordCommand(const PetDrawCommand& command) noexcept
+{
+    DrawCommand drawCommand { };
+    drawCommand.Command = command;
+
+    switch(command.Type)
+    {
+        case PetDrawCommandRectangle:
+        {
+            const ScreenPoint* const points = command.Data.Rectangle.Points;
+            drawCommand.MinX = ::std::min(points[0].X, points[1].X);
+            drawCommand.MinY = ::std::min(points[0].Y, points[1].Y);
+            drawCommand.MaxX = ::std::max(points[0].X, points[1].X);
+            drawCommand.MaxY = ::std::max(points[0].Y, points[1].Y);
+            break;
+        }
+        case PetDrawCommandTriangle:
+        {
+            // Vertices are pixel corners, so the bounds are the same as a rectangle's.
+            const ScreenPoint* const points = command.Data.Triangle.Points;
+            drawCommand.MinX = ::std::min({ points[0].X, points[1].X, points[2].X });
+            drawCommand.MinY = ::std::min({ points[0].Y, points[1].Y, points[2].Y });
+            drawCommand.MaxX = ::std::max({ points[0].X, points[1].X, points[2].X });
+            drawCommand.MaxY = ::std::max({ points[0].Y, points[1].Y, points[2].Y });
+            break;
+        }
+        default: return PetInvalidArg;
+    }
+
+    drawCommand.MaxX = ::std::min(drawCommand.MaxX, static_cast<int32_t>(m_Width));
+    drawCommand.MaxY = ::std::min(drawCommand.MaxY, static_cast<int32_t>(m_Height));
+
+    m_Commands.push_back(drawCommand);
+
+    return PetSuccess;
+}
+
+void DefaultPetRenderer::FlushCommands(const bool sortByDepth) noexcept
+{
+    m_SortKeys.clear();
+    m_SortKeys.reserve(m_Commands.size());
+
+    if(!sortByDepth)
+    {
+        for(size_t i = 0; i < m_Commands.size(); ++i)
+        {
+            m_SortKeys.push_back(static_cast<uint64_t>(i));
+        }
+    }
+    else
+    {
+        for(size_t i = 0; i < m_Commands.size(); ++i)
+        {
+            const PetDrawCommand& command = m_Commands[i].Command;
+            const uint16_t depth = command.Type == PetDrawCommandRectangle ? command.Data.Rectangle.Depth : command.Data.Triangle.Depth;
+            m_SortKeys.push_back((static_cast<uint64_t>(depth) << 32) | static_cast<uint64_t>(i));
+        }
+
+        // Back to front.
+        ::std::sort(m_SortKeys.begin(), m_SortKeys.end());
+    }
+
+    //   Walk front to back, collecting the largest rectangles seen so far,
+    // anything that fits entirely inside one of them would be drawn over.
+    const DrawCommand* occluders[MaxOccluders];
+    int64_t occluderAreas[MaxOccluders];
+    uint32_t occluderCount = 0;
+
+    //   A depth buffer lets a later draw be behind an earlier one, so only
+    // draws in depth order can be culled this way.
+    const size_t cullCount = sortByDepth ? m_SortKeys.size() : 0;
+
+    if(sortByDepth)
+    {
+        m_CulledCount = 0;
+    }
+
+    for(size_t i = cullCount; i-- > 0;)
+    {
+        const DrawCommand& command = m_Commands[static_cast<uint32_t>(m_SortKeys[i])];
+
+        bool hidden = command.MinX >= command.MaxX || command.MinY >= command.MaxY;
+
+        for(uint32_t j = 0; j < occluderCount && !hidden; ++j)
+        {
+            const DrawCommand& occluder = *occluders[j];
+            hidden = occluder.MinX <= command.MinX && occluder.MinY <= command.MinY && command.MaxX <= occluder.MaxX && command.MaxY <= occluder.MaxY;
+        }
+
+        if(hidden)
+        {
+            m_SortKeys[i] = CulledKey;
+            ++m_CulledCount;
+            continue;
+        }
+
+        if(command.Command.Type != PetDrawCommandRectangle)
+        {
+            continue;
+        }
+
+        const int64_t area = static_cast<int64_t>(command.MaxX - command.MinX) * static_cast<int64_t>(command.MaxY - command.MinY);
+
+        if(occluderCount < MaxOccluders)
+        {
+            occluders[occluderCount] = &command;
+            occluderAreas[occluderCount] = area;
+            ++occluderCount;
+            continue;
+        }
+
+        uint32_t smallest = 0;
+
+        for(uint32_t j = 1; j < MaxOccluders; ++j)
+        {
+            if(occluderAreas[j] < occluderAreas[smallest])
             {
-                return 0x012;
+                smallest = j;
             }
-            else // y_0 == y_1 < y_2 && x_1 < x_0
+        }
+
+        if(area > occluderAreas[smallest])
+        {
+            occluders[smallest] = &command;
+            occluderAreas[smallest] = area;
+        }
+    }
+
+    if(IsTiled())
+    {
+        RasterizeTiled();
+        m_HasRecordedClear = false;
+        m_Commands.clear();
+        return;
+    }
+
+    if(m_HasRecordedClear)
+    {
+        RasterizeClear(m_RecordedClear.Color, m_RecordedClear.Depth);
+        m_HasRecordedClear = false;
+    }
+
+    for(const uint64_t key : m_SortKeys)
+    {
+        if(key == CulledKey)
+        {
+            continue;
+        }
+
+        const PetDrawCommand& command = m_Commands[static_cast<uint32_t>(key)].Command;
+
+        if(command.Type == PetDrawCommandRectangle)
+        {
+            RasterizeRectangle(command.Data.Rectangle);
+        }
+        else
+        {
+            RasterizeTriangle(command.Data.Triangle);
+        }
+    }
+
+    m_Commands.clear();
+}
+
+void DefaultPetRenderer::FlushPending() noexcept
+{
+    if(m_Recording || (!m_HasRecordedClear && m_Commands.empty()))
+    {
+        return;
+    }
+
+    FlushCommands(false);
+}
+
+void DefaultPetRenderer::RasterizeTiled() noexcept
+{
+    //   The dirty rects are tracked here rather than on the workers, in
+    // the same order the serial path would, so they come out the same.
+    if(m_HasRecordedClear)
+    {
+        m_DirtyRectCount = 0;
+        MarkDirty(0, 0, m_Width, m_Height);
+    }
+
+    m_TriangleSetups.resize(m_Commands.size());
+
+    const int32_t binCountY = (m_Height + BinSize - 1) / BinSize;
+    const size_t binCount = static_cast<size_t>(m_BinCountX) * static_cast<size_t>(binCountY);
+
+    m_BinOffsets.assign(binCount + 1, 0);
+
+    for(uint64_t& key : m_SortKeys)
+    {
+        if(key == CulledKey)
+        {
+            continue;
+        }
+
+        const uint32_t index = static_cast<uint32_t>(key);
+        DrawCommand& command = m_Commands[index];
+
+        if(command.Command.Type == PetDrawCommandTriangle)
+        {
+            TriangleSetup& setup = m_TriangleSetups[index];
+
+            if(!SetupTriangle(command.Command.Data.Triangle, &setup))
             {
-                return 0x102;
+                key = CulledKey;
+                continue;
             }
+
+            // The setup's bounds are tighter, and already clipped.
+            command.MinX = setup.MinX;
+            command.MinY = setup.MinY;
+            command.MaxX = setup.MaxX;
+            command.MaxY = setup.MaxY;
+        }
+
+        MarkDirty(command.MinX, command.MinY, command.MaxX, command.MaxY);
+
+        if(command.MinX >= command.MaxX || command.MinY >= command.MaxY)
+        {
+            key = CulledKey;
+            continue;
         }
-        else if(points[2].Y < points[0].Y) // y_2 < y_0 == y_1
+
+        for(int32_t binY = command.MinY / BinSize; binY <= (command.MaxY - 1) / BinSize; ++binY)
         {
-            if(points[0].X < points[1].X) // y_2 < y_0 == y_1 && x_0 < x_1
+            for(int32_t binX = command.MinX / BinSize; binX <= (command.MaxX - 1) / BinSize; ++binX)
             {
-                return 0x201;
+                ++m_BinOffsets[static_cast<size_t>(binY) * static_cast<size_t>(m_BinCountX) + static_cast<size_t>(binX) + 1];
             }
-            else // y_2 < y_0 == y_1 && x_1 < x_0
+        }
+    }
+
+    for(size_t i = 0; i < binCount; ++i)
+    {
+        m_BinOffsets[i + 1] += m_BinOffsets[i];
+    }
+
+    m_BinCommands.resize(m_BinOffsets[binCount]);
+
+    //   Fill each bin from the back, walking the commands backwards, which
+    // leaves m_BinOffsets[i] pointing at the start of bin i again.
+    for(size_t i = m_SortKeys.size(); i-- > 0;)
+    {
+        const uint64_t key = m_SortKeys[i];
+
+        if(key == CulledKey)
+        {
+            continue;
+        }
+
+        const uint32_t index = static_cast<uint32_t>(key);
+        const DrawCommand& command = m_Commands[index];
+
+        for(int32_t binY = command.MinY / BinSize; binY <= (command.MaxY - 1) / BinSize; ++binY)
+        {
+            for(int32_t binX = command.MinX / BinSize; binX <= (command.MaxX - 1) / BinSize; ++binX)
             {
-                return 0x210;
+                const size_t bin = static_cast<size_t>(binY) * static_cast<size_t>(m_BinCountX) + static_cast<size_t>(binX);
+                m_BinCommands[--m_BinOffsets[bin + 1]] = index;
             }
         }
-        else // y_0 == y_1 == y_2
+    }
+
+    // Now m_BinOffsets[i + 1] is the start of bin i, shift them back down.
+    for(size_t i = 0; i < binCount; ++i)
+    {
+        m_BinOffsets[i] = m_BinOffsets[i + 1];
+    }
+
+    m_BinOffsets[binCount] = static_cast<uint32_t>(m_BinCommands.size());
+
+    m_Workers.ParallelFor(static_cast<uint32_t>(binCount), 1, WorkerPool::TaskFunc::Bind<&DefaultPetRenderer::RasterizeBins>(this));
+}
+
+void DefaultPetRenderer::RasterizeBins([[maybe_unused]] const uint32_t workerIndex, const uint32_t begin, const uint32_t end) noexcept
+{
+    for(uint32_t bin = begin; bin < end; ++bin)
+    {
+        const int32_t startX = static_cast<int32_t>(bin % static_cast<uint32_t>(m_BinCountX)) * BinSize;
+        const int32_t startY = static_cast<int32_t>(bin / static_cast<uint32_t>(m_BinCountX)) * BinSize;
+        const int32_t endX = ::std::min(startX + BinSize, static_cast<int32_t>(m_Width));
+        const int32_t endY = ::std::min(startY + BinSize, static_cast<int32_t>(m_Height));
+
+        if(m_HasRecordedClear)
+        {
+            ClearArea(m_RecordedClear.Color, m_RecordedClear.Depth, startX, startY, endX, endY);
+        }
+
+        for(uint32_t i = m_BinOffsets[bin]; i < m_BinOffsets[bin + 1]; ++i)
         {
-            if(points[0].X < points[1].X) // y_0 == y_1 == y_2 && x_0 < x_1
+            const uint32_t index = m_BinCommands[i];
+            const PetDrawCommand& command = m_Commands[index].Command;
+
+            if(command.Type == PetDrawCommandRectangle)
             {
-                if(points[0].X < points[2].X) // y_0 == y_1 == y_2 && x_0 < x_1 && x_0 < x_2
-                {
-                    if(points[1].X < points[2].X) // y_0 == y_1 == y_2 && x_0 < x_1 < x_2
-                    {
-                        return 0x012;
-                    }
-                    else // y_0 == y_1 == y_2 && x_0 < x_2 <= x_1
-                    {
-                        return 0x021;
-                    }
-                }
-                else // y_0 == y_1 == y_2 && x_2 <= x_0 < x_1
-                {
-                    return 0x201;
-                }
+                RasterizeRectangleArea(command.Data.Rectangle, startX, startY, endX, endY);
             }
-            else if(points[1].X < points[0].X) // y_0 == y_1 == y_2 && x_1 < x_0
+            else
             {
-                if(points[1].X < points[2].X) // y_0 == y_1 == y_2 && x_1 < x_0 && x_1 < x_2
-                {
-                    if(points[2].X < points[0].X) // y_0 == y_1 == y_2 && x_1 < x_2 < x_0
-                    {
-                        return 0x120;
-                    }
-                    else // y_0 == y_1 == y_2 && x_1 < x_0 <= x_2
-                    {
-                        return 0x102;
-                    }
-                }
-                else // y_0 == y_1 == y_2 && x_1 < x_0 && x_2 <= x_1
-                {
-                    if(points[1].X < points[0].X) // y_0 == y_1 == y_2 && x_2 <= x_1 < x_0
-                    {
-                        return 0x210;
-                    }
-                    else // y_0 == y_1 == y_2 && x_2 <= x_0 <= x_1
-                    {
-                        return 0x201;
-                    }
-                }
+                RasterizeTriangleArea(m_TriangleSetups[index], startX, startY, endX, endY);
             }
         }
     }
+}
 
-    assert(false);
-    return 0xFFFF;
+PetStatus DefaultPetRenderer::CopyFramebuffer(uint8_t* const pOutFramebuffer, const size_t size) noexcept
+{
+    if(!pOutFramebuffer)
+    {
+        return PetInvalidArg;
+    }
+
+    if(size < FramebufferSize())
+    {
+        return PetInvalidArg;
+    }
+
+    // Join the workers before anyone looks at the pixels.
+    FlushPending();
+
+    (void) ::memcpy(pOutFramebuffer, m_Framebuffer, FramebufferSize());
+
+    return PetSuccess;
 }
 
-PetStatus DefaultPetRenderer::DrawTriangle(const DrawTriangleData* pDrawData) noexcept
+PetStatus DefaultPetRenderer::CopyDirtyFramebuffer(uint8_t* const pOutFramebuffer, const size_t size, ScreenRect* const pOutRects, uint32_t* const pRectCount) noexcept
 {
-    const uint16_t points = PickPoint(pDrawData->Points);
+    if(!pOutFramebuffer)
+    {
+        return PetInvalidArg;
+    }
 
-    if(points == 0xFFFF)
+    if(size < FramebufferSize())
     {
-        return PetFail;
+        return PetInvalidArg;
     }
 
-    const ScreenPoint& p0 = pDrawData->Points[points >> 8];
-    const ScreenPoint& p1 = pDrawData->Points[(points >> 4) & 0x0F];
-    const ScreenPoint& p2 = pDrawData->Points[points & 0x0F];
+    FlushPending();
 
-    const ScreenPoint& xp1 = p1.X < p2.X ? p1 : p2;
-    const ScreenPoint& xp2 = p1.X < p2.X ? p2 : p1;
+    const uint32_t rectCapacity = pOutRects && pRectCount ? *pRectCount : 0;
 
-    const ScreenPoint& xp20 = p0.X < p1.X ? p0 : p1;
-    const ScreenPoint& xp21 = p0.X < p1.X ? p1 : p0;
+    if(pRectCount)
+    {
+        *pRectCount = 0;
+    }
 
-    const int32_t t01Rise = (xp1.Y - p0.Y);
-    const int32_t t01Run = (xp1.X - p0.X);
-    const int32_t t02Rise = (xp2.Y - p0.Y);
-    const int32_t t02Run = (xp2.X - p0.X);
+    if(m_DirtyRectCount == 0)
+    {
+        return PetNoMoreItems;
+    }
 
-    const int32_t t20Rise = (xp20.Y - p2.Y);
-    const int32_t t20Run = (xp20.X - p2.X);
-    const int32_t t21Rise = (xp21.Y - p2.Y);
-    const int32_t t21Run = (xp21.X - p2.X);
+    CopyDirtyRects(pOutFramebuffer);
 
-    // Split the triangle horizontally at the height of p1.
-    //   This forms a triangle with a horizontal bottom made up of p0, p1,
-    // and a point on the line between p0 and p2.
-    for(uint16_t y = p0.Y; y < p1.Y; ++y)
+    if(rectCapacity != 0)
     {
-        // y - h = m(x - k)
-        // x = (y - h)/m + k
-        const int32_t startX = (y - p0.Y) * t01Run / t01Rise + p0.X;
-        const int32_t endX   = (y - p0.Y) * t02Run / t02Rise + p0.X;
+        const uint32_t rectCount = ::std::min(m_DirtyRectCount, rectCapacity);
+        (void) ::std::memcpy(pOutRects, m_DirtyRects, rectCount * sizeof(ScreenRect));
+
+        // Fold whatever doesn't fit into the last rect.
+        ScreenRect& last = pOutRects[rectCount - 1];
 
-        //   Using the slope of the two lines that make up the triangle, we'll
-        // find the x-coordinate from the y-coordinate, and then fill the
-        // points between.
-        for(uint16_t x = startX; x < endX; ++x)
+        for(uint32_t i = rectCount; i < m_DirtyRectCount; ++i)
         {
-            const size_t i = (static_cast<size_t>(m_Width) * static_cast<size_t>(y) + static_cast<size_t>(x)) * 3;
-            m_Framebuffer[i + 0] = pDrawData->Color.R;
-            m_Framebuffer[i + 1] = pDrawData->Color.G;
-            m_Framebuffer[i + 2] = pDrawData->Color.B;
+            const ScreenRect& rect = m_DirtyRects[i];
+            const int32_t startX = ::std::min<int32_t>(last.X, rect.X);
+            const int32_t startY = ::std::min<int32_t>(last.Y, rect.Y);
+            const int32_t endX = ::std::max<int32_t>(last.X + last.Width, rect.X + rect.Width);
+            const int32_t endY = ::std::max<int32_t>(last.Y + last.Height, rect.Y + rect.Height);
+
+            last = { static_cast<uint16_t>(startX), static_cast<uint16_t>(startY), static_cast<uint16_t>(endX - startX), static_cast<uint16_t>(endY - startY) };
         }
+
+        *pRectCount = rectCount;
+    }
+
+    m_DirtyRectCount = 0;
+
+    return PetSuccess;
+}
+
+PetStatus DefaultPetRenderer::LockFramebuffer(PetFramebufferLock* const pLock) noexcept
+{
+    if(!pLock)
+    {
+        return PetInvalidArg;
     }
 
-    // Rasterize the second half of the triangle.
-    //   This forms a triangle with a horizontal top made up of p2, p1,
-    // and a point on the line between p0 and p2.
-    for(uint16_t y = p1.Y; y <= p2.Y; ++y)
+    if(m_Locked)
     {
-        // y - h = m(x - k)
-        // x = (y - h)/m + k
-        const int32_t startX = (y - p2.Y) * t20Run / t20Rise + p2.X;
-        const int32_t endX   = (y - p2.Y) * t21Run / t21Rise + p2.X;
+        return PetFail;
+    }
+
+    FlushPending();
+
+    if(!m_FrontBuffer)
+    {
+        m_FrontBuffer = new(::std::nothrow) uint8_t[FramebufferSize()];
 
-        //   Using the slope of the two lines that make up the triangle, we'll
-        // find the x-coordinate from the y-coordinate, and then fill the
-        // points between.
-        for(uint16_t x = startX; x < endX; ++x)
+        if(!m_FrontBuffer)
         {
-            const size_t i = (static_cast<size_t>(m_Width) * static_cast<size_t>(y) + static_cast<size_t>(x)) * 3;
-            m_Framebuffer[i + 0] = pDrawData->Color.R;
-            m_Framebuffer[i + 1] = pDrawData->Color.G;
-            m_Framebuffer[i + 2] = pDrawData->Color.B;
+            return PetOutOfMemory;
         }
+
+        // CopyDirtyFramebuffer may have already taken some of the dirty rects.
+        m_DirtyRectCount = 0;
+        MarkDirty(0, 0, m_Width, m_Height);
     }
 
+    pLock->Changed = m_DirtyRectCount != 0;
+
+    CopyDirtyRects(m_FrontBuffer);
+    m_DirtyRectCount = 0;
+
+    pLock->pPixels = m_FrontBuffer;
+    pLock->Stride = static_cast<uint32_t>(m_Width) * 3;
+    pLock->Format = PetPixelFormatRGB24;
+    pLock->Width = m_Width;
+    pLock->Height = m_Height;
+
+    m_Locked = true;
+
     return PetSuccess;
 }
 
-PetStatus DefaultPetRenderer::CopyFramebuffer(uint8_t* const pOutFramebuffer, const size_t size) const noexcept
+PetStatus DefaultPetRenderer::UnlockFramebuffer() noexcept
 {
-    if(!pOutFramebuffer)
+    if(!m_Locked)
     {
-        return PetInvalidArg;
+        return PetFail;
     }
 
-    if(size < FramebufferSize())
+    m_Locked = false;
+
+    return PetSuccess;
+}
+
+void DefaultPetRenderer::CopyDirtyRects(uint8_t* const pOutFramebuffer) noexcept
+{
+    const size_t rowSize = static_cast<size_t>(m_Width) * 3;
+
+    for(uint32_t i = 0; i < m_DirtyRectCount; ++i)
     {
-        return PetInvalidArg;
+        const ScreenRect& rect = m_DirtyRects[i];
+        const size_t offset = static_cast<size_t>(rect.Y) * rowSize + static_cast<size_t>(rect.X) * 3;
+
+        // Full rows are contiguous.
+        if(rect.Width == m_Width)
+        {
+            (void) ::std::memcpy(pOutFramebuffer + offset, m_Framebuffer + offset, static_cast<size_t>(rect.Height) * rowSize);
+            continue;
+        }
+
+        for(size_t y = 0; y < rect.Height; ++y)
+        {
+            (void) ::std::memcpy(pOutFramebuffer + offset + y * rowSize, m_Framebuffer + offset + y * rowSize, static_cast<size_t>(rect.Width) * 3);
+        }
     }
+}
 
-    (void) ::memcpy(pOutFramebuffer, m_Framebuffer, FramebufferSize());
+void DefaultPetRenderer::FillSpan(const int32_t y, int32_t startX, int32_t endX, const RGBColor& color, const uint16_t depth) noexcept
+{
+    if(y < 0 || y >= m_Height)
+    {
+        return;
+    }
 
-    return PetSuccess;
+    if(startX < 0)
+    {
+        startX = 0;
+    }
+
+    if(endX > m_Width)
+    {
+        endX = m_Width;
+    }
+
+    if(startX >= endX)
+    {
+        return;
+    }
+
+    const size_t pixel = static_cast<size_t>(m_Width) * static_cast<size_t>(y) + static_cast<size_t>(startX);
+
+    if(m_DepthBuffer)
+    {
+        SpanFill::FillRgbDepth(m_Framebuffer + pixel * 3, m_DepthBuffer + pixel, static_cast<size_t>(endX - startX), depth, color.R, color.G, color.B);
+        return;
+    }
+
+    SpanFill::FillRgb(m_Framebuffer + pixel * 3, static_cast<size_t>(endX - startX), color.R, color.G, color.B);
+}
+
+bool DefaultPetRenderer::IsTileHidden(const int32_t tileX, const int32_t tileY, const uint16_t depth) const noexcept
+{
+    return m_DepthBuffer && depth < m_TileDepths[static_cast<size_t>(tileY) * static_cast<size_t>(m_TileCountX) + static_cast<size_t>(tileX)];
+}
+
+void DefaultPetRenderer::CoverTile(const int32_t tileX, const int32_t tileY, const int32_t startX, const int32_t startY, const int32_t endX, const int32_t endY, const uint16_t depth) noexcept
+{
+    if(!m_DepthBuffer)
+    {
+        return;
+    }
+
+    // Tiles on the right and bottom edges are cut short by the screen.
+    const bool wholeTile =
+        startX == tileX * TileSize && endX == ::std::min(tileX * TileSize + TileSize, static_cast<int32_t>(m_Width)) &&
+        startY == tileY * TileSize && endY == ::std::min(tileY * TileSize + TileSize, static_cast<int32_t>(m_Height));
+
+    if(!wholeTile)
+    {
+        return;
+    }
+
+    uint16_t& tileDepth = m_TileDepths[static_cast<size_t>(tileY) * static_cast<size_t>(m_TileCountX) + static_cast<size_t>(tileX)];
+    tileDepth = ::std::max(tileDepth, depth);
+}
+
+void DefaultPetRenderer::MarkDirty(int32_t startX, int32_t startY, int32_t endX, int32_t endY) noexcept
+{
+    startX = ::std::max(startX, 0);
+    startY = ::std::max(startY, 0);
+    endX = ::std::min(endX, static_cast<int32_t>(m_Width));
+    endY = ::std::min(endY, static_cast<int32_t>(m_Height));
+
+    if(startX >= endX || startY >= endY)
+    {
+        return;
+    }
+
+    const auto rectArea = [](const int32_t x0, const int32_t y0, const int32_t x1, const int32_t y1) noexcept
+    {
+        return static_cast<int64_t>(x1 - x0) * static_cast<int64_t>(y1 - y0);
+    };
+
+    uint32_t bestIndex = MaxDirtyRects;
+    int64_t bestGrowth = 0;
+
+    for(uint32_t i = 0; i < m_DirtyRectCount; ++i)
+    {
+        const ScreenRect& rect = m_DirtyRects[i];
+        const int32_t rectEndX = rect.X + rect.Width;
+        const int32_t rectEndY = rect.Y + rect.Height;
+
+        const int32_t unionStartX = ::std::min<int32_t>(startX, rect.X);
+        const int32_t unionStartY = ::std::min<int32_t>(startY, rect.Y);
+        const int32_t unionEndX = ::std::max(endX, rectEndX);
+        const int32_t unionEndY = ::std::max(endY, rectEndY);
+
+        const bool touches = startX <= rectEndX && rect.X <= endX && startY <= rectEndY && rect.Y <= endY;
+        const int64_t growth = rectArea(unionStartX, unionStartY, unionEndX, unionEndY) - rectArea(rect.X, rect.Y, rectEndX, rectEndY);
+
+        // Draws usually land on or next to something that was already drawn, grow that.
+        if(touches || growth == 0)
+        {
+            bestIndex = i;
+            break;
+        }
+
+        if(m_DirtyRectCount == MaxDirtyRects && (bestIndex == MaxDirtyRects || growth < bestGrowth))
+        {
+            bestIndex = i;
+            bestGrowth = growth;
+        }
+    }
+
+    if(bestIndex == MaxDirtyRects)
+    {
+        m_DirtyRects[m_DirtyRectCount++] = { static_cast<uint16_t>(startX), static_cast<uint16_t>(startY), static_cast<uint16_t>(endX - startX), static_cast<uint16_t>(endY - startY) };
+        return;
+    }
+
+    ScreenRect& rect = m_DirtyRects[bestIndex];
+    const int32_t unionStartX = ::std::min<int32_t>(startX, rect.X);
+    const int32_t unionStartY = ::std::min<int32_t>(startY, rect.Y);
+    const int32_t unionEndX = ::std::max<int32_t>(endX, rect.X + rect.Width);
+    const int32_t unionEndY = ::std::max<int32_t>(endY, rect.Y + rect.Height);
+
+    rect = { static_cast<uint16_t>(unionStartX), static_cast<uint16_t>(unionStartY), static_cast<uint16_t>(unionEndX - unionStartX), static_cast<uint16_t>(unionEndY - unionStartY) };
 }
 
 PetStatus DefaultPetRenderer::CreateDefaultRenderer(const CreateDefaultPetRenderer* const pCreateDefaultRenderer) noexcept
@@ -358,25 +1057,62 @@ PetStatus DefaultPetRenderer::CreateDefaultRenderer(const CreateDefaultPetRender
         return PetInvalidArg;
     }
 
-    uint8_t* const framebuffer = new(::std::nothrow) uint8_t[pCreateDefaultRenderer->Width * pCreateDefaultRenderer->Height * 3];
+    const uint16_t width = pCreateDefaultRenderer->Width;
+    const uint16_t height = pCreateDefaultRenderer->Height;
+
+    // Older callers don't have the flags.
+    const uint32_t flags = pCreateDefaultRenderer->Version >= PET_RENDERER_VERSION_1_3 ? pCreateDefaultRenderer->Flags : static_cast<uint32_t>(PetRendererFlagNone);
+    const uint32_t threadCount = pCreateDefaultRenderer->Version >= PET_RENDERER_VERSION_1_4 ? pCreateDefaultRenderer->ThreadCount : 0;
+
+    uint8_t* const framebuffer = new(::std::nothrow) uint8_t[FramebufferSize(width, height)];
 
     if(!framebuffer)
     {
         return PetOutOfMemory;
     }
 
+    uint16_t* depthBuffer = nullptr;
+    uint16_t* tileDepths = nullptr;
+
+    if(flags & PetRendererFlagDepthBuffer)
+    {
+        depthBuffer = new(::std::nothrow) uint16_t[static_cast<size_t>(width) * static_cast<size_t>(height)];
+        tileDepths = new(::std::nothrow) uint16_t[TileCount(width, height)];
+
+        if(!depthBuffer || !tileDepths)
+        {
+            delete[] framebuffer;
+            delete[] depthBuffer;
+            delete[] tileDepths;
+            return PetOutOfMemory;
+        }
+    }
+
     DefaultPetRenderer* renderer = new(::std::nothrow) DefaultPetRenderer(
-        pCreateDefaultRenderer->Width,
-        pCreateDefaultRenderer->Height,
-        framebuffer
+        width,
+        height,
+        framebuffer,
+        depthBuffer,
+        tileDepths
     );
 
     if(!renderer)
     {
         delete[] framebuffer;
+        delete[] depthBuffer;
+        delete[] tileDepths;
         return PetOutOfMemory;
     }
 
+    const PetStatus status = renderer->m_Workers.Start(threadCount);
+
+    if(IsStatusError(status))
+    {
+        DebugPrintF(u8"[DefaultPetRenderer::CreateDefaultRenderer]: m_Workers.Start returned status 0x%08X.\n", status);
+        delete renderer;
+        return status;
+    }
+
     pCreateDefaultRenderer->pOutRendererHandle->Ptr = renderer;
 
     pCreateDefaultRenderer->pOutRendererFunctions->GetScreenSize = ::GetScreenSize;
@@ -385,6 +1121,27 @@ PetStatus DefaultPetRenderer::CreateDefaultRenderer(const CreateDefaultPetRender
     pCreateDefaultRenderer->pOutRendererFunctions->DrawTriangle = ::DrawTriangle;
     pCreateDefaultRenderer->pOutRendererFunctions->CopyFramebuffer = ::CopyFramebuffer;
 
+    // Older callers don't have room for the newer functions.
+    if(pCreateDefaultRenderer->Version >= PET_RENDERER_VERSION_1_1)
+    {
+        pCreateDefaultRenderer->pOutRendererFunctions->CopyDirtyFramebuffer = ::CopyDirtyFramebuffer;
+    }
+
+    if(pCreateDefaultRenderer->Version >= PET_RENDERER_VERSION_1_2)
+    {
+        pCreateDefaultRenderer->pOutRendererFunctions->BeginDrawCommands = ::BeginDrawCommands;
+        pCreateDefaultRenderer->pOutRendererFunctions->SubmitDrawCommands = ::SubmitDrawCommands;
+        pCreateDefaultRenderer->pOutRendererFunctions->EndDrawCommands = ::EndDrawCommands;
+    }
+
+    if(pCreateDefaultRenderer->Version >= PET_RENDERER_VERSION_1_5)
+    {
+        pCreateDefaultRenderer->pOutRendererFunctions->LockFramebuffer = ::LockFramebuffer;
+        pCreateDefaultRenderer->pOutRendererFunctions->UnlockFramebuffer = ::UnlockFramebuffer;
+    }
+
+    pCreateDefaultRenderer->pOutRendererFunctions->Version = pCreateDefaultRenderer->Version < PET_RENDERER_VERSION ? pCreateDefaultRenderer->Version : PET_RENDERER_VERSION;
+
     return PetSuccess;
 }
 
@@ -449,3 +1206,63 @@ static PetStatus CopyFramebuffer(const PetRendererHandle rendererHandle, uint8_t
 
     return DefaultPetRenderer::FromHandle(rendererHandle)->CopyFramebuffer(pOutFramebuffer, size);
 }
+
+static PetStatus CopyDirtyFramebuffer(const PetRendererHandle rendererHandle, uint8_t* const pOutFramebuffer, const size_t size, ScreenRect* const pOutRects, uint32_t* const pRectCount)
+{
+    if(!rendererHandle.Ptr)
+    {
+        return PetInvalidArg;
+    }
+
+    return DefaultPetRenderer::FromHandle(rendererHandle)->CopyDirtyFramebuffer(pOutFramebuffer, size, pOutRects, pRectCount);
+}
+
+static PetStatus BeginDrawCommands(const PetRendererHandle rendererHandle)
+{
+    if(!rendererHandle.Ptr)
+    {
+        return PetInvalidArg;
+    }
+
+    return DefaultPetRenderer::FromHandle(rendererHandle)->BeginDrawCommands();
+}
+
+static PetStatus SubmitDrawCommands(const PetRendererHandle rendererHandle, const PetDrawCommand* const pCommands, const uint32_t commandCount)
+{
+    if(!rendererHandle.Ptr)
+    {
+        return PetInvalidArg;
+    }
+
+    return DefaultPetRenderer::FromHandle(rendererHandle)->SubmitDrawCommands(pCommands, commandCount);
+}
+
+static PetStatus EndDrawCommands(const PetRendererHandle rendererHandle)
+{
+    if(!rendererHandle.Ptr)
+    {
+        return PetInvalidArg;
+    }
+
+    return DefaultPetRenderer::FromHandle(rendererHandle)->EndDrawCommands();
+}
+
+static PetStatus LockFramebuffer(const PetRendererHandle rendererHandle, PetFramebufferLock* const pLock)
+{
+    if(!rendererHandle.Ptr)
+    {
+        return PetInvalidArg;
+    }
+
+    return DefaultPetRenderer::FromHandle(rendererHandle)->LockFramebuffer(pLock);
+}
+
+static PetStatus UnlockFramebuffer(const PetRendererHandle rendererHandle)
+{
+    if(!rendererHandle.Ptr)
+    {
+        return PetInvalidArg;
+    }
+
+    return DefaultPetRenderer::FromHandle(rendererHandle)->UnlockFramebuffer();
+}
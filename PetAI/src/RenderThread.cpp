@@ -0,0 +1,265 @@
+#include "RenderThread.hpp"
+#include <SysLib.h>
+
+static bool IsSameColor(const RGBColor& a, const RGBColor& b) noexcept
+{
+    return a.R == b.R && a.G == b.G && a.B == b.B;
+}
+
+static bool IsSamePoint(const ScreenPoint& a, const ScreenPoint& b) noexcept
+{
+    return a.X == b.X && a.Y == b.Y;
+}
+
+static bool IsSameCommand(const PetDrawCommand& a, const PetDrawCommand& b) noexcept
+{
+    if(a.Type != b.Type)
+    {
+        return false;
+    }
+
+    // Field by field, the padding of the union isn't necessarily zeroed.
+    if(a.Type == PetDrawCommandRectangle)
+    {
+        const DrawRectData& rectA = a.Data.Rectangle;
+        const DrawRectData& rectB = b.Data.Rectangle;
+
+        return IsSamePoint(rectA.Points[0], rectB.Points[0]) && IsSamePoint(rectA.Points[1], rectB.Points[1]) &&
+            rectA.Depth == rectB.Depth && IsSameColor(rectA.Color, rectB.Color);
+    }
+
+    const DrawTriangleData& triangleA = a.Data.Triangle;
+    const DrawTriangleData& triangleB = b.Data.Triangle;
+
+    return IsSamePoint(triangleA.Points[0], triangleB.Points[0]) && IsSamePoint(triangleA.Points[1], triangleB.Points[1]) &&
+        IsSamePoint(triangleA.Points[2], triangleB.Points[2]) && triangleA.Depth == triangleB.Depth && IsSameColor(triangleA.Color, triangleB.Color);
+}
+
+void SceneSnapshot::CopyFrom(const SceneSnapshot& other) noexcept
+{
+    m_HasClear = other.m_HasClear;
+    m_ClearColor = other.m_ClearColor;
+    m_ClearDepth = other.m_ClearDepth;
+    m_Commands.assign(other.m_Commands.begin(), other.m_Commands.end());
+}
+
+bool SceneSnapshot::IsSameAs(const SceneSnapshot& other) const noexcept
+{
+    if(m_HasClear != other.m_HasClear || m_Commands.size() != other.m_Commands.size())
+    {
+        return false;
+    }
+
+    if(m_HasClear && (!IsSameColor(m_ClearColor, other.m_ClearColor) || m_ClearDepth != other.m_ClearDepth))
+    {
+        return false;
+    }
+
+    for(::std::size_t i = 0; i < m_Commands.size(); ++i)
+    {
+        if(!IsSameCommand(m_Commands[i], other.m_Commands[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+PetStatus SceneSnapshot::Draw(const PetRendererHandle rendererHandle, const PetRendererFunctions& rendererFunctions) const noexcept
+{
+    const bool recordDraws = rendererFunctions.Version >= PET_RENDERER_VERSION_1_2 && rendererFunctions.BeginDrawCommands && rendererFunctions.SubmitDrawCommands && rendererFunctions.EndDrawCommands;
+
+    PetStatus status;
+
+    if(recordDraws)
+    {
+        status = rendererFunctions.BeginDrawCommands(rendererHandle);
+
+        if(IsStatusError(status))
+        {
+            return status;
+        }
+    }
+
+    if(m_HasClear && rendererFunctions.ClearScreen)
+    {
+        status = rendererFunctions.ClearScreen(rendererHandle, m_ClearColor.R, m_ClearColor.G, m_ClearColor.B, m_ClearDepth);
+
+        if(IsStatusError(status))
+        {
+            DebugPrintF(u8"[SceneSnapshot::Draw]: rendererFunctions.ClearScreen returned status 0x%08X.\n", status);
+        }
+    }
+
+    if(recordDraws)
+    {
+        status = rendererFunctions.SubmitDrawCommands(rendererHandle, m_Commands.data(), CommandCount());
+
+        if(IsStatusError(status))
+        {
+            DebugPrintF(u8"[SceneSnapshot::Draw]: rendererFunctions.SubmitDrawCommands returned status 0x%08X.\n", status);
+        }
+
+        return rendererFunctions.EndDrawCommands(rendererHandle);
+    }
+
+    for(const PetDrawCommand& command : m_Commands)
+    {
+        if(command.Type == PetDrawCommandRectangle && rendererFunctions.DrawRectangle)
+        {
+            (void) rendererFunctions.DrawRectangle(rendererHandle, &command.Data.Rectangle);
+        }
+        else if(command.Type == PetDrawCommandTriangle && rendererFunctions.DrawTriangle)
+        {
+            (void) rendererFunctions.DrawTriangle(rendererHandle, &command.Data.Triangle);
+        }
+    }
+
+    return PetSuccess;
+}
+
+RenderThread::RenderThread() noexcept
+    : m_Thread()
+    , m_Snapshots()
+    , m_Drawn()
+    , m_HasDrawn(false)
+    , m_Present(nullptr)
+    , m_AppHandle { nullptr }
+    , m_RendererHandle { nullptr }
+    , m_RendererFunctions(nullptr)
+    , m_WriteIndex(0)
+    , m_ReadIndex(1)
+    , m_Ready(2)
+    , m_Wakeups(0)
+    , m_Stopping(false)
+    , m_PresentCount(0)
+    , m_DrawCount(0)
+{ }
+
+RenderThread::~RenderThread() noexcept
+{
+    Stop();
+}
+
+void RenderThread::Init(Present_f* const present, const PetAppHandle appHandle, const PetRendererHandle rendererHandle, const PetRendererFunctions* const pRendererFunctions) noexcept
+{
+    m_Present = present;
+    m_AppHandle = appHandle;
+    m_RendererHandle = rendererHandle;
+    m_RendererFunctions = pRendererFunctions;
+    m_HasDrawn = false;
+}
+
+PetStatus RenderThread::Start() noexcept
+{
+    Stop();
+
+    if(!m_Present || !m_RendererFunctions)
+    {
+        return PetInvalidArg;
+    }
+
+    m_Stopping.store(false, ::std::memory_order_relaxed);
+
+    m_Thread = ::std::thread(&RenderThread::RenderMain, this);
+
+    return PetSuccess;
+}
+
+void RenderThread::Stop() noexcept
+{
+    if(!m_Thread.joinable())
+    {
+        return;
+    }
+
+    m_Stopping.store(true, ::std::memory_order_release);
+    m_Wakeups.fetch_add(1, ::std::memory_order_release);
+    m_Wakeups.notify_one();
+
+    m_Thread.join();
+}
+
+SceneSnapshot& RenderThread::BeginSnapshot() noexcept
+{
+    SceneSnapshot& snapshot = m_Snapshots[m_WriteIndex];
+    snapshot.Clear();
+    return snapshot;
+}
+
+void RenderThread::Publish() noexcept
+{
+    if(!m_Thread.joinable())
+    {
+        RenderFrame(m_Snapshots[m_WriteIndex]);
+        return;
+    }
+
+    //   Whatever was in the middle slot is either already drawn, or older
+    // than this, either way it's ours to fill next.
+    const ::std::uint32_t previous = m_Ready.exchange(m_WriteIndex | FreshBit, ::std::memory_order_acq_rel);
+    m_WriteIndex = previous & IndexMask;
+
+    m_Wakeups.fetch_add(1, ::std::memory_order_release);
+    m_Wakeups.notify_one();
+}
+
+bool RenderThread::AcquireSnapshot() noexcept
+{
+    if(!(m_Ready.load(::std::memory_order_acquire) & FreshBit))
+    {
+        return false;
+    }
+
+    // Only Publish sets the bit, so it is still set, the index may have changed though.
+    const ::std::uint32_t ready = m_Ready.exchange(m_ReadIndex, ::std::memory_order_acq_rel);
+    m_ReadIndex = ready & IndexMask;
+    return true;
+}
+
+void RenderThread::RenderMain() noexcept
+{
+    while(true)
+    {
+        //   Read the wakeup count first, a publish or stop that lands after
+        // the checks below changes it, and the wait returns straight away.
+        const ::std::uint32_t wakeups = m_Wakeups.load(::std::memory_order_acquire);
+
+        if(AcquireSnapshot())
+        {
+            RenderFrame(m_Snapshots[m_ReadIndex]);
+            continue;
+        }
+
+        // Everything published before the stop request has been presented.
+        if(m_Stopping.load(::std::memory_order_acquire))
+        {
+            return;
+        }
+
+        m_Wakeups.wait(wakeups, ::std::memory_order_acquire);
+    }
+}
+
+void RenderThread::RenderFrame(const SceneSnapshot& snapshot) noexcept
+{
+    // The renderer keeps the last frame, so an unchanged scene only has to be presented again.
+    if(!m_HasDrawn || !snapshot.IsSameAs(m_Drawn))
+    {
+        const PetStatus status = snapshot.Draw(m_RendererHandle, *m_RendererFunctions);
+
+        if(IsStatusError(status))
+        {
+            DebugPrintF(u8"[RenderThread::RenderFrame]: snapshot.Draw returned status 0x%08X.\n", status);
+        }
+
+        m_Drawn.CopyFrom(snapshot);
+        m_HasDrawn = true;
+        m_DrawCount.fetch_add(1, ::std::memory_order_release);
+    }
+
+    (void) m_Present(m_AppHandle, m_RendererHandle, m_RendererFunctions);
+
+    m_PresentCount.fetch_add(1, ::std::memory_order_release);
+}
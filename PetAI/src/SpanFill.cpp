@@ -0,0 +1,300 @@
+#include "SpanFill.hpp"
+#include <cstring>
+#include <initializer_list>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+  #define SPAN_FILL_X86 1
+  #include <immintrin.h>
+  #if defined(_MSC_VER) && !defined(__clang__)
+    #include <intrin.h>
+    // MSVC lets any function use any instruction set.
+    #define SPAN_FILL_TARGET_AVX2
+  #else
+    #define SPAN_FILL_TARGET_AVX2 __attribute__((target("avx2")))
+  #endif
+#else
+  #define SPAN_FILL_X86 0
+#endif
+
+static constexpr size_t PatternPixels = 16;
+static constexpr size_t PatternSize = PatternPixels * 3;
+
+static void BuildPattern(uint8_t* const pattern, const size_t patternSize, const uint8_t r, const uint8_t g, const uint8_t b) noexcept
+{
+    for(size_t i = 0; i < patternSize; i += 3)
+    {
+        pattern[i + 0] = r;
+        pattern[i + 1] = g;
+        pattern[i + 2] = b;
+    }
+}
+
+/**
+ *   Finishes off a run of fewer than 16 pixels, the pattern always
+ * starts on a pixel boundary.
+ */
+static void FillTail(uint8_t* const dst, const size_t byteCount, const uint8_t* const pattern) noexcept
+{
+    (void) ::std::memcpy(dst, pattern, byteCount);
+}
+
+static void FillRgbScalar(uint8_t* dst, const size_t pixelCount, const uint8_t r, const uint8_t g, const uint8_t b) noexcept
+{
+    uint8_t pattern[PatternSize];
+    BuildPattern(pattern, sizeof(pattern), r, g, b);
+
+    size_t byteCount = pixelCount * 3;
+
+    for(; byteCount >= PatternSize; byteCount -= PatternSize, dst += PatternSize)
+    {
+        (void) ::std::memcpy(dst, pattern, PatternSize);
+    }
+
+    FillTail(dst, byteCount, pattern);
+}
+
+static void FillRgbDepthScalar(uint8_t* const dst, uint16_t* const depthDst, const size_t pixelCount, const uint16_t depth, const uint8_t r, const uint8_t g, const uint8_t b) noexcept
+{
+    size_t runStart = 0;
+    bool inRun = false;
+
+    for(size_t i = 0; i < pixelCount; ++i)
+    {
+        if(depthDst[i] <= depth)
+        {
+            depthDst[i] = depth;
+
+            if(!inRun)
+            {
+                runStart = i;
+                inRun = true;
+            }
+        }
+        else if(inRun)
+        {
+            SpanFill::FillRgb(dst + runStart * 3, i - runStart, r, g, b);
+            inRun = false;
+        }
+    }
+
+    if(inRun)
+    {
+        SpanFill::FillRgb(dst + runStart * 3, pixelCount - runStart, r, g, b);
+    }
+}
+
+#if SPAN_FILL_X86
+static void FillRgbSSE2(uint8_t* dst, const size_t pixelCount, const uint8_t r, const uint8_t g, const uint8_t b) noexcept
+{
+    uint8_t pattern[PatternSize];
+    BuildPattern(pattern, sizeof(pattern), r, g, b);
+
+    const __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern + 0));
+    const __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern + 16));
+    const __m128i p2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern + 32));
+
+    size_t byteCount = pixelCount * 3;
+
+    for(; byteCount >= PatternSize; byteCount -= PatternSize, dst += PatternSize)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 0), p0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), p1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 32), p2);
+    }
+
+    FillTail(dst, byteCount, pattern);
+}
+
+SPAN_FILL_TARGET_AVX2 static void FillRgbAVX2(uint8_t* dst, const size_t pixelCount, const uint8_t r, const uint8_t g, const uint8_t b) noexcept
+{
+    uint8_t pattern[PatternSize * 2];
+    BuildPattern(pattern, sizeof(pattern), r, g, b);
+
+    //   32 byte stores line up with the pattern every 96 bytes, so the
+    // pattern rotates through 3 registers.
+    const __m256i p0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pattern + 0));
+    const __m256i p1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pattern + 32));
+    const __m256i p2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pattern + 64));
+
+    size_t byteCount = pixelCount * 3;
+
+    for(; byteCount >= PatternSize * 2; byteCount -= PatternSize * 2, dst += PatternSize * 2)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 0), p0);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 32), p1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 64), p2);
+    }
+
+    if(byteCount >= PatternSize)
+    {
+        (void) ::std::memcpy(dst, pattern, PatternSize);
+        byteCount -= PatternSize;
+        dst += PatternSize;
+    }
+
+    FillTail(dst, byteCount, pattern);
+}
+
+static void FillRgbDepthSSE2(uint8_t* const dst, uint16_t* const depthDst, const size_t pixelCount, const uint16_t depth, const uint8_t r, const uint8_t g, const uint8_t b) noexcept
+{
+    const __m128i depth8 = _mm_set1_epi16(static_cast<short>(depth));
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t runStart = 0;
+    bool inRun = false;
+    size_t i = 0;
+
+    for(; i + 8 <= pixelCount; i += 8)
+    {
+        __m128i* const depthPtr = reinterpret_cast<__m128i*>(depthDst + i);
+        const __m128i stored = _mm_loadu_si128(depthPtr);
+
+        //   SSE2 has no unsigned 16 bit compare, but stored <= depth exactly
+        // when the saturating difference is 0, and stored + that difference
+        // is the max of the two.
+        const __m128i over = _mm_subs_epu16(stored, depth8);
+        _mm_storeu_si128(depthPtr, _mm_add_epi16(over, depth8));
+
+        // 2 mask bits per pixel.
+        const uint32_t passMask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi16(over, zero)));
+
+        if(passMask == 0xFFFF)
+        {
+            if(!inRun)
+            {
+                runStart = i;
+                inRun = true;
+            }
+
+            continue;
+        }
+
+        if(passMask == 0 && !inRun)
+        {
+            continue;
+        }
+
+        for(size_t j = 0; j < 8; ++j)
+        {
+            const bool pass = (passMask >> (j * 2)) & 1;
+
+            if(pass && !inRun)
+            {
+                runStart = i + j;
+                inRun = true;
+            }
+            else if(!pass && inRun)
+            {
+                SpanFill::FillRgb(dst + runStart * 3, i + j - runStart, r, g, b);
+                inRun = false;
+            }
+        }
+    }
+
+    for(; i < pixelCount; ++i)
+    {
+        const bool pass = depthDst[i] <= depth;
+
+        if(pass)
+        {
+            depthDst[i] = depth;
+
+            if(!inRun)
+            {
+                runStart = i;
+                inRun = true;
+            }
+        }
+        else if(inRun)
+        {
+            SpanFill::FillRgb(dst + runStart * 3, i - runStart, r, g, b);
+            inRun = false;
+        }
+    }
+
+    if(inRun)
+    {
+        SpanFill::FillRgb(dst + runStart * 3, pixelCount - runStart, r, g, b);
+    }
+}
+
+static bool SupportsAVX2() noexcept
+{
+  #if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+
+    if(info[0] < 7)
+    {
+        return false;
+    }
+
+    __cpuid(info, 1);
+
+    // The OS has to save the YMM registers for us, which is what OSXSAVE and XCR0 tell us.
+    constexpr int OsxSaveBit = 1 << 27;
+    constexpr int AvxBit = 1 << 28;
+
+    if((info[2] & (OsxSaveBit | AvxBit)) != (OsxSaveBit | AvxBit) || (_xgetbv(0) & 6) != 6)
+    {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+
+    constexpr int Avx2Bit = 1 << 5;
+    return (info[1] & Avx2Bit) != 0;
+  #else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+  #endif
+}
+#endif
+
+SpanFill::FillRgbFunc SpanFill::s_FillRgb = FillRgbScalar;
+SpanFill::FillRgbDepthFunc SpanFill::s_FillRgbDepth = FillRgbDepthScalar;
+SpanFill::Kernel SpanFill::s_ActiveKernel = SpanFill::SelectKernel();
+
+SpanFill::FillRgbFunc SpanFill::KernelFunc(const Kernel kernel) noexcept
+{
+    switch(kernel)
+    {
+        case Kernel::Scalar: return FillRgbScalar;
+#if SPAN_FILL_X86
+        // SSE2 is part of every x86-64 CPU, and of anything 32 bit we'd run on.
+        case Kernel::SSE2: return FillRgbSSE2;
+        case Kernel::AVX2: return SupportsAVX2() ? FillRgbAVX2 : nullptr;
+#endif
+        default: return nullptr;
+    }
+}
+
+SpanFill::FillRgbDepthFunc SpanFill::DepthKernelFunc(const Kernel kernel) noexcept
+{
+    switch(kernel)
+    {
+        case Kernel::Scalar: return FillRgbDepthScalar;
+#if SPAN_FILL_X86
+        case Kernel::SSE2: return FillRgbDepthSSE2;
+        case Kernel::AVX2: return SupportsAVX2() ? FillRgbDepthSSE2 : nullptr;
+#endif
+        default: return nullptr;
+    }
+}
+
+SpanFill::Kernel SpanFill::SelectKernel() noexcept
+{
+    for(const Kernel kernel : { Kernel::AVX2, Kernel::SSE2 })
+    {
+        if(const FillRgbFunc func = KernelFunc(kernel))
+        {
+            s_FillRgb = func;
+            s_FillRgbDepth = DepthKernelFunc(kernel);
+            return kernel;
+        }
+    }
+
+    s_FillRgb = FillRgbScalar;
+    s_FillRgbDepth = FillRgbDepthScalar;
+    return Kernel::Scalar;
+}
@@ -0,0 +1,231 @@
+#include "WorkerPool.hpp"
+#include <SysLib.h>
+#include <new>
+
+WorkerPool::WorkerPool() noexcept
+    : m_Workers()
+    , m_Ranges(nullptr)
+    , m_Generation(0)
+    , m_BusyWorkers(0)
+    , m_Stopping(false)
+    , m_Func()
+    , m_ItemCount(0)
+    , m_ChunkSize(0)
+{ }
+
+WorkerPool::~WorkerPool() noexcept
+{
+    Stop();
+}
+
+PetStatus WorkerPool::Start(::std::uint32_t threadCount) noexcept
+{
+    Stop();
+
+    if(threadCount > MaxThreadCount)
+    {
+        threadCount = MaxThreadCount;
+    }
+
+    if(threadCount <= 1)
+    {
+        return PetSuccess;
+    }
+
+    m_Ranges = new(::std::nothrow) ChunkRange[threadCount];
+
+    if(!m_Ranges)
+    {
+        return PetOutOfMemory;
+    }
+
+    for(::std::uint32_t i = 0; i < threadCount; ++i)
+    {
+        m_Ranges[i].Range.store(0, ::std::memory_order_relaxed);
+    }
+
+    m_Stopping.store(false, ::std::memory_order_relaxed);
+    m_Workers.reserve(threadCount - 1);
+
+    //   The workers have to know which generation they start at, otherwise
+    // a job published before a worker gets scheduled would be missed.
+    const ::std::uint32_t startGeneration = m_Generation.load(::std::memory_order_relaxed);
+
+    for(::std::uint32_t i = 1; i < threadCount; ++i)
+    {
+        m_Workers.emplace_back(&WorkerPool::WorkerMain, this, i, startGeneration);
+    }
+
+    return PetSuccess;
+}
+
+void WorkerPool::Stop() noexcept
+{
+    if(!m_Workers.empty())
+    {
+        m_Stopping.store(true, ::std::memory_order_relaxed);
+        m_Generation.fetch_add(1, ::std::memory_order_release);
+        m_Generation.notify_all();
+
+        for(::std::thread& worker : m_Workers)
+        {
+            worker.join();
+        }
+
+        m_Workers.clear();
+    }
+
+    delete[] m_Ranges;
+    m_Ranges = nullptr;
+}
+
+void WorkerPool::ParallelFor(const ::std::uint32_t itemCount, ::std::uint32_t chunkSize, const TaskFunc func) noexcept
+{
+    if(itemCount == 0 || !func)
+    {
+        return;
+    }
+
+    if(chunkSize == 0)
+    {
+        chunkSize = 1;
+    }
+
+    // Not worth waking anybody up if there is only a single chunk.
+    if(m_Workers.empty() || itemCount <= chunkSize)
+    {
+        func(0, 0, itemCount);
+        return;
+    }
+
+    const ::std::uint32_t participantCount = ThreadCount();
+    const ::std::uint32_t chunkCount = (itemCount + chunkSize - 1) / chunkSize;
+
+    m_Func = func;
+    m_ItemCount = itemCount;
+    m_ChunkSize = chunkSize;
+
+    // Hand each participant an equal, contiguous share of the chunks.
+    for(::std::uint32_t i = 0; i < participantCount; ++i)
+    {
+        const ::std::uint32_t begin = static_cast<::std::uint32_t>(static_cast<::std::uint64_t>(chunkCount) * i / participantCount);
+        const ::std::uint32_t end = static_cast<::std::uint32_t>(static_cast<::std::uint64_t>(chunkCount) * (i + 1) / participantCount);
+        m_Ranges[i].Range.store(PackRange(begin, end), ::std::memory_order_relaxed);
+    }
+
+    m_BusyWorkers.store(participantCount - 1, ::std::memory_order_relaxed);
+    m_Generation.fetch_add(1, ::std::memory_order_release);
+    m_Generation.notify_all();
+
+    RunChunks(0);
+
+    //   Every worker has to check in before we return, otherwise a slow
+    // worker could still be looking at this job's state when the next one
+    // is set up.
+    ::std::uint32_t busyWorkers = m_BusyWorkers.load(::std::memory_order_acquire);
+
+    while(busyWorkers != 0)
+    {
+        m_BusyWorkers.wait(busyWorkers, ::std::memory_order_acquire);
+        busyWorkers = m_BusyWorkers.load(::std::memory_order_acquire);
+    }
+}
+
+void WorkerPool::WorkerMain(const ::std::uint32_t workerIndex, const ::std::uint32_t startGeneration) noexcept
+{
+    // Give every worker its own random sequence, the calling thread keeps the default seed.
+    SeedRng(static_cast<int>(workerIndex));
+
+    ::std::uint32_t seenGeneration = startGeneration;
+
+    while(true)
+    {
+        m_Generation.wait(seenGeneration, ::std::memory_order_acquire);
+        seenGeneration = m_Generation.load(::std::memory_order_acquire);
+
+        if(m_Stopping.load(::std::memory_order_relaxed))
+        {
+            return;
+        }
+
+        RunChunks(workerIndex);
+
+        if(m_BusyWorkers.fetch_sub(1, ::std::memory_order_acq_rel) == 1)
+        {
+            m_BusyWorkers.notify_one();
+        }
+    }
+}
+
+void WorkerPool::RunChunks(const ::std::uint32_t workerIndex) noexcept
+{
+    ::std::uint32_t chunk;
+
+    while(PopChunk(workerIndex, &chunk) || StealChunk(workerIndex, &chunk))
+    {
+        const ::std::uint32_t begin = chunk * m_ChunkSize;
+        const ::std::uint32_t end = begin + m_ChunkSize < m_ItemCount ? begin + m_ChunkSize : m_ItemCount;
+
+        m_Func(workerIndex, begin, end);
+    }
+}
+
+bool WorkerPool::PopChunk(const ::std::uint32_t workerIndex, ::std::uint32_t* const pChunk) noexcept
+{
+    ::std::atomic<::std::uint64_t>& range = m_Ranges[workerIndex].Range;
+    ::std::uint64_t current = range.load(::std::memory_order_acquire);
+
+    while(true)
+    {
+        const ::std::uint32_t begin = RangeBegin(current);
+        const ::std::uint32_t end = RangeEnd(current);
+
+        if(begin >= end)
+        {
+            return false;
+        }
+
+        if(range.compare_exchange_weak(current, PackRange(begin + 1, end), ::std::memory_order_acq_rel, ::std::memory_order_acquire))
+        {
+            *pChunk = begin;
+            return true;
+        }
+    }
+}
+
+bool WorkerPool::StealChunk(const ::std::uint32_t workerIndex, ::std::uint32_t* const pChunk) noexcept
+{
+    const ::std::uint32_t participantCount = ThreadCount();
+
+    for(::std::uint32_t i = 1; i < participantCount; ++i)
+    {
+        const ::std::uint32_t victimIndex = (workerIndex + i) % participantCount;
+        ::std::atomic<::std::uint64_t>& victim = m_Ranges[victimIndex].Range;
+        ::std::uint64_t current = victim.load(::std::memory_order_acquire);
+
+        while(true)
+        {
+            const ::std::uint32_t begin = RangeBegin(current);
+            const ::std::uint32_t end = RangeEnd(current);
+
+            if(begin >= end)
+            {
+                break;
+            }
+
+            // Take the back half, a single remaining chunk can still be stolen.
+            const ::std::uint32_t middle = begin + (end - begin) / 2;
+
+            if(victim.compare_exchange_weak(current, PackRange(begin, middle), ::std::memory_order_acq_rel, ::std::memory_order_acquire))
+            {
+                //   Our own range is empty at this point, so no thief can
+                // modify it; the rest of the stolen chunks become ours.
+                m_Ranges[workerIndex].Range.store(PackRange(middle + 1, end), ::std::memory_order_release);
+                *pChunk = middle;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
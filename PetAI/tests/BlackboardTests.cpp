@@ -0,0 +1,284 @@
+#include <gtest/gtest.h>
+#include "Blackboard.hpp"
+#include "BlackboardSchema.hpp"
+#include "FNV1a.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+TEST(BlackboardTest, ColumnKeysLiveInColumns) {
+    BlackboardKeyManager keyManager;
+    const BlackboardKey rowKey = keyManager.CalculateKey(CSTR("Test.Row"), sizeof(int32_t));
+    const BlackboardKey columnKey = keyManager.CalculateKey(CSTR("Test.Column"), sizeof(int32_t), BlackboardKeyStorage::Column);
+
+    BlackboardColumns columns;
+    ASSERT_EQ(columns.Init(keyManager), PetSuccess);
+    EXPECT_FALSE(columns.IsColumn(rowKey));
+    EXPECT_TRUE(columns.IsColumn(columnKey));
+
+    uint32_t slot0;
+    uint32_t slot1;
+    ASSERT_EQ(columns.AllocSlot(&slot0), PetSuccess);
+    ASSERT_EQ(columns.AllocSlot(&slot1), PetSuccess);
+
+    BlackboardLayout layout;
+    ASSERT_EQ(layout.Init(keyManager, &columns), PetSuccess);
+    EXPECT_EQ(layout.DataSize(), sizeof(int32_t));
+
+    Blackboard blackboard0(layout, slot0);
+    Blackboard blackboard1(layout, slot1);
+
+    *blackboard0.GetT<int32_t>(columnKey) = 10;
+    *blackboard1.GetT<int32_t>(columnKey) = 20;
+    *blackboard0.GetT<int32_t>(rowKey) = 30;
+
+    const int32_t* const column = columns.Column<int32_t>(columnKey);
+    ASSERT_NE(column, nullptr);
+    EXPECT_EQ(column[slot0], 10);
+    EXPECT_EQ(column[slot1], 20);
+    EXPECT_EQ(*blackboard1.GetT<int32_t>(rowKey), 0);
+}
+
+TEST(BlackboardTest, FreedColumnSlotsAreReusedZeroed) {
+    BlackboardKeyManager keyManager;
+    const BlackboardKey columnKey = keyManager.CalculateKey(CSTR("Test.Column"), sizeof(int32_t), BlackboardKeyStorage::Column);
+
+    BlackboardColumns columns;
+    ASSERT_EQ(columns.Init(keyManager), PetSuccess);
+
+    uint32_t slot0;
+    uint32_t slot1;
+    ASSERT_EQ(columns.AllocSlot(&slot0), PetSuccess);
+    ASSERT_EQ(columns.AllocSlot(&slot1), PetSuccess);
+    *static_cast<int32_t*>(columns.Get(columnKey, slot0)) = 5;
+
+    columns.FreeSlot(slot0);
+    EXPECT_EQ(columns.FreeSlotCount(), 1u);
+
+    uint32_t slot2;
+    ASSERT_EQ(columns.AllocSlot(&slot2), PetSuccess);
+    EXPECT_EQ(slot2, slot0);
+    EXPECT_EQ(columns.SlotCount(), 2u);
+    EXPECT_EQ(*static_cast<int32_t*>(columns.Get(columnKey, slot2)), 0);
+}
+
+TEST(BlackboardTest, UsesExternalStorage) {
+    BlackboardKeyManager keyManager;
+    const BlackboardKey key0 = keyManager.CalculateKey(CSTR("Test.Key0"), sizeof(int32_t));
+    const BlackboardKey key1 = keyManager.CalculateKey(CSTR("Test.Key1"), sizeof(int64_t));
+
+    BlackboardLayout layout;
+    ASSERT_EQ(layout.Init(keyManager), PetSuccess);
+
+    const size_t storageSize = layout.DataSize();
+    EXPECT_EQ(storageSize, sizeof(int32_t) + sizeof(int64_t));
+
+    std::vector<size_t> storage((storageSize + sizeof(size_t) - 1) / sizeof(size_t), SIZE_MAX);
+    Blackboard blackboard(layout, 0, storage.data());
+
+    unsigned char* const begin = reinterpret_cast<unsigned char*>(storage.data());
+    unsigned char* const value0 = static_cast<unsigned char*>(blackboard.Get(key0));
+    unsigned char* const value1 = static_cast<unsigned char*>(blackboard.Get(key1));
+
+    EXPECT_GE(value0, begin);
+    EXPECT_LT(value0, begin + storageSize);
+    EXPECT_GE(value1, begin);
+    EXPECT_LT(value1, begin + storageSize);
+    EXPECT_EQ(*reinterpret_cast<int32_t*>(value0), 0);
+}
+
+TEST(BlackboardTest, ColumnKeysWithoutColumnsAreRows) {
+    BlackboardKeyManager keyManager;
+    const BlackboardKey columnKey = keyManager.CalculateKey(CSTR("Test.Column"), sizeof(int32_t), BlackboardKeyStorage::Column);
+
+    BlackboardLayout layout;
+    ASSERT_EQ(layout.Init(keyManager), PetSuccess);
+
+    Blackboard blackboard0(layout);
+    Blackboard blackboard1(layout);
+
+    *blackboard0.GetT<int32_t>(columnKey) = 1;
+    EXPECT_EQ(*blackboard1.GetT<int32_t>(columnKey), 0);
+}
+
+TEST(BlackboardTest, ColumnsKeepValuesWhenGrowing) {
+    BlackboardKeyManager keyManager;
+    const BlackboardKey columnKey = keyManager.CalculateKey(CSTR("Test.Column"), sizeof(int32_t), BlackboardKeyStorage::Column);
+
+    BlackboardColumns columns;
+    ASSERT_EQ(columns.Init(keyManager), PetSuccess);
+
+    BlackboardLayout layout;
+    ASSERT_EQ(layout.Init(keyManager, &columns), PetSuccess);
+
+    std::vector<std::unique_ptr<Blackboard>> blackboards;
+
+    for(int32_t i = 0; i < 1000; ++i)
+    {
+        uint32_t slot;
+        ASSERT_EQ(columns.AllocSlot(&slot), PetSuccess);
+        blackboards.push_back(std::make_unique<Blackboard>(layout, slot));
+        *blackboards.back()->GetT<int32_t>(columnKey) = i;
+    }
+
+    EXPECT_EQ(columns.SlotCount(), 1000u);
+
+    for(int32_t i = 0; i < 1000; ++i)
+    {
+        EXPECT_EQ(*blackboards[static_cast<size_t>(i)]->GetT<int32_t>(columnKey), i);
+    }
+}
+
+TEST(BlackboardTest, LayoutIsFrozen) {
+    BlackboardKeyManager keyManager;
+    const BlackboardKey key0 = keyManager.CalculateKey(CSTR("Test.Key0"), sizeof(int32_t));
+
+    BlackboardLayout layout;
+    ASSERT_EQ(layout.Init(keyManager), PetSuccess);
+
+    const BlackboardKey key1 = keyManager.CalculateKey(CSTR("Test.Key1"), sizeof(int32_t));
+
+    EXPECT_NE(layout.Offset(key0), BlackboardLayout::InvalidOffset);
+    EXPECT_EQ(layout.Offset(key1), BlackboardLayout::InvalidOffset);
+    EXPECT_EQ(layout.Offset(BlackboardKey(-1)), BlackboardLayout::InvalidOffset);
+
+    Blackboard blackboard(layout);
+    EXPECT_NE(blackboard.Get(key0), nullptr);
+    EXPECT_EQ(blackboard.Get(key1), nullptr);
+}
+
+TEST(BlackboardTest, WritesMarkDirtyLines) {
+    BlackboardKeyManager keyManager;
+    const BlackboardKey small = keyManager.CalculateKey(CSTR("Test.A"), sizeof(uint64_t));
+    const BlackboardKey big = keyManager.CalculateKey(CSTR("Test.Big"), 100);
+    const BlackboardKey last = keyManager.CalculateKey(CSTR("Test.Z"), sizeof(int32_t));
+
+    BlackboardLayout layout;
+    ASSERT_EQ(layout.Init(keyManager), PetSuccess);
+    ASSERT_EQ(layout.DirtyLineSize(), 64u);
+
+    EXPECT_EQ(layout.DirtyMask(small), 0b01u);
+    EXPECT_EQ(layout.DirtyMask(big), 0b11u);
+    EXPECT_EQ(layout.DirtyMask(last), 0b10u);
+
+    Blackboard blackboard(layout);
+    EXPECT_EQ(blackboard.DirtyLines(), 0u);
+
+    // Reading through a const blackboard doesn't dirty anything.
+    const Blackboard& constBlackboard = blackboard;
+    EXPECT_NE(constBlackboard.Get(last), nullptr);
+    EXPECT_EQ(blackboard.DirtyLines(), 0u);
+
+    *blackboard.GetT<int32_t>(last) = 3;
+    EXPECT_EQ(blackboard.DirtyLines(), 0b10u);
+
+    blackboard.ClearDirty();
+    blackboard.MarkDirty(small);
+    EXPECT_EQ(blackboard.DirtyLines(), 0b01u);
+    EXPECT_FALSE(blackboard.ColumnsDirty());
+}
+
+namespace {
+
+using TestSchema = BlackboardSchema<
+    BlackboardField<"Test.Byte", uint8_t>,
+    BlackboardField<"Test.Double", double>,
+    BlackboardField<"Test.Int", int32_t>
+>;
+
+static_assert(TestSchema::Key<"Test.Byte">::Offset == 0);
+static_assert(TestSchema::Key<"Test.Double">::Offset == alignof(double));
+static_assert(TestSchema::Key<"Test.Int">::Offset == alignof(double) + sizeof(double));
+static_assert(std::is_same_v<TestSchema::Key<"Test.Int">::Type, int32_t>);
+static_assert(TestSchema::Size % alignof(std::max_align_t) == 0);
+static_assert(BlackboardSchema<>::Size == 0);
+
+}
+
+TEST(BlackboardTest, SchemaKeysPrecedeRuntimeKeys) {
+    BlackboardKeyManager keyManager;
+    const BlackboardKey runtimeKey = keyManager.CalculateKey(CSTR("Test.Runtime"), sizeof(int32_t));
+
+    BlackboardLayout layout;
+    ASSERT_EQ(layout.Init(keyManager, nullptr, TestSchema::Size), PetSuccess);
+    EXPECT_EQ(layout.ReservedSize(), TestSchema::Size);
+    EXPECT_EQ(layout.DataSize(), TestSchema::Size + sizeof(int32_t));
+    EXPECT_EQ(layout.Offset(runtimeKey), TestSchema::Size);
+
+    Blackboard blackboard(layout);
+    *blackboard.Get<TestSchema::Key<"Test.Int">>() = 42;
+    *blackboard.Get<TestSchema::Key<"Test.Double">>() = 1.5;
+    *blackboard.GetT<int32_t>(runtimeKey) = 7;
+
+    EXPECT_EQ(*blackboard.Get<TestSchema::Key<"Test.Int">>(), 42);
+    EXPECT_EQ(*blackboard.Get<TestSchema::Key<"Test.Double">>(), 1.5);
+    EXPECT_EQ(*blackboard.Get<TestSchema::Key<"Test.Byte">>(), 0);
+    EXPECT_EQ(*blackboard.GetT<int32_t>(runtimeKey), 7);
+
+    // Like Get(key), schema values are only dirtied when fetched for writing.
+    blackboard.ClearDirty();
+    const Blackboard& constBlackboard = blackboard;
+    EXPECT_EQ(*constBlackboard.Get<TestSchema::Key<"Test.Int">>(), 42);
+    EXPECT_EQ(blackboard.DirtyLines(), 0u);
+}
+
+TEST(BlackboardTest, KeyManagerFindsManyKeys) {
+    BlackboardKeyManager keyManager;
+
+    // The names have to outlive the key manager.
+    std::vector<std::basic_string<BlackboardKeyName::KeyChar>> names;
+
+    for(int32_t i = 0; i < 5000; ++i)
+    {
+        const std::string name = "Test.Key" + std::to_string(i);
+        names.emplace_back(name.begin(), name.end());
+    }
+
+    for(int32_t i = 0; i < 5000; ++i)
+    {
+        EXPECT_EQ(keyManager.CalculateKey(names[i].c_str(), sizeof(int32_t)).Key, i);
+    }
+
+    EXPECT_EQ(keyManager.EntryCount(), 5000u);
+    EXPECT_EQ(keyManager.KeyCount(), 5000);
+    EXPECT_EQ(keyManager.TotalSize(), 5000 * sizeof(int32_t));
+
+    for(int32_t i = 0; i < 5000; i += 37)
+    {
+        EXPECT_EQ(keyManager.CalculateKey(names[i].c_str(), sizeof(int32_t)).Key, i);
+    }
+
+    EXPECT_EQ(keyManager.EntryCount(), 5000u);
+}
+
+TEST(BlackboardTest, LayoutIsOrderedByName) {
+    BlackboardKeyManager keyManager;
+    const BlackboardKey keyC = keyManager.CalculateKey(CSTR("C"), sizeof(int32_t));
+    const BlackboardKey keyA = keyManager.CalculateKey(CSTR("A"), sizeof(int32_t));
+    const BlackboardKey keyB = keyManager.CalculateKey(CSTR("B"), sizeof(int32_t));
+
+    BlackboardLayout layout;
+    ASSERT_EQ(layout.Init(keyManager), PetSuccess);
+
+    EXPECT_EQ(layout.Offset(keyA), 0u);
+    EXPECT_EQ(layout.Offset(keyB), sizeof(int32_t));
+    EXPECT_EQ(layout.Offset(keyC), sizeof(int32_t) * 2);
+}
+
+TEST(BlackboardTest, StoredKeysReplaceByName) {
+    BlackboardKeyManager keyManager;
+    const BlackboardKeyName::KeyChar* const name = CSTR("Test.Stored");
+    const BlackboardKey key = keyManager.CalculateKey(name, sizeof(int32_t));
+
+    const BlackboardKeyName keyName(Victoria::FNV1A(name), static_cast<uint32_t>(StringLength(name)), name);
+    const BlackboardKeyData* const found = keyManager.Find(keyName);
+    ASSERT_NE(found, nullptr);
+    EXPECT_EQ(found->Key.Key, key.Key);
+
+    keyManager.StoreKey(BlackboardKey(10), found->Name, sizeof(int64_t));
+
+    EXPECT_EQ(keyManager.EntryCount(), 1u);
+    EXPECT_EQ(keyManager.TotalSize(), sizeof(int64_t));
+    EXPECT_EQ(keyManager.CalculateKey(name, sizeof(int32_t)).Key, 10);
+    EXPECT_EQ(keyManager.CalculateKey(CSTR("Test.Next"), sizeof(int32_t)).Key, 11);
+}
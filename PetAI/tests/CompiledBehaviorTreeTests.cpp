@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include "BehaviorTree.hpp"
+#include "CompiledBehaviorTree.hpp"
+#include "Blackboard.hpp"
+#include "PetManager.hpp"
+#include <array>
+#include <string>
+
+namespace {
+
+std::string* g_Trace = nullptr;
+BlackboardKey g_CounterKey;
+
+BehaviorTreeActionResult ActionA(PetManager&, const BehaviorTreeActionNode&, Blackboard&, float)
+{
+    *g_Trace += 'A';
+    return BehaviorTreeActionResult::Finish();
+}
+
+BehaviorTreeActionResult ActionB(PetManager&, const BehaviorTreeActionNode&, Blackboard& blackboard, float)
+{
+    // Takes two ticks to finish.
+    int32_t* const pCounter = blackboard.GetT<int32_t>(g_CounterKey);
+    *g_Trace += 'B';
+    return (++*pCounter & 1) == 0 ? BehaviorTreeActionResult::Finish() : BehaviorTreeActionResult::Continue();
+}
+
+BehaviorTreeActionResult ActionC(PetManager&, const BehaviorTreeActionNode&, Blackboard&, float)
+{
+    *g_Trace += 'C';
+    return BehaviorTreeActionResult::Finish();
+}
+
+int32_t SelectByCounter(PetManager&, const BehaviorTreeSelectorNode& node, Blackboard& blackboard)
+{
+    return *blackboard.GetT<int32_t>(g_CounterKey) % static_cast<int32_t>(node.ChildCount());
+}
+
+bool Continue(PetManager&, const BehaviorTreeRepeatNode&, Blackboard&)
+{
+    return true;
+}
+
+struct TestTree
+{
+    BehaviorTreeActionNode A { ActionA };
+    BehaviorTreeActionNode B { ActionB };
+    BehaviorTreeActionNode C { ActionC };
+
+    std::array<BehaviorTreeNode*, 2> SequenceChildren { &A, &B };
+    BehaviorTreeSequenceNode Sequence;
+
+    std::array<BehaviorTreeNode*, 3> SelectorChildren { &Sequence, &C, &Sequence };
+    BehaviorTreeSelectorNode Selector;
+
+    BehaviorTreeRepeatNode Root;
+
+    explicit TestTree(BlackboardKeyManager& keyManager)
+        : Sequence(static_cast<uint32_t>(SequenceChildren.size()), SequenceChildren.data(), keyManager.CalculateKey(CSTR("Test.Sequence"), sizeof(BehaviorTreeSequenceNode::SequenceKeyT)))
+        , Selector(static_cast<uint32_t>(SelectorChildren.size()), SelectorChildren.data(), SelectByCounter, keyManager.CalculateKey(CSTR("Test.Selector"), sizeof(BehaviorTreeSelectorNode::SelectorKeyT)))
+        , Root(&Selector, Continue)
+    { }
+};
+
+}
+
+TEST(CompiledBehaviorTreeTest, FlattensInPreOrder) {
+    BlackboardKeyManager keyManager;
+    g_CounterKey = keyManager.CalculateKey(CSTR("Test.Counter"), sizeof(int32_t));
+    TestTree tree(keyManager);
+
+    CompiledBehaviorTree compiled;
+    ASSERT_EQ(compiled.Compile(&tree.Root), PetSuccess);
+
+    // The shared sequence only appears once.
+    ASSERT_EQ(compiled.NodeCount(), 6u);
+    EXPECT_EQ(compiled.ChildIndexCount(), 1u + 3u + 2u);
+
+    EXPECT_EQ(tree.Root.StateIndex(), 0);
+    EXPECT_EQ(tree.Selector.StateIndex(), 1);
+    EXPECT_EQ(tree.Sequence.StateIndex(), 2);
+    EXPECT_EQ(tree.A.StateIndex(), 3);
+    EXPECT_EQ(tree.B.StateIndex(), 4);
+    EXPECT_EQ(tree.C.StateIndex(), 5);
+
+    const CompiledBehaviorTree::Node* const nodes = compiled.Nodes();
+    EXPECT_EQ(nodes[0].Type, BehaviorTreeNodeType::Repeat);
+    EXPECT_EQ(nodes[0].Parent, -1);
+    EXPECT_EQ(nodes[1].Type, BehaviorTreeNodeType::Selector);
+    EXPECT_EQ(nodes[1].Parent, 0);
+    EXPECT_EQ(nodes[1].Key.Key, tree.Selector.SelectorKey().Key);
+    EXPECT_EQ(nodes[2].Type, BehaviorTreeNodeType::Sequence);
+    EXPECT_EQ(nodes[2].Key.Key, tree.Sequence.SequenceKey().Key);
+    EXPECT_EQ(nodes[5].Type, BehaviorTreeNodeType::Action);
+    EXPECT_EQ(nodes[5].Parent, 1);
+
+    EXPECT_EQ(compiled.Child(nodes[1], 0), 2);
+    EXPECT_EQ(compiled.Child(nodes[1], 1), 5);
+    EXPECT_EQ(compiled.Child(nodes[1], 2), 2);
+    EXPECT_EQ(compiled.Child(nodes[2], 0), 3);
+    EXPECT_EQ(compiled.Child(nodes[2], 1), 4);
+
+    for(uint32_t i = 0; i < compiled.NodeCount(); ++i)
+    {
+        EXPECT_TRUE(nodes[i].Compiled);
+    }
+}
+
+TEST(CompiledBehaviorTreeTest, MatchesPointerExecutor) {
+    BlackboardKeyManager keyManager;
+    g_CounterKey = keyManager.CalculateKey(CSTR("Test.Counter"), sizeof(int32_t));
+    TestTree tree(keyManager);
+
+    CompiledBehaviorTree compiled;
+    ASSERT_EQ(compiled.Compile(&tree.Root), PetSuccess);
+
+    BlackboardLayout layout;
+    ASSERT_EQ(layout.Init(keyManager), PetSuccess);
+
+    Blackboard pointerBlackboard(layout);
+    Blackboard compiledBlackboard(layout);
+
+    PetManager petManager;
+    BehaviorTreeExecutor pointerExecutor(&tree.Root, &pointerBlackboard, &petManager);
+    BehaviorTreeExecutor compiledExecutor(&tree.Root, &compiled, &compiledBlackboard, &petManager);
+
+    std::string pointerTrace;
+    std::string compiledTrace;
+
+    for(int i = 0; i < 100; ++i)
+    {
+        g_Trace = &pointerTrace;
+        pointerExecutor.Tick(0.016f);
+
+        g_Trace = &compiledTrace;
+        compiledExecutor.Tick(0.016f);
+    }
+
+    g_Trace = nullptr;
+
+    EXPECT_FALSE(pointerTrace.empty());
+    EXPECT_EQ(pointerTrace, compiledTrace);
+}
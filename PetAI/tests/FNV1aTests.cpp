@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+#include "FNV1a.hpp"
+#include <cstring>
+#include <string>
+#include <vector>
+
+static_assert(Victoria::FNV1A("SleepXs.Time") == 0xD91D1674);
+static_assert(Victoria::FNV1AIterative("SleepXs.Time") == Victoria::FNV1A("SleepXs.Time"));
+static_assert(Victoria::FNV1A64("") == Victoria::FNV1A64OffsetBasis);
+static_assert(Victoria::FNV1A64("a") == 0xAF63FC4C860222EC);
+
+TEST(FNV1aTest, IterativeMatchesRecursive) {
+    const char* const names[] = { "", "a", "LifeStage", "BarkSequence.SequenceKey", "mixed.Case.NAME" };
+
+    for(const char* const name : names)
+    {
+        EXPECT_EQ(Victoria::FNV1AIterative(name, std::strlen(name)), Victoria::FNV1A(name));
+        EXPECT_EQ(Victoria::FNV1AIterative(name), Victoria::FNV1A(name));
+        EXPECT_EQ(Victoria::FNV1A64(name, std::strlen(name)), Victoria::FNV1A64(name));
+    }
+}
+
+TEST(FNV1aTest, BatchMatchesSingle) {
+    std::vector<std::string> names;
+
+    // Enough names for several full batches and a partial one, with different lengths in each.
+    for(int i = 0; i < 37; ++i)
+    {
+        names.push_back("Key." + std::string(static_cast<size_t>(i % 11), 'x') + std::to_string(i));
+    }
+
+    std::vector<const char*> strings;
+    std::vector<uint32_t> lengths;
+
+    for(const std::string& name : names)
+    {
+        strings.push_back(name.c_str());
+        lengths.push_back(static_cast<uint32_t>(name.size()));
+    }
+
+    std::vector<uint32_t> hashes(names.size());
+    Victoria::FNV1ABatch(strings.data(), lengths.data(), static_cast<uint32_t>(names.size()), hashes.data());
+
+    for(size_t i = 0; i < names.size(); ++i)
+    {
+        EXPECT_EQ(hashes[i], Victoria::FNV1A(names[i].c_str()));
+    }
+}
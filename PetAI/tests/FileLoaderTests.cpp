@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+#include "FileLoader.hpp"
+#include "PetManager.hpp"
+#include "FNV1a.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+struct KeyFile final
+{
+    ::std::vector<uint8_t> Data;
+    uint32_t MapCount = 0;
+    uint32_t LoadCount = 0;
+};
+
+#pragma pack(push, 1)
+struct KeyRecord final
+{
+    int32_t Key;
+    uint32_t Hash;
+    uint32_t NameOffset;
+};
+#pragma pack(pop)
+
+KeyFile BuildKeyFile(const ::std::vector<::std::pair<int32_t, const char*>>& keys)
+{
+    ::std::vector<uint8_t> strings;
+    ::std::vector<KeyRecord> records;
+
+    for(const auto& [key, name] : keys)
+    {
+        records.push_back({ key, Victoria::FNV1AIterative(name), static_cast<uint32_t>(strings.size()) });
+        strings.insert(strings.end(), name, name + ::std::strlen(name) + 1);
+    }
+
+    BlackboardKeyFileBaseHeader header {};
+    (void) ::std::memcpy(header.Magic, BlackboardKeyLoader::FileMagic, sizeof(header.Magic));
+    header.Endian = BlackboardKeyLoader::GoodEndian;
+    header.Version = BlackboardKeyLoader::FileVersion1_0;
+    header.MinVersion = BlackboardKeyLoader::FileVersion1_0;
+    header.KeyCount = static_cast<uint32_t>(records.size());
+    header.KeyIndicesOffset = sizeof(header);
+    header.StringBlobOffset = static_cast<uint32_t>(sizeof(header) + records.size() * sizeof(KeyRecord));
+
+    KeyFile file;
+    file.Data.resize(header.StringBlobOffset + strings.size());
+    (void) ::std::memcpy(file.Data.data(), &header, sizeof(header));
+    (void) ::std::memcpy(file.Data.data() + header.KeyIndicesOffset, records.data(), records.size() * sizeof(KeyRecord));
+    (void) ::std::memcpy(file.Data.data() + header.StringBlobOffset, strings.data(), strings.size());
+    return file;
+}
+
+PetStatus MapKeyFile(const PetAppHandle appHandle, PetFileHandle, const void** const ppData, size_t* const pSize)
+{
+    KeyFile* const file = static_cast<KeyFile*>(appHandle.Ptr);
+    ++file->MapCount;
+    *ppData = file->Data.data();
+    *pSize = file->Data.size();
+    return PetSuccess;
+}
+
+PetStatus UnmapKeyFile(const PetAppHandle appHandle, PetFileHandle, const void*, size_t)
+{
+    --static_cast<KeyFile*>(appHandle.Ptr)->MapCount;
+    return PetSuccess;
+}
+
+PetStatus LoadKeyFile(const PetAppHandle appHandle, PetFileHandle, const size_t offset, void* const pData, size_t* const pSize)
+{
+    KeyFile* const file = static_cast<KeyFile*>(appHandle.Ptr);
+
+    if(!pData)
+    {
+        *pSize = file->Data.size() - offset;
+        return PetSuccess;
+    }
+
+    ++file->LoadCount;
+    *pSize = ::std::min(*pSize, file->Data.size() - offset);
+    (void) ::std::memcpy(pData, file->Data.data() + offset, *pSize);
+    return PetSuccess;
+}
+
+}
+
+TEST(FileLoaderTest, MappedKeyNamesPointIntoTheFile) {
+    KeyFile file = BuildKeyFile({ { 4, "Alpha" }, { 9, "Beta" } });
+
+    PetManager petManager;
+    petManager.AppHandle().Ptr = &file;
+    petManager.AppFunctions().MapPetState = MapKeyFile;
+    petManager.AppFunctions().UnmapPetState = UnmapKeyFile;
+
+    BlackboardKeyLoader loader;
+    ASSERT_EQ(loader.Load(petManager.BlackboardKeyManager(), petManager), PetSuccess);
+    EXPECT_TRUE(loader.IsMapped());
+    EXPECT_EQ(file.MapCount, 1u);
+
+    BlackboardKeyManager& keyManager = petManager.BlackboardKeyManager();
+    const BlackboardKeyName beta(Victoria::FNV1AIterative("Beta"), 4, CSTR("Beta"));
+    const BlackboardKeyData* const found = keyManager.Find(beta);
+
+    ASSERT_NE(found, nullptr);
+    EXPECT_EQ(found->Key.Key, 9);
+    EXPECT_GE(reinterpret_cast<const uint8_t*>(found->Name.String), file.Data.data());
+    EXPECT_LT(reinterpret_cast<const uint8_t*>(found->Name.String), file.Data.data() + file.Data.size());
+
+    // Registering a loaded key keeps its index and fills in its size.
+    EXPECT_EQ(keyManager.CalculateKey(CSTR("Alpha"), sizeof(float)).Key, 4);
+    EXPECT_EQ(keyManager.TotalSize(), sizeof(float));
+    EXPECT_EQ(keyManager.CalculateKey(CSTR("Gamma"), sizeof(float)).Key, 10);
+
+    loader.Unload();
+    EXPECT_EQ(file.MapCount, 0u);
+}
+
+TEST(FileLoaderTest, FallsBackToReadingTheFile) {
+    KeyFile file = BuildKeyFile({ { 0, "Alpha" } });
+
+    PetManager petManager;
+    petManager.AppHandle().Ptr = &file;
+    petManager.AppFunctions().LoadPetState = LoadKeyFile;
+
+    BlackboardKeyLoader loader;
+    ASSERT_EQ(loader.Load(petManager.BlackboardKeyManager(), petManager), PetSuccess);
+    EXPECT_TRUE(loader.IsLoaded());
+    EXPECT_FALSE(loader.IsMapped());
+    EXPECT_EQ(petManager.BlackboardKeyManager().KeyCount(), 1u);
+}
+
+TEST(FileLoaderTest, RejectsNamesOutsideTheFile) {
+    KeyFile file = BuildKeyFile({ { 0, "Alpha" } });
+    // Drop the terminator of the last name.
+    file.Data.pop_back();
+
+    PetManager petManager;
+    petManager.AppHandle().Ptr = &file;
+    petManager.AppFunctions().MapPetState = MapKeyFile;
+    petManager.AppFunctions().UnmapPetState = UnmapKeyFile;
+
+    BlackboardKeyLoader loader;
+    EXPECT_EQ(loader.Load(petManager.BlackboardKeyManager(), petManager), PetFail);
+    EXPECT_FALSE(loader.IsLoaded());
+    EXPECT_EQ(file.MapCount, 0u);
+    EXPECT_EQ(petManager.BlackboardKeyManager().KeyCount(), 0u);
+}
+
+TEST(FileLoaderTest, ReaderReadsAcrossBlocks) {
+    KeyFile file;
+    file.Data.resize(32 * 1024 + 100);
+
+    for(size_t i = 0; i < file.Data.size(); ++i)
+    {
+        file.Data[i] = static_cast<uint8_t>(i * 13);
+    }
+
+    PetManager petManager;
+    petManager.AppHandle().Ptr = &file;
+    petManager.AppFunctions().LoadPetState = LoadKeyFile;
+
+    FileReader reader;
+    ASSERT_EQ(FileReader::OpenFile(petManager, &reader, BlackboardKeyFileHandle, 1024), PetSuccess);
+
+    ::std::vector<uint8_t> contents(file.Data.size());
+
+    // Odd sized reads, so that they straddle the blocks.
+    for(size_t offset = 0; offset < contents.size(); offset += 300)
+    {
+        size_t size = ::std::min<size_t>(300, contents.size() - offset);
+        ASSERT_EQ(reader.ReadBytes(offset, contents.data() + offset, &size), PetSuccess);
+    }
+
+    EXPECT_EQ(contents, file.Data);
+    // 33 blocks, each loaded once.
+    EXPECT_EQ(file.LoadCount, 33u);
+
+    size_t size = 1;
+    EXPECT_EQ(reader.ReadBytes(file.Data.size(), contents.data(), &size), PetInvalidArg);
+}
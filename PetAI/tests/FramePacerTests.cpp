@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include "FramePacer.hpp"
+
+TEST(FramePacerTest, IdleSleepsUntilNextPresent) {
+    FramePacer pacer;
+    pacer.SetTargetPresentRate(4);
+    EXPECT_EQ(pacer.PresentInterval(), 250);
+
+    pacer.Start(1000);
+    pacer.BeginFrame(1000);
+
+    ASSERT_TRUE(pacer.ShouldPresent(1000));
+    pacer.MarkPresented(1002);
+    EXPECT_FALSE(pacer.ShouldPresent(1002));
+
+    // Nothing is awake or sleeping, so only the present matters.
+    EXPECT_EQ(pacer.NextDeadline(1003, false, FramePacer::NoWakeup), 1250);
+}
+
+TEST(FramePacerTest, WakeupAndActivePetsShortenSleep) {
+    FramePacer pacer;
+    pacer.SetTargetPresentRate(1);
+    pacer.Start(0);
+    pacer.MarkPresented(0);
+
+    pacer.BeginFrame(100);
+    EXPECT_EQ(pacer.NextDeadline(102, false, 40), 142);
+    EXPECT_EQ(pacer.NextDeadline(102, true, 40), 100 + FramePacer::ActiveTickInterval);
+
+    // A frame that took longer than the tick interval starts the next one immediately.
+    EXPECT_LE(pacer.NextDeadline(110, true, FramePacer::NoWakeup), 110);
+}
+
+TEST(FramePacerTest, SleepIsCapped) {
+    FramePacer pacer;
+    pacer.SetTargetPresentRate(0);
+    EXPECT_EQ(pacer.PresentInterval(), 1000 / static_cast<TimeMs_t>(FramePacer::DefaultPresentRate));
+
+    pacer.Start(0);
+    pacer.MarkPresented(0);
+    pacer.SetTargetPresentRate(1);
+
+    pacer.BeginFrame(0);
+    EXPECT_LE(pacer.NextDeadline(0, false, FramePacer::NoWakeup), FramePacer::MaxSleepTime);
+}
+
+TEST(FramePacerTest, MissedPresentsDoNotBurst) {
+    FramePacer pacer;
+    pacer.SetTargetPresentRate(10);
+    pacer.Start(0);
+
+    pacer.MarkPresented(550);
+    EXPECT_FALSE(pacer.ShouldPresent(551));
+    EXPECT_TRUE(pacer.ShouldPresent(650));
+}
+
+TEST(FramePacerTest, TracksBusyAndIdleTime) {
+    FramePacer pacer;
+    pacer.Start(0);
+
+    pacer.BeginFrame(0);
+    pacer.EndFrame(3, 10, false);
+
+    pacer.BeginFrame(10);
+    pacer.EndFrame(12, 15, true);
+
+    const PetFrameStats& stats = pacer.Stats();
+    EXPECT_EQ(stats.FrameCount, 2u);
+    EXPECT_EQ(stats.LastBusyTime, 2);
+    EXPECT_EQ(stats.LastIdleTime, 3);
+    EXPECT_EQ(stats.TotalBusyTime, 5);
+    EXPECT_EQ(stats.TotalIdleTime, 10);
+    EXPECT_EQ(stats.EarlyWakeupCount, 1u);
+}
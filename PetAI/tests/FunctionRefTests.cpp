@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include "FunctionRef.hpp"
+
+namespace {
+
+int Add(const int a, const int b)
+{
+    return a + b;
+}
+
+int AddToContext(int* const pContext, const int a)
+{
+    return *pContext + a;
+}
+
+struct Accumulator
+{
+    int Total;
+
+    int Add(const int a)
+    {
+        Total += a;
+        return Total;
+    }
+};
+
+}
+
+TEST(FunctionRefTest, DefaultIsEmpty) {
+    const FunctionRef<int(int, int)> func;
+    EXPECT_FALSE(func);
+
+    const FunctionRef<int(int, int)> nullFunc(static_cast<int(*)(int, int)>(nullptr));
+    EXPECT_FALSE(nullFunc);
+}
+
+TEST(FunctionRefTest, CallsFunctionPointer) {
+    const FunctionRef<int(int, int)> func(Add);
+    ASSERT_TRUE(func);
+    EXPECT_EQ(func(2, 3), 5);
+}
+
+TEST(FunctionRefTest, CallsBoundFunction) {
+    const FunctionRef<int(int, int)> func = FunctionRef<int(int, int)>::Bind<Add>();
+    ASSERT_TRUE(func);
+    EXPECT_EQ(func(4, 5), 9);
+}
+
+TEST(FunctionRefTest, PassesContext) {
+    int context = 10;
+    const FunctionRef<int(int)> func = FunctionRef<int(int)>::Bind<AddToContext>(&context);
+    EXPECT_EQ(func(1), 11);
+
+    context = 20;
+    EXPECT_EQ(func(1), 21);
+}
+
+TEST(FunctionRefTest, CallsMemberFunction) {
+    Accumulator accumulator { 0 };
+    const FunctionRef<int(int)> func = FunctionRef<int(int)>::Bind<&Accumulator::Add>(&accumulator);
+
+    func(3);
+    func(4);
+    EXPECT_EQ(accumulator.Total, 7);
+}
+
+TEST(FunctionRefTest, ReferencesCallable) {
+    int calls = 0;
+    auto callable = [&calls](const int a) { ++calls; return a * 2; };
+
+    const FunctionRef<int(int)> func(callable);
+    EXPECT_EQ(func(21), 42);
+    EXPECT_EQ(calls, 1);
+}
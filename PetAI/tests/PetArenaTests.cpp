@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include "PetArena.hpp"
+#include <cstdint>
+#include <vector>
+
+TEST(PetArenaTest, RoundsUpToSizeClass) {
+    EXPECT_EQ(PetArena::BlockSize(1), PetArena::MinBlockSize);
+    EXPECT_EQ(PetArena::BlockSize(PetArena::MinBlockSize), PetArena::MinBlockSize);
+    EXPECT_EQ(PetArena::BlockSize(PetArena::MinBlockSize + 1), PetArena::MinBlockSize * 2);
+    EXPECT_EQ(PetArena::BlockSize(1000), 1024u);
+}
+
+TEST(PetArenaTest, BlocksAreContiguousAndAligned) {
+    PetArena arena;
+
+    std::vector<unsigned char*> blocks;
+
+    for(size_t i = 0; i < PetArena::SlabBlockCount; ++i)
+    {
+        blocks.push_back(static_cast<unsigned char*>(arena.Allocate(200)));
+        ASSERT_NE(blocks.back(), nullptr);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(blocks.back()) % PetArena::BlockAlignment, 0u);
+    }
+
+    EXPECT_EQ(arena.SlabCount(), 1u);
+
+    for(size_t i = 1; i < blocks.size(); ++i)
+    {
+        EXPECT_EQ(blocks[i], blocks[i - 1] + 256);
+    }
+
+    ASSERT_NE(arena.Allocate(200), nullptr);
+    EXPECT_EQ(arena.SlabCount(), 2u);
+}
+
+TEST(PetArenaTest, ReusesFreedBlocks) {
+    PetArena arena;
+
+    void* const first = arena.Allocate(100);
+    void* const second = arena.Allocate(100);
+    ASSERT_NE(first, nullptr);
+    ASSERT_NE(second, nullptr);
+
+    arena.Deallocate(first, 100);
+    EXPECT_EQ(arena.Allocate(100), first);
+
+    // Different size classes never share blocks.
+    void* const large = arena.Allocate(1000);
+    EXPECT_NE(large, second);
+    EXPECT_EQ(arena.SlabCount(), 2u);
+}
+
+TEST(PetArenaTest, OversizedBlocksFallBack) {
+    PetArena arena;
+
+    void* const block = arena.Allocate(PetArena::MaxBlockSize + 1);
+    ASSERT_NE(block, nullptr);
+    EXPECT_EQ(arena.SlabCount(), 0u);
+    arena.Deallocate(block, PetArena::MaxBlockSize + 1);
+}
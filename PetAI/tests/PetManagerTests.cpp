@@ -0,0 +1,453 @@
+#include <gtest/gtest.h>
+#include "PetManager.hpp"
+#include "PetEntity.hpp"
+#include "PetBehaviors.hpp"
+#include <SysLib.h>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t PetCount = 10;
+
+struct CheckpointFile final
+{
+    ::std::vector<uint8_t> Data;
+    /**
+     * The first and one past the last byte of every write.
+     */
+    ::std::vector<::std::pair<size_t, size_t>> Writes;
+    size_t BytesWritten = 0;
+    uint32_t SaveCompleteCount = 0;
+    uint64_t BytesReported = 0;
+};
+
+PetStatus SaveToCheckpointFile(const PetAppHandle appHandle, PetFileHandle, const size_t offset, const void* const pData, const size_t size)
+{
+    CheckpointFile* const file = static_cast<CheckpointFile*>(appHandle.Ptr);
+
+    if(file->Data.size() < offset + size)
+    {
+        file->Data.resize(offset + size);
+    }
+
+    (void) ::std::memcpy(file->Data.data() + offset, pData, size);
+    file->Writes.emplace_back(offset, offset + size);
+    file->BytesWritten += size;
+    return PetSuccess;
+}
+
+PetStatus RecordSaveComplete(const PetAppHandle appHandle, const PetEventData* const pPetEventData)
+{
+    CheckpointFile* const file = static_cast<CheckpointFile*>(appHandle.Ptr);
+
+    if(pPetEventData->EventType == SaveComplete && pPetEventData->Event.SaveComplete->Status == PetSuccess)
+    {
+        ++file->SaveCompleteCount;
+        file->BytesReported += pPetEventData->Event.SaveComplete->BytesWritten;
+    }
+
+    return PetSuccess;
+}
+
+void CreatePets(PetManager& petManager)
+{
+    InitBlackboardKeys(petManager.BlackboardKeyManager());
+    ASSERT_EQ(petManager.CompileBehaviorTree(&g_RootNode), PetSuccess);
+
+    for(uint32_t i = 0; i < PetCount; ++i)
+    {
+        CreatePetAIData createData {};
+        createData.Gender = PetGenderNeuter;
+        ASSERT_EQ(petManager.CreatePet(&createData, nullptr), PetSuccess);
+    }
+}
+
+}
+
+TEST(PetManagerTest, SleepingPetsAreNotTicked) {
+    PetManager petManager;
+    CreatePets(petManager);
+
+    ASSERT_EQ(petManager.ActivePets().size(), PetCount);
+    EXPECT_EQ(petManager.NextWakeTime(), UINT64_MAX);
+
+    // Every pet barks or eats, then goes to sleep for 3 seconds.
+    for(int i = 0; i < 10 && !petManager.ActivePets().empty(); ++i)
+    {
+        petManager.TickPets(0.016f);
+    }
+
+    EXPECT_TRUE(petManager.ActivePets().empty());
+    EXPECT_EQ(petManager.SleepingPetCount(), PetCount);
+    EXPECT_GT(petManager.NextWakeTime(), petManager.TickTime() + 2'900'000);
+
+    petManager.TickPets(1.0f);
+    EXPECT_EQ(petManager.SleepingPetCount(), PetCount);
+    petManager.TickPets(1.0f);
+    EXPECT_EQ(petManager.SleepingPetCount(), PetCount);
+
+    // The pets wake up, and the time they slept through finishes their sleep.
+    petManager.TickPets(1.0f);
+    EXPECT_EQ(petManager.SleepingPetCount(), 0u);
+    EXPECT_EQ(petManager.ActivePets().size(), PetCount);
+
+    for(PetEntity* const pet : petManager.ActivePets())
+    {
+        EXPECT_EQ(pet->LastTickTime(), petManager.TickTime());
+    }
+}
+
+TEST(PetManagerTest, DestroyedPetsAreReused) {
+    PetManager petManager;
+    CreatePets(petManager);
+
+    petManager.TickPets(0.016f);
+
+    PetEntity* const destroyed = petManager.Pets()[3];
+    const uint32_t columnSlot = destroyed->Blackboard().ColumnSlot();
+    const uint32_t slabCount = petManager.Arena().SlabCount();
+
+    ASSERT_EQ(petManager.DestroyPet(PetHandle { destroyed }), PetSuccess);
+    EXPECT_EQ(petManager.Pets().size(), PetCount - 1);
+    EXPECT_EQ(petManager.ActivePets().size() + petManager.SleepingPetCount(), PetCount - 1);
+
+    // Destroying the same pet twice is caught.
+    EXPECT_EQ(petManager.DestroyPet(PetHandle { destroyed }), PetInvalidArg);
+
+    CreatePetAIData createData {};
+    createData.Gender = PetGenderNeuter;
+    PetHandle petHandle {};
+    ASSERT_EQ(petManager.CreatePet(&createData, &petHandle), PetSuccess);
+
+    PetEntity* const reused = PetEntity::FromHandle(petHandle);
+    EXPECT_EQ(reused, destroyed);
+    EXPECT_EQ(reused->Blackboard().ColumnSlot(), columnSlot);
+    EXPECT_EQ(petManager.Arena().SlabCount(), slabCount);
+
+    for(int i = 0; i < 10; ++i)
+    {
+        petManager.TickPets(0.5f);
+    }
+
+    EXPECT_EQ(petManager.Pets().size(), PetCount);
+}
+
+TEST(PetManagerTest, SnapshotRestoresEveryPet) {
+    // The CRC32 table is built by InitSys.
+    InitSys();
+
+    PetManager petManager;
+    CreatePets(petManager);
+    petManager.Pets()[1]->ParentFemale() = petManager.Pets()[7];
+
+    for(int i = 0; i < 3; ++i)
+    {
+        petManager.TickPets(0.25f);
+    }
+
+    const void* snapshot;
+    size_t snapshotSize;
+    ASSERT_EQ(petManager.SaveSnapshot(&snapshot, &snapshotSize), PetSuccess);
+
+    PetManager restored;
+    InitBlackboardKeys(restored.BlackboardKeyManager());
+    ASSERT_EQ(restored.CompileBehaviorTree(&g_RootNode), PetSuccess);
+    ASSERT_EQ(restored.RestoreSnapshot(snapshot, snapshotSize), PetSuccess);
+
+    ASSERT_EQ(restored.Pets().size(), PetCount);
+    EXPECT_EQ(restored.SleepingPetCount(), petManager.SleepingPetCount());
+    EXPECT_EQ(restored.TickTime(), petManager.TickTime());
+    EXPECT_EQ(restored.NextWakeTime(), petManager.NextWakeTime());
+    EXPECT_EQ(restored.Pets()[1]->ParentFemale(), restored.Pets()[7]);
+
+    const size_t dataSize = petManager.BlackboardLayout().DataSize();
+
+    for(uint32_t i = 0; i < PetCount; ++i)
+    {
+        PetEntity* const original = petManager.Pets()[i];
+        PetEntity* const copy = restored.Pets()[i];
+
+        EXPECT_EQ(::std::memcmp(original->Blackboard().Data(), copy->Blackboard().Data(), dataSize), 0);
+        EXPECT_EQ(copy->LastTickTime(), original->LastTickTime());
+
+        const BehaviorTreeExecutor::Snapshot originalState = original->BehaviorTreeExecutor().SaveState();
+        const BehaviorTreeExecutor::Snapshot copyState = copy->BehaviorTreeExecutor().SaveState();
+        EXPECT_EQ(copyState.CurrentNode, originalState.CurrentNode);
+        EXPECT_EQ(copyState.State, originalState.State);
+    }
+
+    // Both keep running the same way.
+    petManager.TickPets(1.0f);
+    restored.TickPets(1.0f);
+    EXPECT_EQ(restored.SleepingPetCount(), petManager.SleepingPetCount());
+}
+
+TEST(PetManagerTest, CorruptSnapshotIsRejected) {
+    InitSys();
+
+    PetManager petManager;
+    CreatePets(petManager);
+    petManager.TickPets(0.016f);
+
+    const void* snapshot;
+    size_t snapshotSize;
+    ASSERT_EQ(petManager.SaveSnapshot(&snapshot, &snapshotSize), PetSuccess);
+
+    ::std::vector<uint8_t> corrupt(static_cast<const uint8_t*>(snapshot), static_cast<const uint8_t*>(snapshot) + snapshotSize);
+    corrupt[sizeof(PetSnapshotHeader) / 2] ^= 0x10;
+
+    EXPECT_EQ(petManager.RestoreSnapshot(corrupt.data(), corrupt.size()), PetFail);
+    corrupt[sizeof(PetSnapshotHeader) / 2] ^= 0x10;
+    EXPECT_EQ(petManager.RestoreSnapshot(corrupt.data(), corrupt.size() - 1), PetFail);
+    EXPECT_EQ(petManager.Pets().size(), PetCount);
+}
+
+TEST(PetManagerTest, CorruptRecordsAreSkipped) {
+    InitSys();
+
+    PetManager petManager;
+    CreatePets(petManager);
+    petManager.Pets()[1]->ParentFemale() = petManager.Pets()[7];
+    petManager.Pets()[2]->ParentMale() = petManager.Pets()[5];
+    petManager.TickPets(0.016f);
+
+    const void* snapshot;
+    size_t snapshotSize;
+    ASSERT_EQ(petManager.SaveSnapshot(&snapshot, &snapshotSize), PetSuccess);
+
+    const size_t recordSize = (snapshotSize - sizeof(PetSnapshotHeader)) / PetCount;
+    ::std::vector<uint8_t> corrupt(static_cast<const uint8_t*>(snapshot), static_cast<const uint8_t*>(snapshot) + snapshotSize);
+    corrupt[sizeof(PetSnapshotHeader) + recordSize * 5 + recordSize / 2] ^= 0x10;
+
+    PetManager restored;
+    InitBlackboardKeys(restored.BlackboardKeyManager());
+    ASSERT_EQ(restored.CompileBehaviorTree(&g_RootNode), PetSuccess);
+    ASSERT_EQ(restored.RestoreSnapshot(corrupt.data(), corrupt.size()), PetSuccess);
+    ASSERT_EQ(restored.Pets().size(), PetCount - 1);
+
+    // Everything after the damaged pet moves down one.
+    EXPECT_EQ(restored.Pets()[1]->ParentFemale(), restored.Pets()[6]);
+    EXPECT_EQ(restored.Pets()[2]->ParentMale(), nullptr);
+
+    const size_t dataSize = petManager.BlackboardLayout().DataSize();
+
+    for(uint32_t i = 0; i < PetCount - 1; ++i)
+    {
+        PetEntity* const original = petManager.Pets()[i < 5 ? i : i + 1];
+        EXPECT_EQ(::std::memcmp(original->Blackboard().Data(), restored.Pets()[i]->Blackboard().Data(), dataSize), 0);
+    }
+}
+
+TEST(PetManagerTest, RecordsWithAnInvalidGenderAreSkipped) {
+    InitSys();
+
+    PetManager petManager;
+    CreatePets(petManager);
+
+    const void* snapshot;
+    size_t snapshotSize;
+    ASSERT_EQ(petManager.SaveSnapshot(&snapshot, &snapshotSize), PetSuccess);
+
+    // A well formed record, with a gender that doesn't exist.
+    const size_t recordSize = (snapshotSize - sizeof(PetSnapshotHeader)) / PetCount;
+    ::std::vector<uint8_t> bad(static_cast<const uint8_t*>(snapshot), static_cast<const uint8_t*>(snapshot) + snapshotSize);
+    uint8_t* const record = bad.data() + sizeof(PetSnapshotHeader) + recordSize * 3;
+
+    PetSnapshotRecord petRecord;
+    ::std::memcpy(&petRecord, record, sizeof(petRecord));
+    petRecord.Gender = 7;
+    petRecord.Crc = 0;
+    ::std::memcpy(record, &petRecord, sizeof(petRecord));
+    petRecord.Crc = UpdateCRC32(0, record, recordSize);
+    ::std::memcpy(record, &petRecord, sizeof(petRecord));
+
+    PetManager restored;
+    InitBlackboardKeys(restored.BlackboardKeyManager());
+    ASSERT_EQ(restored.CompileBehaviorTree(&g_RootNode), PetSuccess);
+    ASSERT_EQ(restored.RestoreSnapshot(bad.data(), bad.size()), PetSuccess);
+    EXPECT_EQ(restored.Pets().size(), PetCount - 1);
+}
+
+TEST(PetManagerTest, CheckpointsOnlyWriteChanges) {
+    InitSys();
+
+    CheckpointFile file;
+
+    PetManager petManager;
+    petManager.AppHandle().Ptr = &file;
+    petManager.AppFunctions().SavePetState = SaveToCheckpointFile;
+    CreatePets(petManager);
+
+    ASSERT_EQ(petManager.WriteCheckpoint(), PetSuccess);
+    const size_t fullSize = file.BytesWritten;
+    EXPECT_EQ(file.Data.size(), fullSize);
+
+    // Nothing changed, only the header is rewritten.
+    file.BytesWritten = 0;
+    ASSERT_EQ(petManager.WriteCheckpoint(), PetSuccess);
+    EXPECT_EQ(file.BytesWritten, sizeof(PetSnapshotHeader));
+
+    for(int i = 0; i < 3; ++i)
+    {
+        petManager.TickPets(0.25f);
+    }
+
+    file.BytesWritten = 0;
+    ASSERT_EQ(petManager.WriteCheckpoint(), PetSuccess);
+    EXPECT_GT(file.BytesWritten, sizeof(PetSnapshotHeader));
+    EXPECT_LT(file.BytesWritten, fullSize);
+
+    // The patched file is the same as a full snapshot.
+    const void* snapshot;
+    size_t snapshotSize;
+    ASSERT_EQ(petManager.SaveSnapshot(&snapshot, &snapshotSize), PetSuccess);
+    ASSERT_EQ(file.Data.size(), snapshotSize);
+    EXPECT_EQ(::std::memcmp(file.Data.data(), snapshot, snapshotSize), 0);
+
+    PetManager restored;
+    InitBlackboardKeys(restored.BlackboardKeyManager());
+    ASSERT_EQ(restored.CompileBehaviorTree(&g_RootNode), PetSuccess);
+    EXPECT_EQ(restored.RestoreSnapshot(file.Data.data(), file.Data.size()), PetSuccess);
+    EXPECT_EQ(restored.Pets().size(), PetCount);
+}
+
+TEST(PetManagerTest, CheckpointsKeepBatchedSleepTimers) {
+    InitSys();
+
+    CheckpointFile file;
+
+    PetManager petManager;
+    petManager.AppHandle().Ptr = &file;
+    petManager.AppFunctions().SavePetState = SaveToCheckpointFile;
+    CreatePets(petManager);
+
+    ASSERT_EQ(petManager.WriteCheckpoint(), PetSuccess);
+
+    // The sleep timers are only ever written by the batched sleep action.
+    for(int i = 0; i < 8; ++i)
+    {
+        petManager.TickPets(0.25f);
+        ASSERT_EQ(petManager.WriteCheckpoint(), PetSuccess);
+    }
+
+    PetManager restored;
+    InitBlackboardKeys(restored.BlackboardKeyManager());
+    ASSERT_EQ(restored.CompileBehaviorTree(&g_RootNode), PetSuccess);
+    ASSERT_EQ(restored.RestoreSnapshot(file.Data.data(), file.Data.size()), PetSuccess);
+    ASSERT_EQ(restored.Pets().size(), PetCount);
+
+    const BlackboardKey sleepTimeKey = petManager.BlackboardKeyManager().CalculateKey(CSTR("SleepXs.Time"), sizeof(int32_t), BlackboardKeyStorage::Column);
+    uint32_t sleepingCount = 0;
+
+    for(uint32_t i = 0; i < PetCount; ++i)
+    {
+        const int32_t* const originalTime = petManager.Pets()[i]->Blackboard().GetT<int32_t>(sleepTimeKey);
+        const int32_t* const restoredTime = restored.Pets()[i]->Blackboard().GetT<int32_t>(sleepTimeKey);
+        ASSERT_NE(originalTime, nullptr);
+        ASSERT_NE(restoredTime, nullptr);
+        EXPECT_EQ(*restoredTime, *originalTime);
+
+        if(*originalTime != 0)
+        {
+            ++sleepingCount;
+        }
+    }
+
+    EXPECT_GT(sleepingCount, 0u);
+}
+
+TEST(PetManagerTest, CheckpointsSkipLinesThatEndUnchanged) {
+    InitSys();
+
+    CheckpointFile file;
+
+    PetManager petManager;
+    petManager.AppHandle().Ptr = &file;
+    petManager.AppFunctions().SavePetState = SaveToCheckpointFile;
+    CreatePets(petManager);
+
+    for(int i = 0; i < 10 && !petManager.ActivePets().empty(); ++i)
+    {
+        petManager.TickPets(0.016f);
+    }
+
+    ASSERT_EQ(petManager.SleepingPetCount(), PetCount);
+    ASSERT_EQ(petManager.WriteCheckpoint(), PetSuccess);
+
+    //   Every pet wakes up, goes through the whole tree once, selecting its
+    // life stage again, and falls back asleep.
+    for(int i = 0; i < 3; ++i)
+    {
+        petManager.TickPets(1.0f);
+    }
+
+    for(int i = 0; i < 10 && !petManager.ActivePets().empty(); ++i)
+    {
+        petManager.TickPets(0.016f);
+    }
+
+    ASSERT_EQ(petManager.SleepingPetCount(), PetCount);
+
+    // The selector keys were set and cleared again, but are back to what they were.
+    EXPECT_NE(petManager.Pets()[0]->Blackboard().DirtyLines(), 0u);
+
+    file.Writes.clear();
+    ASSERT_EQ(petManager.WriteCheckpoint(), PetSuccess);
+
+    const size_t recordSize = (file.Data.size() - sizeof(PetSnapshotHeader)) / PetCount;
+    const size_t dataSize = petManager.BlackboardLayout().DataSize();
+
+    for(uint32_t i = 0; i < PetCount; ++i)
+    {
+        const size_t dataBegin = sizeof(PetSnapshotHeader) + recordSize * i + sizeof(PetSnapshotRecord);
+
+        for(const auto& [begin, end] : file.Writes)
+        {
+            EXPECT_FALSE(begin < dataBegin + dataSize && end > dataBegin) << "pet " << i;
+        }
+    }
+
+    for(PetEntity* const pet : petManager.Pets())
+    {
+        EXPECT_EQ(pet->Blackboard().DirtyLines(), 0u);
+    }
+}
+
+TEST(PetManagerTest, QueuedCheckpointsAreWrittenInTheBackground) {
+    InitSys();
+
+    CheckpointFile file;
+
+    PetManager petManager;
+    petManager.AppHandle().Ptr = &file;
+    petManager.AppFunctions().Version = PET_AI_VERSION;
+    petManager.AppFunctions().SavePetState = SaveToCheckpointFile;
+    petManager.AppFunctions().PetEvent = RecordSaveComplete;
+    CreatePets(petManager);
+
+    ASSERT_EQ(petManager.StartCheckpointWriter(), PetSuccess);
+    ASSERT_EQ(petManager.QueueCheckpoint(), PetSuccess);
+
+    for(int i = 0; i < 3; ++i)
+    {
+        petManager.TickPets(0.25f);
+    }
+
+    // Both batches may still be in flight, a skipped checkpoint keeps its dirty lines.
+    while(petManager.QueueCheckpoint() == PetNoMoreItems)
+    {
+        petManager.PollCheckpoints();
+    }
+
+    petManager.StopCheckpointWriter();
+    EXPECT_EQ(file.SaveCompleteCount, 2u);
+    EXPECT_EQ(file.BytesReported, file.BytesWritten);
+
+    const void* snapshot;
+    size_t snapshotSize;
+    ASSERT_EQ(petManager.SaveSnapshot(&snapshot, &snapshotSize), PetSuccess);
+    ASSERT_EQ(file.Data.size(), snapshotSize);
+    EXPECT_EQ(::std::memcmp(file.Data.data(), snapshot, snapshotSize), 0);
+}
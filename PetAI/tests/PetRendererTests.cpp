@@ -0,0 +1,521 @@
+#include <gtest/gtest.h>
+#include "PetRenderer.hpp"
+#include <random>
+#include <vector>
+
+namespace {
+
+struct TestRenderer final
+{
+    PetRendererHandle Handle { };
+    PetRendererFunctions Functions { };
+
+    TestRenderer(const uint16_t width, const uint16_t height, const uint32_t flags = PetRendererFlagNone, const uint32_t threadCount = 0)
+    {
+        CreateDefaultPetRenderer createData { };
+        createData.pOutRendererHandle = &Handle;
+        createData.pOutRendererFunctions = &Functions;
+        createData.Version = PET_RENDERER_VERSION;
+        createData.Width = width;
+        createData.Height = height;
+        createData.Flags = flags;
+        createData.ThreadCount = threadCount;
+
+        EXPECT_EQ(DefaultPetRenderer::CreateDefaultRenderer(&createData), PetSuccess);
+    }
+
+    ~TestRenderer()
+    {
+        (void) DefaultPetRenderer::DestroyDefaultRenderer(Handle);
+    }
+
+    DefaultPetRenderer& Renderer() { return *DefaultPetRenderer::FromHandle(Handle); }
+
+    std::vector<uint8_t> Framebuffer()
+    {
+        std::vector<uint8_t> framebuffer(Renderer().FramebufferSize());
+        EXPECT_EQ(Functions.CopyFramebuffer(Handle, framebuffer.data(), framebuffer.size()), PetSuccess);
+        return framebuffer;
+    }
+};
+
+DrawTriangleData MakeTriangle(const ScreenPoint p0, const ScreenPoint p1, const ScreenPoint p2, const RGBColor color)
+{
+    DrawTriangleData drawData { };
+    drawData.Points[0] = p0;
+    drawData.Points[1] = p1;
+    drawData.Points[2] = p2;
+    drawData.Color = color;
+    return drawData;
+}
+
+/**
+ * Lots of overlapping draws, some of them partly off screen.
+ */
+std::vector<PetDrawCommand> MakeScene(const uint16_t width, const uint16_t height, const uint32_t seed)
+{
+    std::mt19937 random(seed);
+
+    const auto point = [&]() -> ScreenPoint
+    {
+        return { static_cast<uint16_t>(random() % (width + 20)), static_cast<uint16_t>(random() % (height + 20)) };
+    };
+
+    std::vector<PetDrawCommand> commands(300);
+
+    for(PetDrawCommand& command : commands)
+    {
+        const RGBColor color { static_cast<uint8_t>(random()), static_cast<uint8_t>(random()), static_cast<uint8_t>(random()) };
+        const uint16_t depth = static_cast<uint16_t>(random() % 16);
+
+        if(random() % 2)
+        {
+            command.Type = PetDrawCommandRectangle;
+            command.Data.Rectangle.Points[0] = point();
+            command.Data.Rectangle.Points[1] = point();
+            command.Data.Rectangle.Depth = depth;
+            command.Data.Rectangle.Color = color;
+        }
+        else
+        {
+            command.Type = PetDrawCommandTriangle;
+            command.Data.Triangle = MakeTriangle(point(), point(), point(), color);
+            command.Data.Triangle.Depth = depth;
+        }
+    }
+
+    return commands;
+}
+
+void DrawScene(TestRenderer& renderer, const std::vector<PetDrawCommand>& commands, const bool record)
+{
+    if(record)
+    {
+        ASSERT_EQ(renderer.Functions.BeginDrawCommands(renderer.Handle), PetSuccess);
+    }
+
+    ASSERT_EQ(renderer.Functions.ClearScreen(renderer.Handle, 10, 20, 30, 0), PetSuccess);
+
+    for(const PetDrawCommand& command : commands)
+    {
+        if(command.Type == PetDrawCommandRectangle)
+        {
+            ASSERT_EQ(renderer.Functions.DrawRectangle(renderer.Handle, &command.Data.Rectangle), PetSuccess);
+        }
+        else
+        {
+            ASSERT_EQ(renderer.Functions.DrawTriangle(renderer.Handle, &command.Data.Triangle), PetSuccess);
+        }
+    }
+
+    if(record)
+    {
+        ASSERT_EQ(renderer.Functions.EndDrawCommands(renderer.Handle), PetSuccess);
+    }
+}
+
+}
+
+TEST(PetRendererTest, DegenerateTrianglesDrawNothing) {
+    TestRenderer renderer(16, 16);
+    ASSERT_EQ(renderer.Functions.ClearScreen(renderer.Handle, 0, 0, 0, 0), PetSuccess);
+    const std::vector<uint8_t> cleared = renderer.Framebuffer();
+
+    const RGBColor white { 0xFF, 0xFF, 0xFF };
+    const DrawTriangleData triangles[] = {
+        // A flat top and a flat bottom used to divide by zero.
+        MakeTriangle({ 2, 2 }, { 2, 2 }, { 9, 9 }, white),
+        MakeTriangle({ 1, 5 }, { 8, 5 }, { 15, 5 }, white),
+        MakeTriangle({ 4, 0 }, { 4, 6 }, { 4, 15 }, white),
+    };
+
+    for(const DrawTriangleData& triangle : triangles)
+    {
+        EXPECT_EQ(renderer.Functions.DrawTriangle(renderer.Handle, &triangle), PetSuccess);
+    }
+
+    EXPECT_EQ(renderer.Framebuffer(), cleared);
+}
+
+TEST(PetRendererTest, TrianglesSharingAnEdgeCoverTheRectangle) {
+    // Big enough to have tiles that are fully inside, fully outside and partially covered.
+    TestRenderer triangles(40, 30);
+    TestRenderer rectangle(40, 30);
+
+    const RGBColor color { 0x10, 0x80, 0xF0 };
+
+    for(TestRenderer* renderer : { &triangles, &rectangle })
+    {
+        ASSERT_EQ(renderer->Functions.ClearScreen(renderer->Handle, 0, 0, 0, 0), PetSuccess);
+    }
+
+    const DrawTriangleData upper = MakeTriangle({ 3, 2 }, { 37, 2 }, { 3, 27 }, color);
+    // Wound the other way around.
+    const DrawTriangleData lower = MakeTriangle({ 37, 2 }, { 37, 27 }, { 3, 27 }, color);
+    ASSERT_EQ(triangles.Functions.DrawTriangle(triangles.Handle, &upper), PetSuccess);
+    ASSERT_EQ(triangles.Functions.DrawTriangle(triangles.Handle, &lower), PetSuccess);
+
+    DrawRectData rect { };
+    rect.Points[0] = { 3, 2 };
+    rect.Points[1] = { 37, 27 };
+    rect.Color = color;
+    ASSERT_EQ(rectangle.Functions.DrawRectangle(rectangle.Handle, &rect), PetSuccess);
+
+    EXPECT_EQ(triangles.Framebuffer(), rectangle.Framebuffer());
+}
+
+TEST(PetRendererTest, TrianglesAreClippedToTheScreen) {
+    TestRenderer renderer(12, 10);
+    ASSERT_EQ(renderer.Functions.ClearScreen(renderer.Handle, 0, 0, 0, 0), PetSuccess);
+
+    const DrawTriangleData triangle = MakeTriangle({ 0, 0 }, { 1000, 0 }, { 0, 1000 }, { 0xFF, 0, 0 });
+    ASSERT_EQ(renderer.Functions.DrawTriangle(renderer.Handle, &triangle), PetSuccess);
+
+    const std::vector<uint8_t> framebuffer = renderer.Framebuffer();
+
+    for(size_t i = 0; i < framebuffer.size(); i += 3)
+    {
+        EXPECT_EQ(framebuffer[i], 0xFF);
+    }
+}
+
+TEST(PetRendererTest, OnlyDirtyRectsAreCopied) {
+    TestRenderer renderer(32, 16);
+    ASSERT_EQ(renderer.Functions.Version, static_cast<uint32_t>(PET_RENDERER_VERSION));
+    ASSERT_NE(renderer.Functions.CopyDirtyFramebuffer, nullptr);
+
+    std::vector<uint8_t> presented(renderer.Renderer().FramebufferSize(), 0);
+    ScreenRect rects[4];
+    uint32_t rectCount = 4;
+
+    // The first copy covers the whole screen.
+    ASSERT_EQ(renderer.Functions.ClearScreen(renderer.Handle, 1, 2, 3, 0), PetSuccess);
+    ASSERT_EQ(renderer.Functions.CopyDirtyFramebuffer(renderer.Handle, presented.data(), presented.size(), rects, &rectCount), PetSuccess);
+    ASSERT_EQ(rectCount, 1u);
+    EXPECT_EQ(rects[0].Width, 32);
+    EXPECT_EQ(rects[0].Height, 16);
+
+    rectCount = 4;
+    EXPECT_EQ(renderer.Functions.CopyDirtyFramebuffer(renderer.Handle, presented.data(), presented.size(), rects, &rectCount), PetNoMoreItems);
+    EXPECT_EQ(rectCount, 0u);
+
+    DrawRectData rect { };
+    rect.Points[0] = { 2, 3 };
+    rect.Points[1] = { 6, 5 };
+    rect.Color = { 0xFF, 0, 0 };
+    ASSERT_EQ(renderer.Functions.DrawRectangle(renderer.Handle, &rect), PetSuccess);
+
+    rect.Points[0] = { 20, 10 };
+    rect.Points[1] = { 24, 14 };
+    ASSERT_EQ(renderer.Functions.DrawRectangle(renderer.Handle, &rect), PetSuccess);
+
+    // Scribble outside the dirty rects, it has to survive the copy.
+    presented[0] = 0xEE;
+
+    rectCount = 4;
+    ASSERT_EQ(renderer.Functions.CopyDirtyFramebuffer(renderer.Handle, presented.data(), presented.size(), rects, &rectCount), PetSuccess);
+    ASSERT_EQ(rectCount, 2u);
+    EXPECT_EQ(rects[0].X, 2);
+    EXPECT_EQ(rects[0].Y, 3);
+    EXPECT_EQ(rects[0].Width, 4);
+    EXPECT_EQ(rects[0].Height, 2);
+    EXPECT_EQ(presented[0], 0xEE);
+
+    presented[0] = 1;
+    EXPECT_EQ(presented, renderer.Framebuffer());
+}
+
+TEST(PetRendererTest, ExtraDirtyRectsAreMerged) {
+    TestRenderer renderer(32, 16);
+    std::vector<uint8_t> presented(renderer.Renderer().FramebufferSize(), 0);
+    ASSERT_EQ(renderer.Functions.CopyDirtyFramebuffer(renderer.Handle, presented.data(), presented.size(), nullptr, nullptr), PetSuccess);
+
+    DrawRectData rect { };
+    rect.Color = { 0, 0xFF, 0 };
+
+    for(uint16_t i = 0; i < 3; ++i)
+    {
+        rect.Points[0] = { static_cast<uint16_t>(i * 10), static_cast<uint16_t>(i * 5) };
+        rect.Points[1] = { static_cast<uint16_t>(i * 10 + 2), static_cast<uint16_t>(i * 5 + 1) };
+        ASSERT_EQ(renderer.Functions.DrawRectangle(renderer.Handle, &rect), PetSuccess);
+    }
+
+    ScreenRect rects[2];
+    uint32_t rectCount = 2;
+    ASSERT_EQ(renderer.Functions.CopyDirtyFramebuffer(renderer.Handle, presented.data(), presented.size(), rects, &rectCount), PetSuccess);
+    ASSERT_EQ(rectCount, 2u);
+    EXPECT_EQ(rects[1].X, 10);
+    EXPECT_EQ(rects[1].Y, 5);
+    EXPECT_EQ(rects[1].Width, 12);
+    EXPECT_EQ(rects[1].Height, 6);
+    EXPECT_EQ(presented, renderer.Framebuffer());
+}
+
+TEST(PetRendererTest, RecordedDrawsAreSortedByDepth) {
+    TestRenderer recorded(24, 24);
+    TestRenderer immediate(24, 24);
+
+    DrawRectData front { };
+    front.Points[0] = { 4, 4 };
+    front.Points[1] = { 16, 16 };
+    front.Depth = 10;
+    front.Color = { 0xFF, 0, 0 };
+
+    DrawTriangleData back = MakeTriangle({ 0, 0 }, { 20, 0 }, { 0, 20 }, { 0, 0, 0xFF });
+    back.Depth = 5;
+
+    ASSERT_EQ(recorded.Functions.BeginDrawCommands(recorded.Handle), PetSuccess);
+    ASSERT_EQ(recorded.Functions.ClearScreen(recorded.Handle, 0, 0, 0, 0), PetSuccess);
+    ASSERT_EQ(recorded.Functions.DrawRectangle(recorded.Handle, &front), PetSuccess);
+    ASSERT_EQ(recorded.Functions.DrawTriangle(recorded.Handle, &back), PetSuccess);
+    ASSERT_EQ(recorded.Functions.EndDrawCommands(recorded.Handle), PetSuccess);
+    EXPECT_EQ(recorded.Renderer().CulledCount(), 0u);
+
+    ASSERT_EQ(immediate.Functions.ClearScreen(immediate.Handle, 0, 0, 0, 0), PetSuccess);
+    ASSERT_EQ(immediate.Functions.DrawTriangle(immediate.Handle, &back), PetSuccess);
+    ASSERT_EQ(immediate.Functions.DrawRectangle(immediate.Handle, &front), PetSuccess);
+
+    EXPECT_EQ(recorded.Framebuffer(), immediate.Framebuffer());
+}
+
+TEST(PetRendererTest, HiddenDrawsAreCulled) {
+    TestRenderer renderer(24, 24);
+    TestRenderer reference(24, 24);
+
+    PetDrawCommand commands[4] { };
+    commands[0].Type = PetDrawCommandRectangle;
+    commands[0].Data.Rectangle.Points[0] = { 2, 2 };
+    commands[0].Data.Rectangle.Points[1] = { 22, 22 };
+    commands[0].Data.Rectangle.Depth = 100;
+    commands[0].Data.Rectangle.Color = { 0, 0xFF, 0 };
+
+    // Both behind the big rectangle.
+    commands[1].Type = PetDrawCommandTriangle;
+    commands[1].Data.Triangle = MakeTriangle({ 3, 3 }, { 20, 5 }, { 6, 21 }, { 0xFF, 0, 0 });
+    commands[1].Data.Triangle.Depth = 50;
+    commands[2].Type = PetDrawCommandRectangle;
+    commands[2].Data.Rectangle.Points[0] = { 5, 5 };
+    commands[2].Data.Rectangle.Points[1] = { 10, 10 };
+    commands[2].Data.Rectangle.Depth = 99;
+
+    // Sticks out of it.
+    commands[3].Type = PetDrawCommandRectangle;
+    commands[3].Data.Rectangle.Points[0] = { 0, 0 };
+    commands[3].Data.Rectangle.Points[1] = { 4, 4 };
+    commands[3].Data.Rectangle.Depth = 1;
+    commands[3].Data.Rectangle.Color = { 0xFF, 0xFF, 0 };
+
+    ASSERT_EQ(renderer.Functions.ClearScreen(renderer.Handle, 0, 0, 0, 0), PetSuccess);
+    ASSERT_EQ(renderer.Functions.SubmitDrawCommands(renderer.Handle, commands, 4), PetSuccess);
+    EXPECT_EQ(renderer.Renderer().CulledCount(), 2u);
+
+    ASSERT_EQ(reference.Functions.ClearScreen(reference.Handle, 0, 0, 0, 0), PetSuccess);
+    ASSERT_EQ(reference.Functions.DrawRectangle(reference.Handle, &commands[3].Data.Rectangle), PetSuccess);
+    ASSERT_EQ(reference.Functions.DrawTriangle(reference.Handle, &commands[1].Data.Triangle), PetSuccess);
+    ASSERT_EQ(reference.Functions.DrawRectangle(reference.Handle, &commands[2].Data.Rectangle), PetSuccess);
+    ASSERT_EQ(reference.Functions.DrawRectangle(reference.Handle, &commands[0].Data.Rectangle), PetSuccess);
+
+    EXPECT_EQ(renderer.Framebuffer(), reference.Framebuffer());
+}
+
+TEST(PetRendererTest, InvalidCommandsAreNotRecorded) {
+    TestRenderer renderer(8, 8);
+    ASSERT_EQ(renderer.Functions.ClearScreen(renderer.Handle, 0, 0, 0, 0), PetSuccess);
+    const std::vector<uint8_t> cleared = renderer.Framebuffer();
+
+    PetDrawCommand commands[2] { };
+    commands[0].Type = PetDrawCommandRectangle;
+    commands[0].Data.Rectangle.Points[1] = { 8, 8 };
+    commands[0].Data.Rectangle.Color = { 0xFF, 0xFF, 0xFF };
+    commands[1].Type = 0;
+
+    EXPECT_EQ(renderer.Functions.SubmitDrawCommands(renderer.Handle, commands, 2), PetInvalidArg);
+    ASSERT_EQ(renderer.Functions.SubmitDrawCommands(renderer.Handle, nullptr, 0), PetSuccess);
+    EXPECT_EQ(renderer.Framebuffer(), cleared);
+    EXPECT_EQ(renderer.Functions.EndDrawCommands(renderer.Handle), PetFail);
+}
+
+TEST(PetRendererTest, DepthBufferDrawsInAnyOrder) {
+    // Not a multiple of the tile size, so the edge tiles are cut short.
+    TestRenderer depthTested(29, 21, PetRendererFlagDepthBuffer);
+    TestRenderer sorted(29, 21);
+    ASSERT_TRUE(depthTested.Renderer().HasDepthBuffer());
+    ASSERT_FALSE(sorted.Renderer().HasDepthBuffer());
+
+    DrawRectData front { };
+    front.Points[0] = { 3, 2 };
+    front.Points[1] = { 29, 19 };
+    front.Depth = 10;
+    front.Color = { 0xFF, 0, 0 };
+
+    DrawTriangleData middle = MakeTriangle({ 0, 0 }, { 28, 4 }, { 6, 21 }, { 0, 0xFF, 0 });
+    middle.Depth = 7;
+
+    DrawRectData back { };
+    back.Points[0] = { 0, 0 };
+    back.Points[1] = { 29, 21 };
+    back.Depth = 5;
+    back.Color = { 0, 0, 0xFF };
+
+    ASSERT_EQ(depthTested.Functions.ClearScreen(depthTested.Handle, 0, 0, 0, 0), PetSuccess);
+    ASSERT_EQ(depthTested.Functions.DrawRectangle(depthTested.Handle, &front), PetSuccess);
+    ASSERT_EQ(depthTested.Functions.DrawTriangle(depthTested.Handle, &middle), PetSuccess);
+    ASSERT_EQ(depthTested.Functions.DrawRectangle(depthTested.Handle, &back), PetSuccess);
+
+    ASSERT_EQ(sorted.Functions.ClearScreen(sorted.Handle, 0, 0, 0, 0), PetSuccess);
+    ASSERT_EQ(sorted.Functions.DrawRectangle(sorted.Handle, &back), PetSuccess);
+    ASSERT_EQ(sorted.Functions.DrawTriangle(sorted.Handle, &middle), PetSuccess);
+    ASSERT_EQ(sorted.Functions.DrawRectangle(sorted.Handle, &front), PetSuccess);
+
+    EXPECT_EQ(depthTested.Framebuffer(), sorted.Framebuffer());
+}
+
+TEST(PetRendererTest, DepthBufferKeepsTheOrderOfEqualDepths) {
+    TestRenderer renderer(16, 16, PetRendererFlagDepthBuffer);
+    ASSERT_EQ(renderer.Functions.ClearScreen(renderer.Handle, 0, 0, 0, 0), PetSuccess);
+
+    DrawRectData first { };
+    first.Points[1] = { 16, 16 };
+    first.Depth = 3;
+    first.Color = { 0xFF, 0, 0 };
+
+    DrawRectData second = first;
+    second.Color = { 0, 0xFF, 0 };
+
+    ASSERT_EQ(renderer.Functions.DrawRectangle(renderer.Handle, &first), PetSuccess);
+    ASSERT_EQ(renderer.Functions.DrawRectangle(renderer.Handle, &second), PetSuccess);
+
+    const std::vector<uint8_t> framebuffer = renderer.Framebuffer();
+    EXPECT_EQ(framebuffer[0], 0);
+    EXPECT_EQ(framebuffer[1], 0xFF);
+}
+
+TEST(PetRendererTest, ClearResetsTheDepthBuffer) {
+    TestRenderer renderer(16, 16, PetRendererFlagDepthBuffer);
+
+    DrawRectData rect { };
+    rect.Points[1] = { 16, 16 };
+    rect.Depth = 100;
+    rect.Color = { 0xFF, 0, 0 };
+
+    ASSERT_EQ(renderer.Functions.ClearScreen(renderer.Handle, 0, 0, 0, 0), PetSuccess);
+    ASSERT_EQ(renderer.Functions.DrawRectangle(renderer.Handle, &rect), PetSuccess);
+
+    // Anything behind the clear isn't drawn.
+    ASSERT_EQ(renderer.Functions.ClearScreen(renderer.Handle, 0, 0, 0, 50), PetSuccess);
+    const std::vector<uint8_t> cleared = renderer.Framebuffer();
+
+    rect.Depth = 49;
+    ASSERT_EQ(renderer.Functions.DrawRectangle(renderer.Handle, &rect), PetSuccess);
+    EXPECT_EQ(renderer.Framebuffer(), cleared);
+
+    rect.Depth = 50;
+    ASSERT_EQ(renderer.Functions.DrawRectangle(renderer.Handle, &rect), PetSuccess);
+    EXPECT_EQ(renderer.Framebuffer()[0], 0xFF);
+}
+
+TEST(PetRendererTest, TiledMatchesSerial) {
+    // Not a multiple of the bin size, so the edge bins are cut short.
+    constexpr uint16_t Width = 203;
+    constexpr uint16_t Height = 141;
+
+    for(const uint32_t flags : { PetRendererFlagNone, PetRendererFlagDepthBuffer })
+    {
+        for(const bool record : { false, true })
+        {
+            TestRenderer serial(Width, Height, flags);
+            TestRenderer tiled(Width, Height, flags, 4);
+            ASSERT_FALSE(serial.Renderer().IsTiled());
+            ASSERT_TRUE(tiled.Renderer().IsTiled());
+
+            std::vector<uint8_t> serialFramebuffer(serial.Renderer().FramebufferSize());
+            std::vector<uint8_t> tiledFramebuffer(tiled.Renderer().FramebufferSize());
+
+            // A few frames, so the second one draws over the first.
+            for(uint32_t frame = 0; frame < 3; ++frame)
+            {
+                const std::vector<PetDrawCommand> commands = MakeScene(Width, Height, frame);
+                DrawScene(serial, commands, record);
+                DrawScene(tiled, commands, record);
+
+                ScreenRect serialRects[DefaultPetRenderer::MaxDirtyRects];
+                ScreenRect tiledRects[DefaultPetRenderer::MaxDirtyRects];
+                uint32_t serialRectCount = DefaultPetRenderer::MaxDirtyRects;
+                uint32_t tiledRectCount = DefaultPetRenderer::MaxDirtyRects;
+
+                ASSERT_EQ(serial.Functions.CopyDirtyFramebuffer(serial.Handle, serialFramebuffer.data(), serialFramebuffer.size(), serialRects, &serialRectCount), PetSuccess);
+                ASSERT_EQ(tiled.Functions.CopyDirtyFramebuffer(tiled.Handle, tiledFramebuffer.data(), tiledFramebuffer.size(), tiledRects, &tiledRectCount), PetSuccess);
+
+                ASSERT_EQ(tiledFramebuffer, serialFramebuffer) << "flags " << flags << ", record " << record << ", frame " << frame;
+                ASSERT_EQ(tiledRectCount, serialRectCount);
+                EXPECT_EQ(tiled.Renderer().CulledCount(), serial.Renderer().CulledCount());
+
+                for(uint32_t i = 0; i < serialRectCount; ++i)
+                {
+                    EXPECT_EQ(tiledRects[i].X, serialRects[i].X);
+                    EXPECT_EQ(tiledRects[i].Y, serialRects[i].Y);
+                    EXPECT_EQ(tiledRects[i].Width, serialRects[i].Width);
+                    EXPECT_EQ(tiledRects[i].Height, serialRects[i].Height);
+                }
+            }
+        }
+    }
+}
+
+TEST(PetRendererTest, TiledDrawsWaitForTheCopy) {
+    TestRenderer renderer(16, 16, PetRendererFlagNone, 2);
+    ASSERT_EQ(renderer.Functions.ClearScreen(renderer.Handle, 0, 0, 0, 0), PetSuccess);
+
+    DrawRectData rect { };
+    rect.Points[1] = { 16, 16 };
+    rect.Color = { 0xFF, 0xFF, 0xFF };
+    ASSERT_EQ(renderer.Functions.DrawRectangle(renderer.Handle, &rect), PetSuccess);
+
+    const std::vector<uint8_t> framebuffer = renderer.Framebuffer();
+    EXPECT_EQ(framebuffer.front(), 0xFF);
+    EXPECT_EQ(framebuffer.back(), 0xFF);
+}
+
+TEST(PetRendererTest, LockedFrontBufferKeepsTheLastFrame) {
+    for(const uint32_t threadCount : { 0u, 2u })
+    {
+        TestRenderer renderer(16, 8, PetRendererFlagNone, threadCount);
+        ASSERT_NE(renderer.Functions.LockFramebuffer, nullptr);
+        ASSERT_EQ(renderer.Functions.ClearScreen(renderer.Handle, 1, 2, 3, 0), PetSuccess);
+
+        PetFramebufferLock lock { };
+        ASSERT_EQ(renderer.Functions.LockFramebuffer(renderer.Handle, &lock), PetSuccess);
+        EXPECT_EQ(renderer.Functions.LockFramebuffer(renderer.Handle, &lock), PetFail);
+        EXPECT_NE(lock.Changed, 0u);
+        EXPECT_EQ(lock.Format, static_cast<uint32_t>(PetPixelFormatRGB24));
+        EXPECT_EQ(lock.Width, 16);
+        EXPECT_EQ(lock.Height, 8);
+        ASSERT_EQ(lock.Stride, 16u * 3);
+
+        const std::vector<uint8_t> firstFrame = renderer.Framebuffer();
+        EXPECT_EQ(std::vector<uint8_t>(lock.pPixels, lock.pPixels + firstFrame.size()), firstFrame);
+
+        // Drawing while it's locked goes to the back buffer.
+        DrawRectData rect { };
+        rect.Points[0] = { 4, 2 };
+        rect.Points[1] = { 8, 6 };
+        rect.Color = { 0xFF, 0xFF, 0xFF };
+        ASSERT_EQ(renderer.Functions.DrawRectangle(renderer.Handle, &rect), PetSuccess);
+
+        const std::vector<uint8_t> secondFrame = renderer.Framebuffer();
+        ASSERT_NE(secondFrame, firstFrame);
+        EXPECT_EQ(std::vector<uint8_t>(lock.pPixels, lock.pPixels + firstFrame.size()), firstFrame);
+
+        ASSERT_EQ(renderer.Functions.UnlockFramebuffer(renderer.Handle), PetSuccess);
+        EXPECT_EQ(renderer.Functions.UnlockFramebuffer(renderer.Handle), PetFail);
+
+        ASSERT_EQ(renderer.Functions.LockFramebuffer(renderer.Handle, &lock), PetSuccess);
+        EXPECT_NE(lock.Changed, 0u);
+        EXPECT_EQ(std::vector<uint8_t>(lock.pPixels, lock.pPixels + secondFrame.size()), secondFrame);
+        ASSERT_EQ(renderer.Functions.UnlockFramebuffer(renderer.Handle), PetSuccess);
+
+        ASSERT_EQ(renderer.Functions.LockFramebuffer(renderer.Handle, &lock), PetSuccess);
+        EXPECT_EQ(lock.Changed, 0u);
+        ASSERT_EQ(renderer.Functions.UnlockFramebuffer(renderer.Handle), PetSuccess);
+    }
+}
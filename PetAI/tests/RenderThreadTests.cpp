@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include "RenderThread.hpp"
+#include "PetRenderer.hpp"
+#include <atomic>
+#include <vector>
+
+namespace {
+
+struct FakeApp final
+{
+    std::atomic<uint32_t> PresentCount { 0 };
+    /**
+     * Present waits for this while it is set.
+     */
+    std::atomic_bool Blocked { false };
+};
+
+PetStatus RecordPresent(const PetAppHandle appHandle, PetRendererHandle, const PetRendererFunctions*)
+{
+    FakeApp& app = *static_cast<FakeApp*>(appHandle.Ptr);
+
+    app.PresentCount.fetch_add(1);
+    app.PresentCount.notify_all();
+    app.Blocked.wait(true);
+
+    return PetSuccess;
+}
+
+struct TestScene final
+{
+    FakeApp App;
+    PetRendererHandle Handle { };
+    PetRendererFunctions Functions { };
+
+    TestScene()
+    {
+        CreateDefaultPetRenderer createData { };
+        createData.pOutRendererHandle = &Handle;
+        createData.pOutRendererFunctions = &Functions;
+        createData.Version = PET_RENDERER_VERSION;
+        createData.Width = 16;
+        createData.Height = 16;
+
+        EXPECT_EQ(DefaultPetRenderer::CreateDefaultRenderer(&createData), PetSuccess);
+    }
+
+    ~TestScene()
+    {
+        (void) DefaultPetRenderer::DestroyDefaultRenderer(Handle);
+    }
+
+    std::vector<uint8_t> Framebuffer()
+    {
+        std::vector<uint8_t> framebuffer(DefaultPetRenderer::FromHandle(Handle)->FramebufferSize());
+        EXPECT_EQ(Functions.CopyFramebuffer(Handle, framebuffer.data(), framebuffer.size()), PetSuccess);
+        return framebuffer;
+    }
+};
+
+void CaptureRectangle(SceneSnapshot& snapshot, const uint16_t size, const uint8_t red)
+{
+    snapshot.SetClear({ 0, 0, 0 }, 0);
+
+    PetDrawCommand command { };
+    command.Type = PetDrawCommandRectangle;
+    command.Data.Rectangle.Points[1] = { size, size };
+    command.Data.Rectangle.Color = { red, 0, 0 };
+    snapshot.Append(command);
+}
+
+}
+
+TEST(RenderThreadTest, PublishedScenesArePresented) {
+    TestScene scene;
+    RenderThread renderThread;
+    renderThread.Init(RecordPresent, { &scene.App }, scene.Handle, &scene.Functions);
+    ASSERT_EQ(renderThread.Start(), PetSuccess);
+
+    CaptureRectangle(renderThread.BeginSnapshot(), 8, 0xFF);
+    renderThread.Publish();
+    renderThread.Stop();
+
+    EXPECT_EQ(renderThread.PresentCount(), 1u);
+    EXPECT_EQ(renderThread.DrawCount(), 1u);
+    EXPECT_EQ(scene.App.PresentCount.load(), 1u);
+
+    const std::vector<uint8_t> framebuffer = scene.Framebuffer();
+    EXPECT_EQ(framebuffer[0], 0xFF);
+    EXPECT_EQ(framebuffer[(16 * 8 + 8) * 3], 0);
+}
+
+TEST(RenderThreadTest, PublishDoesNotWaitForPresent) {
+    TestScene scene;
+    RenderThread renderThread;
+    renderThread.Init(RecordPresent, { &scene.App }, scene.Handle, &scene.Functions);
+    ASSERT_EQ(renderThread.Start(), PetSuccess);
+
+    scene.App.Blocked.store(true);
+
+    CaptureRectangle(renderThread.BeginSnapshot(), 4, 1);
+    renderThread.Publish();
+    scene.App.PresentCount.wait(0);
+
+    // The render thread is stuck presenting the first frame, none of these wait for it.
+    for(uint8_t frame = 2; frame <= 10; ++frame)
+    {
+        CaptureRectangle(renderThread.BeginSnapshot(), frame, frame);
+        renderThread.Publish();
+    }
+
+    scene.App.Blocked.store(false);
+    scene.App.Blocked.notify_all();
+    renderThread.Stop();
+
+    // Only the newest of the frames published while it was busy is drawn.
+    EXPECT_EQ(renderThread.PresentCount(), 2u);
+
+    const std::vector<uint8_t> framebuffer = scene.Framebuffer();
+    EXPECT_EQ(framebuffer[(16 * 9 + 9) * 3], 10);
+    EXPECT_EQ(framebuffer[(16 * 10 + 10) * 3], 0);
+}
+
+TEST(RenderThreadTest, UnchangedScenesAreNotRedrawn) {
+    TestScene scene;
+    RenderThread renderThread;
+    renderThread.Init(RecordPresent, { &scene.App }, scene.Handle, &scene.Functions);
+
+    // Not started, so every publish presents right away.
+    for(uint32_t i = 0; i < 3; ++i)
+    {
+        CaptureRectangle(renderThread.BeginSnapshot(), 8, 0xFF);
+        renderThread.Publish();
+        EXPECT_EQ(renderThread.PresentCount(), i + 1);
+    }
+
+    EXPECT_EQ(renderThread.DrawCount(), 1u);
+
+    CaptureRectangle(renderThread.BeginSnapshot(), 9, 0xFF);
+    renderThread.Publish();
+    EXPECT_EQ(renderThread.DrawCount(), 2u);
+    EXPECT_EQ(scene.App.PresentCount.load(), 4u);
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include "SpanFill.hpp"
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr uint8_t Canary = 0xA5;
+
+std::vector<uint8_t> FillWith(const SpanFill::FillRgbFunc func, const size_t offset, const size_t pixelCount)
+{
+    // Leave room on both sides to catch writes outside the span.
+    std::vector<uint8_t> buffer(offset + pixelCount * 3 + 64, Canary);
+    func(buffer.data() + offset, pixelCount, 0x12, 0x34, 0x56);
+    return buffer;
+}
+
+}
+
+TEST(SpanFillTest, ScalarFillsEveryPixel) {
+    const SpanFill::FillRgbFunc scalar = SpanFill::KernelFunc(SpanFill::Kernel::Scalar);
+    ASSERT_NE(scalar, nullptr);
+
+    const std::vector<uint8_t> buffer = FillWith(scalar, 1, 37);
+
+    EXPECT_EQ(buffer[0], Canary);
+
+    for(size_t i = 0; i < 37; ++i)
+    {
+        EXPECT_EQ(buffer[1 + i * 3 + 0], 0x12);
+        EXPECT_EQ(buffer[1 + i * 3 + 1], 0x34);
+        EXPECT_EQ(buffer[1 + i * 3 + 2], 0x56);
+    }
+
+    EXPECT_EQ(buffer[1 + 37 * 3], Canary);
+}
+
+TEST(SpanFillTest, KernelsMatchScalar) {
+    const SpanFill::FillRgbFunc scalar = SpanFill::KernelFunc(SpanFill::Kernel::Scalar);
+
+    for(const SpanFill::Kernel kernel : { SpanFill::Kernel::SSE2, SpanFill::Kernel::AVX2 })
+    {
+        const SpanFill::FillRgbFunc func = SpanFill::KernelFunc(kernel);
+
+        if(!func)
+        {
+            continue;
+        }
+
+        // Every length around the 16 and 32 pixel strides, at every alignment.
+        for(size_t offset = 0; offset < 32; ++offset)
+        {
+            for(size_t pixelCount = 0; pixelCount < 100; ++pixelCount)
+            {
+                ASSERT_EQ(FillWith(func, offset, pixelCount), FillWith(scalar, offset, pixelCount))
+                    << "kernel " << static_cast<uint32_t>(kernel) << ", offset " << offset << ", " << pixelCount << " pixels";
+            }
+        }
+    }
+}
+
+TEST(SpanFillTest, DepthKernelsMatchScalar) {
+    const SpanFill::FillRgbDepthFunc scalar = SpanFill::DepthKernelFunc(SpanFill::Kernel::Scalar);
+    ASSERT_NE(scalar, nullptr);
+
+    std::mt19937 random(1234);
+
+    for(const SpanFill::Kernel kernel : { SpanFill::Kernel::SSE2, SpanFill::Kernel::AVX2 })
+    {
+        const SpanFill::FillRgbDepthFunc func = SpanFill::DepthKernelFunc(kernel);
+
+        if(!func)
+        {
+            continue;
+        }
+
+        for(size_t pixelCount = 0; pixelCount < 100; ++pixelCount)
+        {
+            // Mostly around the depth being drawn, so that runs start and stop everywhere.
+            std::vector<uint16_t> depths(pixelCount);
+
+            for(uint16_t& depth : depths)
+            {
+                depth = static_cast<uint16_t>(0x7FFE + random() % 4);
+            }
+
+            std::vector<uint16_t> expectedDepths = depths;
+            std::vector<uint8_t> expected(pixelCount * 3 + 1, Canary);
+            scalar(expected.data(), expectedDepths.data(), pixelCount, 0x7FFF, 0x12, 0x34, 0x56);
+
+            std::vector<uint8_t> actual(pixelCount * 3 + 1, Canary);
+            func(actual.data(), depths.data(), pixelCount, 0x7FFF, 0x12, 0x34, 0x56);
+
+            ASSERT_EQ(actual, expected) << "kernel " << static_cast<uint32_t>(kernel) << ", " << pixelCount << " pixels";
+            ASSERT_EQ(depths, expectedDepths) << "kernel " << static_cast<uint32_t>(kernel) << ", " << pixelCount << " pixels";
+        }
+    }
+}
+
+TEST(SpanFillTest, DepthTestKeepsNearerPixels) {
+    const SpanFill::FillRgbDepthFunc scalar = SpanFill::DepthKernelFunc(SpanFill::Kernel::Scalar);
+
+    uint16_t depths[3] = { 4, 5, 6 };
+    uint8_t pixels[9] { };
+    scalar(pixels, depths, 3, 5, 0xFF, 0xFF, 0xFF);
+
+    EXPECT_EQ(pixels[0], 0xFF);
+    EXPECT_EQ(pixels[3], 0xFF);
+    EXPECT_EQ(pixels[6], 0);
+    EXPECT_EQ(depths[0], 5);
+    EXPECT_EQ(depths[1], 5);
+    EXPECT_EQ(depths[2], 6);
+}
+
+TEST(SpanFillTest, ActiveKernelIsSupported) {
+    EXPECT_NE(SpanFill::KernelFunc(SpanFill::ActiveKernel()), nullptr);
+}
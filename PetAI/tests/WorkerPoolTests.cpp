@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include "WorkerPool.hpp"
+#include <atomic>
+#include <vector>
+
+namespace {
+
+struct CountContext
+{
+    std::vector<std::atomic<uint32_t>>* Counts;
+    std::atomic<uint32_t> MaxWorker;
+};
+
+void CountItems(CountContext* const pContext, const uint32_t workerIndex, const uint32_t begin, const uint32_t end)
+{
+    for(uint32_t i = begin; i < end; ++i)
+    {
+        ++(*pContext->Counts)[i];
+    }
+
+    uint32_t maxWorker = pContext->MaxWorker.load();
+    while(workerIndex > maxWorker && !pContext->MaxWorker.compare_exchange_weak(maxWorker, workerIndex)) { }
+}
+
+}
+
+TEST(WorkerPoolTest, SingleThreadRunsInline) {
+    WorkerPool pool;
+    ASSERT_EQ(pool.Start(1), PetSuccess);
+    EXPECT_EQ(pool.ThreadCount(), 1u);
+
+    std::vector<std::atomic<uint32_t>> counts(1000);
+    CountContext context { &counts, 0 };
+
+    pool.ParallelFor(static_cast<uint32_t>(counts.size()), 16, WorkerPool::TaskFunc::Bind<CountItems>(&context));
+
+    for(const std::atomic<uint32_t>& count : counts)
+    {
+        EXPECT_EQ(count.load(), 1u);
+    }
+    EXPECT_EQ(context.MaxWorker.load(), 0u);
+}
+
+TEST(WorkerPoolTest, EveryItemVisitedOnce) {
+    WorkerPool pool;
+    ASSERT_EQ(pool.Start(4), PetSuccess);
+    EXPECT_EQ(pool.ThreadCount(), 4u);
+
+    std::vector<std::atomic<uint32_t>> counts(10007);
+
+    for(uint32_t round = 0; round < 50; ++round)
+    {
+        CountContext context { &counts, 0 };
+        pool.ParallelFor(static_cast<uint32_t>(counts.size()), 7, WorkerPool::TaskFunc::Bind<CountItems>(&context));
+    }
+
+    for(const std::atomic<uint32_t>& count : counts)
+    {
+        EXPECT_EQ(count.load(), 50u);
+    }
+}
+
+TEST(WorkerPoolTest, EmptyRangeDoesNothing) {
+    WorkerPool pool;
+    ASSERT_EQ(pool.Start(3), PetSuccess);
+
+    std::vector<std::atomic<uint32_t>> counts(1);
+    CountContext context { &counts, 0 };
+
+    pool.ParallelFor(0, 16, WorkerPool::TaskFunc::Bind<CountItems>(&context));
+
+    EXPECT_EQ(counts[0].load(), 0u);
+}
+
+TEST(WorkerPoolTest, RestartChangesThreadCount) {
+    WorkerPool pool;
+    ASSERT_EQ(pool.Start(2), PetSuccess);
+    EXPECT_EQ(pool.ThreadCount(), 2u);
+
+    ASSERT_EQ(pool.Start(WorkerPool::MaxThreadCount + 10), PetSuccess);
+    EXPECT_EQ(pool.ThreadCount(), WorkerPool::MaxThreadCount);
+
+    pool.Stop();
+    EXPECT_EQ(pool.ThreadCount(), 1u);
+}
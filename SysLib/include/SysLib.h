@@ -84,10 +84,23 @@ int StringCompare8(const char8_t* left, const char8_t* right);
 
 void ZeroMem(void* data, const size_t length);
 
+/**
+ * \brief Seeds the random number generator of the calling thread.
+ *
+ * Every thread has its own generator, threads that never call this
+ * start with a seed of 0.
+ * \param seed The new seed.
+ */
 void SeedRng(int seed);
 
+/**
+ * \return A random integer in [min, max] from the calling thread's generator.
+ */
 int GenerateRandomInt(int min, int max);
 
+/**
+ * \return A random float in [min, max] from the calling thread's generator.
+ */
 float GenerateRandomFloat(float min, float max);
 
 #ifdef __cplusplus
@@ -5,7 +5,8 @@
 #include <chrono>
 
 static uint32_t s_Crc32Table[256];
-static unsigned int s_Seed = 0;
+// Each thread gets its own generator so the behavior trees can be ticked in parallel.
+static thread_local unsigned int s_Seed = 0;
 
 [[nodiscard]] TimeMs_t internal_GetCurrentTimeMs()
 {